@@ -0,0 +1,36 @@
+#ifndef ARRAYBUFFER_H_
+#define ARRAYBUFFER_H_
+
+#include "Buffer.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl
+{
+
+class ArrayBuffer : public Buffer<ArrayBuffer>
+{
+public:
+	using Buffer<ArrayBuffer>::Buffer;
+
+	GLenum target() const
+	{
+		return GL_ARRAY_BUFFER;
+	}
+
+	static void unbind()
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+};
+
+}
+}
+}
+}
+
+#endif /* ARRAYBUFFER_H_ */
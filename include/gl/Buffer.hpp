@@ -0,0 +1,169 @@
+#ifndef BUFFER_H_
+#define BUFFER_H_
+
+#include <ostream>
+#include <utility>
+
+#include <GL/glew.h>
+
+#include "OpenGl.hpp"
+#include "Bindable.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl
+{
+
+template <typename T>
+class Buffer : public Bindable<T>
+{
+public:
+	Buffer() = default;
+
+	explicit Buffer(const GLuint id) : id_(id)
+	{
+	}
+
+	Buffer(const Buffer& other) = delete;
+
+	Buffer(Buffer&& other)
+	{
+		this->id_ = other.id_;
+		this->size_ = other.size_;
+
+		other.id_ = INVALID_ID;
+		other.size_ = 0;
+	}
+
+	operator GLuint() const
+	{
+		return id_;
+	}
+
+	Buffer& operator=(const Buffer& other) = delete;
+	Buffer& operator=(Buffer&& other)
+	{
+		// Swap, so the buffer previously owned by this one is destroyed along with other
+		std::swap(id_, other.id_);
+		std::swap(size_, other.size_);
+
+		return *this;
+	}
+
+	void generate()
+	{
+		if (valid()) throw std::runtime_error("Cannot generate buffer - buffer was already created.");
+
+		glGenBuffers(1, &id_);
+
+		if (id_ == INVALID_ID)
+		{
+			throw std::runtime_error("Could not create buffer.");
+		}
+	}
+
+	void bind()
+	{
+		if (!valid()) throw std::runtime_error("Cannot bind buffer - buffer was not created.");
+
+		glBindBuffer(target(), id_);
+	}
+
+	void bufferData(const GLsizeiptr size, const GLvoid* data, const GLenum usage)
+	{
+		if (!valid()) throw std::runtime_error("Cannot set buffer data - buffer was not created.");
+
+		bind();
+
+		glBufferData(target(), size, data, usage);
+
+		size_ = size;
+
+		ASSERT_GL_ERROR();
+	}
+
+	void bufferSubData(const GLintptr offset, const GLsizeiptr size, const GLvoid* data)
+	{
+		if (!valid()) throw std::runtime_error("Cannot set buffer sub data - buffer was not created.");
+
+		bind();
+
+		glBufferSubData(target(), offset, size, data);
+	}
+
+	void destroy()
+	{
+		if (!valid()) throw std::runtime_error("Cannot destroy buffer - buffer was not created.");
+
+		glDeleteBuffers(1, &id_);
+
+		id_ = INVALID_ID;
+		size_ = 0;
+	}
+
+	GLuint id() const
+	{
+		return id_;
+	}
+
+	GLsizeiptr size() const
+	{
+		return size_;
+	}
+
+	GLenum target() const
+	{
+		return static_cast<const T*>(this)->target();
+	}
+
+	bool valid() const
+	{
+		return (id_ != INVALID_ID);
+	}
+
+	explicit operator bool() const
+	{
+		return valid();
+	}
+
+	bool operator==(const T& other) const
+	{
+		return id_ == other.id_;
+	}
+
+	bool operator!=(const T& other) const
+	{
+		return id_ != other.id_;
+	}
+
+	friend std::ostream& operator<<(std::ostream& os, const T& other)
+	{
+		os << "Id: " << other.id_ << ", Target: " << other.target() << ", Size: " << other.size_;
+		return os;
+	}
+
+	static constexpr GLuint INVALID_ID = 0;
+
+protected:
+	~Buffer()
+	{
+		if (valid())
+		{
+			destroy();
+		}
+	}
+
+	GLuint id_ = INVALID_ID;
+	GLsizeiptr size_ = 0;
+};
+
+}
+}
+}
+}
+
+#endif /* BUFFER_H_ */
@@ -0,0 +1,36 @@
+#ifndef ELEMENTARRAYBUFFER_H_
+#define ELEMENTARRAYBUFFER_H_
+
+#include "Buffer.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl
+{
+
+class ElementArrayBuffer : public Buffer<ElementArrayBuffer>
+{
+public:
+	using Buffer<ElementArrayBuffer>::Buffer;
+
+	GLenum target() const
+	{
+		return GL_ELEMENT_ARRAY_BUFFER;
+	}
+
+	static void unbind()
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+};
+
+}
+}
+}
+}
+
+#endif /* ELEMENTARRAYBUFFER_H_ */
@@ -1,12 +1,19 @@
 #ifndef PROGRAM_H_
 #define PROGRAM_H_
 
+#include <algorithm>
 #include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
 
 #include <GL/glew.h>
 
 #include "OpenGl.hpp"
 
+#include "Types.hpp"
+
 namespace ice_engine
 {
 namespace graphics
@@ -37,6 +44,29 @@ inline std::string getShaderProgramErrorMessage(const GLuint program)
 	return message.str();
 }
 
+/**
+ * Returns the 64 bit FNV-1a hash of the given null terminated name.
+ *
+ * This is constexpr so that uniform and uniform block names used in the render loop can be hashed at compile time.
+ *
+ * @param name
+ *
+ * @return The 64 bit FNV-1a hash of the given name.
+ */
+constexpr uint64 hashName(const char* name)
+{
+	uint64 hash = 14695981039346656037ull;
+
+	while (*name != '\0')
+	{
+		hash ^= static_cast<uint64>(static_cast<unsigned char>(*name));
+		hash *= 1099511628211ull;
+		++name;
+	}
+
+	return hash;
+}
+
 template <typename T>
 class Program
 {
@@ -62,11 +92,18 @@ public:
 		link(vertexShader, tessellationControlShader, tessellationEvaluationShader, fragmentShader);
 	}
 	
+	Program(const VertexShader& vertexShader, const std::vector<std::string>& transformFeedbackVaryings)
+	{
+		link(vertexShader, transformFeedbackVaryings);
+	}
+	
 	Program(const Program& other) = delete;
 	
 	Program(Program&& other)
 	{
 		this->id_ = other.id_;
+		this->uniformLocations_ = std::move(other.uniformLocations_);
+		this->uniformBlockIndices_ = std::move(other.uniformBlockIndices_);
 		
 		other.id_ = INVALID_ID;
 	}
@@ -108,6 +145,8 @@ public:
 				throw std::runtime_error(message.str());
 			}
 			
+			reflect();
+			
 			ASSERT_GL_ERROR();
 		}
 		catch (const std::exception& e)
@@ -155,6 +194,60 @@ public:
 				throw std::runtime_error(message.str());
 			}
 			
+			reflect();
+			
+			ASSERT_GL_ERROR();
+		}
+		catch (const std::exception& e)
+		{
+			// Cleanup
+			destroy();
+			
+			throw e;
+		}
+	}
+	
+	/**
+	 * Links a program without fragment shader that captures the given vertex shader outputs, interleaved in the given
+	 * order, into the transform feedback buffer.
+	 */
+	void link(const VertexShader& vertexShader, const std::vector<std::string>& transformFeedbackVaryings)
+	{
+		if (valid()) throw std::runtime_error("Cannot link program - program must be destroyed first.");
+		
+		id_ = glCreateProgram();
+		
+		if (id_ == INVALID_ID)
+		{
+			throw std::runtime_error("Could not create program.");
+		}
+		
+		try
+		{
+			std::vector<const GLchar*> varyings;
+			for (const auto& varying : transformFeedbackVaryings)
+			{
+				varyings.push_back(varying.c_str());
+			}
+			
+			glAttachShader(id_, vertexShader);
+			glTransformFeedbackVaryings(id_, static_cast<GLsizei>(varyings.size()), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+			glLinkProgram(id_);
+			
+			GLint compiled = GL_FALSE;
+			glGetProgramiv(id_, GL_LINK_STATUS, &compiled);
+			
+			if (!compiled)
+			{
+				std::stringstream message;
+				message << "Could not link program: ";
+				message << "\n" << getShaderProgramErrorMessage(id_);
+				
+				throw std::runtime_error(message.str());
+			}
+			
+			reflect();
+			
 			ASSERT_GL_ERROR();
 		}
 		catch (const std::exception& e)
@@ -180,6 +273,49 @@ public:
 		glDeleteProgram(id_);
 		
 		id_ = INVALID_ID;
+		uniformLocations_.clear();
+		uniformBlockIndices_.clear();
+	}
+	
+	/**
+	 * Returns the location of the active uniform with the given name hash (see hashName), or -1 if the program has no
+	 * such active uniform.
+	 *
+	 * Locations are reflected once when the program is linked, so this never queries the driver.
+	 */
+	GLint uniformLocation(const uint64 nameHash) const
+	{
+		const auto it = uniformLocations_.find(nameHash);
+		
+		return (it != uniformLocations_.end() ? it->second : -1);
+	}
+	
+	/**
+	 * Returns the index of the active uniform block with the given name hash (see hashName), or GL_INVALID_INDEX if the
+	 * program has no such active uniform block.
+	 */
+	GLuint uniformBlockIndex(const uint64 nameHash) const
+	{
+		const auto it = uniformBlockIndices_.find(nameHash);
+		
+		return (it != uniformBlockIndices_.end() ? it->second : GL_INVALID_INDEX);
+	}
+
+	/**
+	 * Assigns the uniform block with the given name hash to the given binding point.
+	 *
+	 * Does nothing if this program does not use the uniform block.
+	 */
+	void uniformBlockBinding(const uint64 nameHash, const GLuint binding)
+	{
+		if (!valid()) throw std::runtime_error("Cannot set uniform block binding - program was not created.");
+
+		const GLuint index = uniformBlockIndex(nameHash);
+
+		if (index != GL_INVALID_INDEX)
+		{
+			glUniformBlockBinding(id_, index, binding);
+		}
 	}
 
 	GLuint id() const
@@ -226,6 +362,80 @@ protected:
 
 private:
 	GLuint id_ = INVALID_ID;
+	std::unordered_map<uint64, GLint> uniformLocations_;
+	std::unordered_map<uint64, GLuint> uniformBlockIndices_;
+	
+	void addUniformLocation(const std::string& name, const GLint location)
+	{
+		const auto result = uniformLocations_.emplace(hashName(name.c_str()), location);
+		
+		if (!result.second && result.first->second != location)
+		{
+			throw std::runtime_error("Could not reflect program - uniform name hash collision for uniform '" + name + "'.");
+		}
+	}
+	
+	/**
+	 * Caches the locations of all active uniforms and the indices of all active uniform blocks.
+	 *
+	 * Arrays are registered both by their reported name (i.e. "name[0]") and their base name, and every element of an
+	 * array of basic types is registered as "name[i]".
+	 */
+	void reflect()
+	{
+		uniformLocations_.clear();
+		uniformBlockIndices_.clear();
+		
+		GLint numActiveUniforms = 0;
+		GLint maxUniformNameLength = 0;
+		glGetProgramiv(id_, GL_ACTIVE_UNIFORMS, &numActiveUniforms);
+		glGetProgramiv(id_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxUniformNameLength);
+		
+		std::vector<GLchar> nameBuffer(static_cast<size_t>(std::max(maxUniformNameLength, 1)));
+		
+		for (GLint i = 0; i < numActiveUniforms; ++i)
+		{
+			GLint size = 0;
+			GLenum type = GL_NONE;
+			glGetActiveUniform(id_, static_cast<GLuint>(i), static_cast<GLsizei>(nameBuffer.size()), nullptr, &size, &type, &nameBuffer[0]);
+			
+			const std::string name(&nameBuffer[0]);
+			const GLint location = glGetUniformLocation(id_, name.c_str());
+			
+			// Uniforms inside of uniform blocks do not have a location
+			if (location < 0) continue;
+			
+			addUniformLocation(name, location);
+			
+			const auto arraySuffix = name.rfind("[0]");
+			if (arraySuffix != std::string::npos && arraySuffix + 3 == name.size())
+			{
+				const std::string baseName = name.substr(0, arraySuffix);
+				
+				addUniformLocation(baseName, location);
+				
+				for (GLint j = 1; j < size; ++j)
+				{
+					const std::string elementName = baseName + "[" + std::to_string(j) + "]";
+					addUniformLocation(elementName, glGetUniformLocation(id_, elementName.c_str()));
+				}
+			}
+		}
+		
+		GLint numActiveUniformBlocks = 0;
+		GLint maxUniformBlockNameLength = 0;
+		glGetProgramiv(id_, GL_ACTIVE_UNIFORM_BLOCKS, &numActiveUniformBlocks);
+		glGetProgramiv(id_, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxUniformBlockNameLength);
+		
+		nameBuffer.resize(static_cast<size_t>(std::max(maxUniformBlockNameLength, 1)));
+		
+		for (GLint i = 0; i < numActiveUniformBlocks; ++i)
+		{
+			glGetActiveUniformBlockName(id_, static_cast<GLuint>(i), static_cast<GLsizei>(nameBuffer.size()), nullptr, &nameBuffer[0]);
+			
+			uniformBlockIndices_[hashName(&nameBuffer[0])] = static_cast<GLuint>(i);
+		}
+	}
 };
 
 }
@@ -63,6 +63,11 @@ public:
 	{
 		glTexParameteri(GL_TEXTURE_2D, pname, param);
 	}
+	
+	static void texImage2D(const GLint level, const GLint internalFormat, const GLsizei width, const GLsizei height, const GLenum format, const GLenum type, const GLvoid* data)
+	{
+		glTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, format, type, data);
+	}
 };
 
 }
@@ -64,6 +64,16 @@ public:
 		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, depth, width, height, 1, format, type, data);
 	}
 	
+	static void texSubImage3D(const GLint level, const GLsizei width, const GLsizei height, const GLsizei depth, const GLenum format, const GLenum type, const GLvoid* data)
+	{
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, depth, width, height, 1, format, type, data);
+	}
+	
+	static void texImage3D(const GLint level, const GLint internalFormat, const GLsizei width, const GLsizei height, const GLsizei depth, const GLenum format, const GLenum type, const GLvoid* data = nullptr)
+	{
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, width, height, depth, 0, format, type, data);
+	}
+	
 	static void texParameter(const GLenum pname, GLint param)
 	{
 		glTexParameteri(GL_TEXTURE_2D_ARRAY, pname, param);
@@ -0,0 +1,84 @@
+#ifndef TEXTUREBUFFER_H_
+#define TEXTUREBUFFER_H_
+
+#include <ostream>
+
+#include <GL/glew.h>
+#include "graphics/exceptions/GraphicsException.hpp"
+
+#include "OpenGl.hpp"
+#include "Texture.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl
+{
+
+class TextureBuffer : public Texture<TextureBuffer>
+{
+public:
+	using Texture<TextureBuffer>::Texture;
+
+	void generate()
+	{
+		if (valid()) throw std::runtime_error("Cannot generate texture buffer - texture buffer was already created.");
+
+		glGenTextures(1, &id_);
+
+		if (id_ == INVALID_ID)
+		{
+            const auto e = getGlError();
+			throw GraphicsException(std::string("Could not create texture buffer: ") + e->codeString);
+		}
+
+		numTextures_ = 1;
+	}
+
+	/**
+	 * Makes the texels of the texture buffer the contents of the given buffer object.
+	 */
+	void buffer(const GLenum internalFormat, const GLuint buffer)
+	{
+		bind();
+
+		glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, buffer);
+
+		ASSERT_GL_ERROR();
+	}
+
+	/**
+	 * Makes the texels of the texture buffer size bytes of the given buffer object, starting at offset. Requires
+	 * ARB_texture_buffer_range, offset must be a multiple of GL_TEXTURE_BUFFER_OFFSET_ALIGNMENT.
+	 */
+	void buffer(const GLenum internalFormat, const GLuint buffer, const GLintptr offset, const GLsizeiptr size)
+	{
+		bind();
+
+		glTexBufferRange(GL_TEXTURE_BUFFER, internalFormat, buffer, offset, size);
+
+		ASSERT_GL_ERROR();
+	}
+
+	void bind()
+	{
+		if (!valid()) throw std::runtime_error("Cannot bind texture buffer - texture buffer was not created.");
+
+		glBindTexture(GL_TEXTURE_BUFFER, id_);
+	}
+
+	static void activate(const GLuint number)
+	{
+		glActiveTexture(GL_TEXTURE0 + number);
+	}
+};
+
+}
+}
+}
+}
+
+#endif /* TEXTUREBUFFER_H_ */
@@ -0,0 +1,45 @@
+#ifndef UNIFORMBUFFER_H_
+#define UNIFORMBUFFER_H_
+
+#include "Buffer.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl
+{
+
+class UniformBuffer : public Buffer<UniformBuffer>
+{
+public:
+	using Buffer<UniformBuffer>::Buffer;
+
+	void bindBase(const GLuint index)
+	{
+		if (!valid()) throw std::runtime_error("Cannot bind uniform buffer - uniform buffer was not created.");
+
+		glBindBufferBase(GL_UNIFORM_BUFFER, index, id_);
+	}
+
+	void bindRange(const GLuint index, const GLintptr offset, const GLsizeiptr size)
+	{
+		if (!valid()) throw std::runtime_error("Cannot bind uniform buffer - uniform buffer was not created.");
+
+		glBindBufferRange(GL_UNIFORM_BUFFER, index, id_, offset, size);
+	}
+
+	GLenum target() const
+	{
+		return GL_UNIFORM_BUFFER;
+	}
+};
+
+}
+}
+}
+}
+
+#endif /* UNIFORMBUFFER_H_ */
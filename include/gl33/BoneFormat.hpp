@@ -0,0 +1,61 @@
+#ifndef BONEFORMAT_GL33_H_
+#define BONEFORMAT_GL33_H_
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * How bone transformations are stored in the bone palette texture buffer. Must match boneFormat in skinning.glsl.
+ */
+enum class BoneFormat : uint8
+{
+	/**
+	 * The four columns of the matrix (64 bytes per bone).
+	 */
+	MAT4 = 0,
+
+	/**
+	 * The first three rows of an affine matrix (48 bytes per bone).
+	 */
+	MAT3X4,
+
+	/**
+	 * A unit dual quaternion, real part first (32 bytes per bone). Only rotation and translation are kept, scale is
+	 * dropped. Blended with dual quaternion linear blending, which avoids the candy wrapper artifacts of blending matrices.
+	 */
+	DUAL_QUATERNION
+};
+
+/**
+ * The name of the format, as graphics.boneFormat spells it.
+ */
+const char* boneFormatName(const BoneFormat boneFormat);
+
+/**
+ * The number of RGBA32F texels one bone occupies.
+ */
+uint32 texelsPerBone(const BoneFormat boneFormat);
+
+/**
+ * Appends count bones, converted to the given format, to texels.
+ */
+void packBones(const glm::mat4* bones, const size_t count, const BoneFormat boneFormat, std::vector<glm::vec4>& texels);
+
+}
+}
+}
+}
+
+#endif /* BONEFORMAT_GL33_H_ */
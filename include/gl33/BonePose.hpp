@@ -0,0 +1,47 @@
+#ifndef BONEPOSE_GL33_H_
+#define BONEPOSE_GL33_H_
+
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * A bone transformation split into translation, rotation and scale, so poses can be interpolated without the scaling
+ * and shearing that blending rotation matrices componentwise introduces. Shear in the original matrix is lost.
+ */
+struct BonePose
+{
+	glm::vec3 translation = glm::vec3(0.0f);
+	glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::vec3 scale = glm::vec3(1.0f);
+};
+
+/**
+ * Replaces the contents of poses with count decomposed bones.
+ */
+void decomposeBones(const glm::mat4* bones, const size_t count, std::vector<BonePose>& poses);
+
+/**
+ * Replaces the contents of bones with the poses from to interpolated by t: translation and scale linearly, rotation
+ * spherically along the shortest arc. from and to must have the same size.
+ */
+void interpolateBones(const std::vector<BonePose>& from, const std::vector<BonePose>& to, const float32 t, std::vector<glm::mat4>& bones);
+
+}
+}
+}
+}
+
+#endif /* BONEPOSE_GL33_H_ */
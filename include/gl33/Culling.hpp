@@ -0,0 +1,83 @@
+#ifndef CULLING_GL33_H_
+#define CULLING_GL33_H_
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+struct BoundingSphere
+{
+	glm::vec3 center = glm::vec3(0.0f);
+	float32 radius = 0.0f;
+};
+
+/**
+ * Six normalized planes (left, right, bottom, top, near, far) with normals pointing into the frustum.
+ */
+struct Frustum
+{
+	glm::vec4 planes[6];
+};
+
+/**
+ * Extracts the frustum planes from a view-projection matrix (Gribb/Hartmann).
+ */
+Frustum frustum(const glm::mat4& viewProjection);
+
+/**
+ * Computes a bounding sphere centered on the axis aligned bounding box of the given vertices.
+ */
+BoundingSphere boundingSphere(const std::vector<glm::vec3>& vertices);
+
+/**
+ * Transforms the bounding sphere by the given model matrix, growing the radius by the largest axis scale.
+ */
+BoundingSphere transformBoundingSphere(const BoundingSphere& sphere, const glm::mat4& modelMatrix);
+
+bool intersects(const Frustum& frustum, const BoundingSphere& sphere);
+
+/**
+ * World-space bounding spheres stored as a structure of arrays, so they can be tested against a frustum four at
+ * a time with SSE.
+ */
+class BoundingSphereList
+{
+public:
+	BoundingSphereList() = default;
+
+	void clear();
+	void push(const BoundingSphere& sphere);
+	uint32 size() const;
+	BoundingSphere sphere(const uint32 index) const;
+
+	/**
+	 * Tests every sphere against the frustum, setting visible[i] to 1 if sphere i intersects it and 0 otherwise.
+	 */
+	void cull(const Frustum& frustum, std::vector<uint8>& visible) const;
+
+private:
+	// Padded to a multiple of 4 with zero sized spheres
+	std::vector<float32> x_;
+	std::vector<float32> y_;
+	std::vector<float32> z_;
+	std::vector<float32> radius_;
+	uint32 size_ = 0;
+};
+
+}
+}
+}
+}
+
+#endif /* CULLING_GL33_H_ */
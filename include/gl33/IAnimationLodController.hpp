@@ -0,0 +1,83 @@
+#ifndef IANIMATIONLODCONTROLLER_GL33_H_
+#define IANIMATIONLODCONTROLLER_GL33_H_
+
+#include "graphics/IGraphicsEngine.hpp"
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * How often the bones of a skinned renderable accept new transformations, by the projected height of its bounds.
+ */
+enum class AnimationLodLevel : uint8
+{
+	// Every update is taken
+	FULL = 0,
+
+	// One update every reducedUpdateInterval frames is taken, the frames in between are interpolated
+	REDUCED,
+
+	// Updates are stored but not drawn, also used for bones that were not drawn in the last frame
+	FROZEN
+};
+
+/**
+ * Animation LOD policy of a skinned renderable. Heights are in pixels. Setting both heights to 0 always updates.
+ */
+struct AnimationLod
+{
+	uint32 reducedHeight = 150;
+	uint32 frozenHeight = 20;
+	uint32 reducedUpdateInterval = 4;
+};
+
+/**
+ * Animation LOD of skinned renderables, for engines created by this renderer. Query it from an engine with
+ * animationLodController().
+ */
+class IAnimationLodController
+{
+public:
+	virtual ~IAnimationLodController() = default;
+
+	/**
+	 * Sets the animation LOD policy of a skinned renderable. Bones shared by several renderables follow the most
+	 * detailed of them.
+	 */
+	virtual void animationLod(const RenderSceneHandle& renderSceneHandle, const RenderableHandle& renderableHandle, const AnimationLod& animationLod) = 0;
+
+	/**
+	 * Returns the animation LOD level the bones were drawn with in the last frame.
+	 */
+	virtual AnimationLodLevel animationLodLevel(const BonesHandle& bonesHandle) const = 0;
+
+	/**
+	 * Returns true if transformations passed to IGraphicsEngine::update() would be drawn as they are. Callers can skip
+	 * evaluating the animations of bones that are not due; update() still stores transformations that are not due, so
+	 * bones coming into view are drawn with the last transformations passed.
+	 */
+	virtual bool animationUpdateDue(const BonesHandle& bonesHandle) const = 0;
+};
+
+/**
+ * @return The animation LOD interface of graphicsEngine, or nullptr if graphicsEngine was not created by this renderer.
+ */
+inline IAnimationLodController* animationLodController(IGraphicsEngine* graphicsEngine)
+{
+	return dynamic_cast<IAnimationLodController*>(graphicsEngine);
+}
+
+}
+}
+}
+}
+
+#endif /* IANIMATIONLODCONTROLLER_GL33_H_ */
@@ -0,0 +1,71 @@
+#ifndef IDEBUGLINERENDERER_GL33_H_
+#define IDEBUGLINERENDERER_GL33_H_
+
+#include <glm/glm.hpp>
+
+#include "graphics/IGraphicsEngine.hpp"
+
+#include "LineBatcher.hpp"
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * Debug line drawing beyond what IGraphicsEngine offers, for engines created by this renderer. Query it from an engine
+ * with debugLineRenderer().
+ *
+ * Everything submitted is drawn as lines in endRender(), along with IGraphicsEngine::renderLine() and renderLines().
+ */
+class IDebugLineRenderer
+{
+public:
+	virtual ~IDebugLineRenderer() = default;
+
+	virtual void renderBox(const glm::vec3& minimum, const glm::vec3& maximum, const glm::vec3& color) = 0;
+	virtual void renderSphere(const glm::vec3& center, const float32 radius, const glm::vec3& color) = 0;
+	virtual void renderFrustum(const glm::mat4& viewProjection, const glm::vec3& color) = 0;
+
+	/**
+	 * Copies already packed line vertices, two per line, directly into GPU memory. Use packLineColor() for the colors.
+	 *
+	 * The vertices can be reused as soon as this returns.
+	 */
+	virtual void renderLines(const LineVertex* vertices, const size_t vertexCount, const LineStyle& lineStyle) = 0;
+
+	/**
+	 * Reserves room for vertexCount line vertices in GPU memory and returns where to write them, so vertices produced
+	 * one by one, i.e. by a physics debug drawer, need no buffer of their own.
+	 *
+	 * The memory is write only and must not be read. No other call may be made to the renderer until commitLines().
+	 */
+	virtual LineVertex* reserveLines(const size_t vertexCount, const LineStyle& lineStyle) = 0;
+
+	/**
+	 * Ends the write started by reserveLines(). The first vertexCount reserved vertices are drawn, which may be fewer
+	 * than were reserved.
+	 */
+	virtual void commitLines(const size_t vertexCount) = 0;
+};
+
+/**
+ * @return The debug line interface of graphicsEngine, or nullptr if graphicsEngine was not created by this renderer.
+ */
+inline IDebugLineRenderer* debugLineRenderer(IGraphicsEngine* graphicsEngine)
+{
+	return dynamic_cast<IDebugLineRenderer*>(graphicsEngine);
+}
+
+}
+}
+}
+}
+
+#endif /* IDEBUGLINERENDERER_GL33_H_ */
@@ -0,0 +1,62 @@
+#ifndef IRENDERSTATISTICSPROVIDER_GL33_H_
+#define IRENDERSTATISTICSPROVIDER_GL33_H_
+
+#include "graphics/IGraphicsEngine.hpp"
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * Counters for the work submitted to OpenGL during the current frame. They are reset in beginRender().
+ */
+struct RenderStatistics
+{
+	uint32 drawCalls = 0;
+	uint32 instances = 0;
+	uint32 vertexArrayBinds = 0;
+	uint32 textureBinds = 0;
+	uint32 uniformBufferBinds = 0;
+	uint32 bindsAvoided = 0;
+	uint32 culled = 0;
+	uint32 skinnedVertices = 0;
+	uint32 terrainTileBytesUploaded = 0;
+	uint32 textureBytesUploaded = 0;
+};
+
+/**
+ * Per frame counters of engines created by this renderer. Query it from an engine with renderStatisticsProvider().
+ */
+class IRenderStatisticsProvider
+{
+public:
+	virtual ~IRenderStatisticsProvider() = default;
+
+	/**
+	 * Returns the draw call and state change counters for the frame currently being rendered.
+	 */
+	virtual const RenderStatistics& renderStatistics() const = 0;
+};
+
+/**
+ * @return The render statistics interface of graphicsEngine, or nullptr if graphicsEngine was not created by this
+ * renderer.
+ */
+inline IRenderStatisticsProvider* renderStatisticsProvider(IGraphicsEngine* graphicsEngine)
+{
+	return dynamic_cast<IRenderStatisticsProvider*>(graphicsEngine);
+}
+
+}
+}
+}
+}
+
+#endif /* IRENDERSTATISTICSPROVIDER_GL33_H_ */
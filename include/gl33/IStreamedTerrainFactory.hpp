@@ -0,0 +1,56 @@
+#ifndef ISTREAMEDTERRAINFACTORY_GL33_H_
+#define ISTREAMEDTERRAINFACTORY_GL33_H_
+
+#include <string>
+
+#include "graphics/IGraphicsEngine.hpp"
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * Terrain streamed from disk, for engines created by this renderer. Query it from an engine with
+ * streamedTerrainFactory().
+ *
+ * Streamed terrain is used through its TerrainHandle like any other terrain, and destroyed with
+ * IGraphicsEngine::destroy().
+ */
+class IStreamedTerrainFactory
+{
+public:
+	virtual ~IStreamedTerrainFactory() = default;
+
+	/**
+	 * Creates terrain from a TerrainTileFile. Its height, normal and terrain map data is read from disk on a worker
+	 * thread as the camera approaches, and the area without resident tiles is drawn from the overview of the file. The
+	 * material images of splatMap are uploaded right away, its terrain map is not used.
+	 *
+	 * @throws FileNotFoundException If filename does not exist.
+	 * @throws InvalidArgumentException If filename is not a valid terrain tile file.
+	 */
+	virtual TerrainHandle createStreamedTerrain(const std::string& filename, const ISplatMap& splatMap) = 0;
+};
+
+/**
+ * @return The streamed terrain interface of graphicsEngine, or nullptr if graphicsEngine was not created by this
+ * renderer.
+ */
+inline IStreamedTerrainFactory* streamedTerrainFactory(IGraphicsEngine* graphicsEngine)
+{
+	return dynamic_cast<IStreamedTerrainFactory*>(graphicsEngine);
+}
+
+}
+}
+}
+}
+
+#endif /* ISTREAMEDTERRAINFACTORY_GL33_H_ */
@@ -0,0 +1,66 @@
+#ifndef ITRANSFORMBATCHER_GL33_H_
+#define ITRANSFORMBATCHER_GL33_H_
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "graphics/IGraphicsEngine.hpp"
+
+#include "StridedSpan.hpp"
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * Batched transform updates beyond what IGraphicsEngine offers, for engines created by this renderer. Query it from an
+ * engine with transformBatcher().
+ */
+class ITransformBatcher
+{
+public:
+	virtual ~ITransformBatcher() = default;
+
+	/**
+	 * Sets the transforms of many renderables of a render scene in a single call.
+	 *
+	 * Element i of each non empty span belongs to renderableHandles[i]. Pass an empty span to leave that component
+	 * unchanged. The spans are strided, so the data can be read directly out of the caller's own per body structures.
+	 *
+	 * The renderable handles are only validated in debug builds, so the call costs no lookups beyond the transform slot
+	 * of each renderable. In release builds a stale or destroyed handle writes to whichever renderable reuses its slot.
+	 *
+	 * @throws InvalidArgumentException If a non empty span has a different size than renderableHandles, or, in debug
+	 * builds, if a renderable handle is invalid.
+	 */
+	virtual void transforms(
+		const RenderSceneHandle& renderSceneHandle,
+		const StridedSpan<RenderableHandle>& renderableHandles,
+		const StridedSpan<glm::vec3>& positions,
+		const StridedSpan<glm::quat>& orientations = StridedSpan<glm::quat>(),
+		const StridedSpan<glm::vec3>& scales = StridedSpan<glm::vec3>()
+	) = 0;
+};
+
+/**
+ * @return The batched transform interface of graphicsEngine, or nullptr if graphicsEngine was not created by this
+ * renderer.
+ */
+inline ITransformBatcher* transformBatcher(IGraphicsEngine* graphicsEngine)
+{
+	return dynamic_cast<ITransformBatcher*>(graphicsEngine);
+}
+
+}
+}
+}
+}
+
+#endif /* ITRANSFORMBATCHER_GL33_H_ */
@@ -0,0 +1,136 @@
+#ifndef LINEBATCHER_GL33_H_
+#define LINEBATCHER_GL33_H_
+
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "StreamingBuffer.hpp"
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * A line vertex as read by line.vert. color is RGBA8, red in the lowest byte.
+ */
+struct LineVertex
+{
+	glm::vec3 position;
+	uint32 color;
+};
+
+static_assert(sizeof(LineVertex) == 16, "LineVertex must be tightly packed");
+
+uint32 packLineColor(const glm::vec3& color);
+
+struct LineStyle
+{
+	bool depthTest = true;
+
+	/**
+	 * Clamped to the aliased line width range of the driver, core profile drivers may only support 1.
+	 */
+	float32 width = 1.0f;
+};
+
+/**
+ * Accumulates debug lines and shapes over a frame and draws them all with a single draw call, plus one draw call per
+ * span of packed vertices submitted through lines().
+ *
+ * The vertex storage keeps its capacity between frames, so batching does not allocate once the largest frame has
+ * been seen.
+ */
+class LineBatcher
+{
+public:
+	LineBatcher() = default;
+	LineBatcher(const LineBatcher& other) = delete;
+	LineBatcher& operator=(const LineBatcher& other) = delete;
+	~LineBatcher();
+
+	void generate();
+	void destroy();
+
+	void line(const glm::vec3& from, const glm::vec3& to, const glm::vec3& color);
+	void box(const glm::vec3& minimum, const glm::vec3& maximum, const glm::vec3& color);
+
+	/**
+	 * Adds the three axis aligned great circles of a sphere.
+	 */
+	void sphere(const glm::vec3& center, const float32 radius, const glm::vec3& color, const uint32 segments = 16);
+
+	/**
+	 * Adds the twelve edges of the frustum of the given view-projection matrix.
+	 */
+	void frustum(const glm::mat4& viewProjection, const glm::vec3& color);
+
+	/**
+	 * Copies vertexCount vertices, two per line, straight into the streaming buffer. They are drawn with the given
+	 * style when the batch is flushed.
+	 */
+	void lines(const LineVertex* vertices, const size_t vertexCount, const LineStyle& lineStyle, StreamingBuffer& streamingBuffer);
+
+	/**
+	 * Maps room for vertexCount vertices in the streaming buffer and returns where to write them. The streaming buffer
+	 * stays mapped until commitLines().
+	 */
+	LineVertex* reserveLines(const size_t vertexCount, const LineStyle& lineStyle, StreamingBuffer& streamingBuffer);
+
+	/**
+	 * Unmaps the vertices of reserveLines() and draws the first vertexCount of them, two per line, with the reserved
+	 * style when the batch is flushed.
+	 */
+	void commitLines(const size_t vertexCount, StreamingBuffer& streamingBuffer);
+
+	/**
+	 * Uploads the accumulated lines, draws them and everything submitted through lines(), and starts a new batch. The
+	 * line shader program must be in use.
+	 *
+	 * @return The number of draw calls issued.
+	 */
+	uint32 flush(StreamingBuffer& streamingBuffer);
+
+	bool empty() const;
+	bool valid() const;
+
+private:
+	struct LineDraw
+	{
+		StreamingAllocation allocation;
+		GLsizei vertexCount = 0;
+		LineStyle lineStyle;
+	};
+
+	GLuint vertexArray_ = 0;
+	GLfloat lineWidthRange_[2] = {1.0f, 1.0f};
+
+	// Lines added one by one, drawn with the default style
+	std::vector<LineVertex> vertices_;
+
+	// Spans already in the streaming buffer
+	std::vector<LineDraw> lineDraws_;
+
+	// Span being written between reserveLines() and commitLines()
+	LineDraw reservation_;
+	bool reserved_ = false;
+
+	void line(const glm::vec3& from, const glm::vec3& to, const uint32 color);
+	void draw(const LineDraw& lineDraw);
+};
+
+}
+}
+}
+}
+
+#endif /* LINEBATCHER_GL33_H_ */
@@ -0,0 +1,40 @@
+#ifndef MATERIALPACKING_GL33_H_
+#define MATERIALPACKING_GL33_H_
+
+#include "WorkerPool.hpp"
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * Packs the metalness, roughness and ambient occlusion images of a material into one RGBA8 image: red is metalness,
+ * green roughness, blue ambient occlusion and alpha is zero. Each channel is the average of the red, green and blue
+ * channels of its RGBA8 source image, or 127 when the source is null.
+ *
+ * Rows are split into chunks packed on the threads of workerPool for images large enough to make it worthwhile. Does
+ * not touch OpenGL, so it is safe to call from any thread that is the only one using workerPool.
+ */
+void packMetalnessRoughnessAmbientOcclusion(
+	const byte* metalness,
+	const byte* roughness,
+	const byte* ambientOcclusion,
+	const uint32 width,
+	const uint32 height,
+	byte* texels,
+	WorkerPool& workerPool
+);
+
+}
+}
+}
+}
+
+#endif /* MATERIALPACKING_GL33_H_ */
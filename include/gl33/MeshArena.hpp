@@ -0,0 +1,191 @@
+#ifndef MESHARENA_GL33_H_
+#define MESHARENA_GL33_H_
+
+#include <map>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "../gl/ArrayBuffer.hpp"
+#include "../gl/ElementArrayBuffer.hpp"
+
+#include "VertexFormat.hpp"
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * First fit free list over a range of units. Neighbouring free blocks are merged when a block is freed.
+ */
+class RangeAllocator
+{
+public:
+	RangeAllocator() = default;
+	explicit RangeAllocator(const uint32 capacity);
+
+	/**
+	 * Returns the offset of a free block of the given size, or INVALID_OFFSET if there is none.
+	 */
+	uint32 allocate(const uint32 size);
+	void free(const uint32 offset, const uint32 size);
+
+	/**
+	 * Appends free space to the end of the range.
+	 */
+	void grow(const uint32 capacity);
+
+	uint32 capacity() const;
+	uint32 used() const;
+	uint32 largestFreeBlock() const;
+
+	static constexpr uint32 INVALID_OFFSET = 0xFFFFFFFFu;
+
+private:
+	// Offset to size of every free block
+	std::map<uint32, uint32> freeBlocks_;
+	uint32 capacity_ = 0;
+	uint32 used_ = 0;
+};
+
+/**
+ * Per vertex skinning data of meshes in a skinned arena.
+ */
+struct SkinVertex
+{
+	glm::ivec4 boneIds;
+	glm::vec4 boneWeights;
+};
+
+/**
+ * The location of a mesh inside of a MeshArena.
+ *
+ * Indices are relative to baseVertex. Index storage is allocated in 4 byte units, so 16 and 32 bit index ranges can
+ * share the index buffer.
+ */
+struct MeshAllocation
+{
+	uint32 baseVertex = 0;
+	uint32 vertexCount = 0;
+	uint32 firstIndexUnit = 0;
+	uint32 indexUnits = 0;
+	uint32 indexCount = 0;
+	GLenum indexType = GL_UNSIGNED_INT;
+	bool allocated = false;
+
+	GLintptr indexOffset() const
+	{
+		return static_cast<GLintptr>(firstIndexUnit) * 4;
+	}
+
+	/**
+	 * The offset of the first index in indices of indexType, as used by indirect draw commands.
+	 */
+	GLuint firstIndex() const
+	{
+		return firstIndexUnit * (indexType == GL_UNSIGNED_SHORT ? 2 : 1);
+	}
+};
+
+/**
+ * Large vertex and index buffers shared by every mesh of one vertex format, drawn through a single vertex array
+ * object with base vertex draws.
+ *
+ * Meshes are referred to by allocation ids, which stay the same when the arena grows or is defragmented.
+ */
+class MeshArena
+{
+public:
+	MeshArena() = default;
+	MeshArena(const MeshArena& other) = delete;
+	MeshArena& operator=(const MeshArena& other) = delete;
+	~MeshArena();
+
+	void generate(const VertexFormat vertexFormat, const bool skinned, const uint32 vertexCapacity, const uint32 indexCapacity);
+	void destroy();
+
+	/**
+	 * Reserves space for a mesh, growing the buffers if needed, and returns its allocation id.
+	 */
+	uint32 allocate(const uint32 vertexCount, const uint32 indexCount, const GLenum indexType);
+	void free(const uint32 allocation);
+
+	const MeshAllocation& allocation(const uint32 allocation) const;
+
+	/**
+	 * Uploads the vertices of an allocation. data holds allocation.vertexCount vertices of the arena's vertex format.
+	 */
+	void vertices(const uint32 allocation, const GLvoid* data);
+
+	/**
+	 * Uploads the skinning data of an allocation. data holds allocation.vertexCount SkinVertex.
+	 */
+	void skinVertices(const uint32 allocation, const GLvoid* data);
+
+	/**
+	 * Uploads the indices of an allocation. data holds allocation.indexCount indices of allocation.indexType.
+	 */
+	void indices(const uint32 allocation, const GLvoid* data);
+
+	/**
+	 * Copies the vertices and indices of an allocation into an allocation of the same size in another arena of the
+	 * same vertex format, on the GPU.
+	 */
+	void copy(const uint32 allocation, MeshArena& destination, const uint32 destinationAllocation);
+
+	/**
+	 * Returns the fraction of free vertex or index space, whichever is worse, that is not part of the largest free
+	 * block.
+	 */
+	float32 fragmentation() const;
+
+	/**
+	 * Moves all allocations to the front of new buffers, leaving a single free block at the end.
+	 */
+	void defragment();
+
+	GLuint id() const;
+
+	/**
+	 * The index buffer, which changes when the arena grows or is defragmented.
+	 */
+	GLuint indexBuffer() const;
+
+	VertexFormat vertexFormat() const;
+	bool skinned() const;
+	bool valid() const;
+
+private:
+	GLuint vertexArray_ = 0;
+	gl::ArrayBuffer vertexBuffer_;
+	gl::ArrayBuffer skinVertexBuffer_;
+	gl::ElementArrayBuffer indexBuffer_;
+
+	VertexFormat vertexFormat_ = VertexFormat::FLOAT;
+	bool skinned_ = false;
+	GLsizeiptr vertexSize_ = 0;
+
+	RangeAllocator vertexAllocator_;
+	RangeAllocator indexAllocator_;
+	std::vector<MeshAllocation> allocations_;
+	std::vector<uint32> freeAllocations_;
+
+	void reallocate(const uint32 vertexCapacity, const uint32 indexCapacity, const bool compact);
+	void setVertexAttributes();
+};
+
+}
+}
+}
+}
+
+#endif /* MESHARENA_GL33_H_ */
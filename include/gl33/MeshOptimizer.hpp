@@ -0,0 +1,139 @@
+#ifndef MESHOPTIMIZER_GL33_H_
+#define MESHOPTIMIZER_GL33_H_
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * Marks a vertex that was removed by optimizeMesh in the returned vertex remap.
+ */
+constexpr uint32 REMOVED_VERTEX = 0xFFFFFFFFu;
+
+struct VertexCacheStatistics
+{
+	/**
+	 * Average cache miss ratio: transformed vertices per triangle (0.5 is ideal for large regular meshes, 3 is worst).
+	 */
+	float32 acmr = 0.0f;
+
+	/**
+	 * Average transform to vertex ratio: transformed vertices per unique vertex (1 is ideal).
+	 */
+	float32 atvr = 0.0f;
+};
+
+/**
+ * Simulates a FIFO post-transform vertex cache of the given size over a triangle list.
+ */
+VertexCacheStatistics vertexCacheStatistics(const std::vector<uint32>& indices, const size_t vertexCount, const uint32 cacheSize = 16);
+
+/**
+ * Merges vertices whose attributes are bitwise identical and rewrites the indices to use the merged vertices.
+ *
+ * Attribute vectors are either empty or have one element per vertex.
+ *
+ * @return The index of the merged vertex for every original vertex.
+ */
+std::vector<uint32> weldVertices(
+	const std::vector<glm::vec3>& vertices,
+	const std::vector<glm::vec4>& colors,
+	const std::vector<glm::vec3>& normals,
+	const std::vector<glm::vec2>& textureCoordinates,
+	std::vector<uint32>& indices
+);
+
+/**
+ * Reorders triangles for post-transform vertex cache locality (Tom Forsyth, "Linear-Speed Vertex Cache Optimisation").
+ */
+void optimizeVertexCache(std::vector<uint32>& indices, const size_t vertexCount);
+
+/**
+ * Reorders clusters of triangles so that outward facing clusters come first, which reduces overdraw for most view
+ * directions (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+ *
+ * Clusters are split where the vertex cache would be cold anyway, so the vertex cache order is preserved. Run this
+ * after optimizeVertexCache.
+ */
+void optimizeOverdraw(std::vector<uint32>& indices, const std::vector<glm::vec3>& vertices, const uint32 cacheSize = 16);
+
+/**
+ * Renumbers vertices in the order in which the indices first reference them, so vertex fetches are sequential.
+ * Unreferenced vertices are dropped.
+ *
+ * @return The new index of every vertex, or REMOVED_VERTEX if it was dropped.
+ */
+std::vector<uint32> optimizeVertexFetch(std::vector<uint32>& indices, const size_t vertexCount);
+
+/**
+ * Moves every element of data to the index given by remap, dropping elements mapped to REMOVED_VERTEX.
+ */
+template <typename T>
+void remapVertices(std::vector<T>& data, const std::vector<uint32>& remap, const size_t newVertexCount)
+{
+	if (data.empty()) return;
+
+	std::vector<T> result(newVertexCount);
+
+	for (size_t i = 0; i < remap.size(); ++i)
+	{
+		if (remap[i] != REMOVED_VERTEX)
+		{
+			result[remap[i]] = data[i];
+		}
+	}
+
+	data.swap(result);
+}
+
+struct MeshOptimization
+{
+	/**
+	 * The final index of every original vertex, or REMOVED_VERTEX. Per vertex data supplied later (i.e. skeletons)
+	 * has to be remapped with this.
+	 */
+	std::vector<uint32> vertexRemap;
+
+	size_t originalVertexCount = 0;
+	size_t vertexCount = 0;
+	VertexCacheStatistics before;
+	VertexCacheStatistics after;
+};
+
+/**
+ * Runs vertex welding, vertex cache optimization, overdraw optimization and vertex fetch optimization on the given
+ * triangle list mesh, in place.
+ *
+ * Welding only compares the attributes given here, so it has to be skipped (weld set to false) for meshes that may get
+ * per vertex data later, like the bone ids and weights of a skeleton. The other steps only reorder vertices and drop
+ * unreferenced ones, which the vertex remap covers.
+ *
+ * Meshes that are not valid triangle lists (index count not a multiple of 3, out of range indices or attribute
+ * vectors with the wrong size) are left untouched and an identity remap is returned.
+ */
+MeshOptimization optimizeMesh(
+	std::vector<glm::vec3>& vertices,
+	std::vector<uint32>& indices,
+	std::vector<glm::vec4>& colors,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& textureCoordinates,
+	const bool weld = true
+);
+
+}
+}
+}
+}
+
+#endif /* MESHOPTIMIZER_GL33_H_ */
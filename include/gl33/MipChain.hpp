@@ -0,0 +1,65 @@
+#ifndef MIPCHAIN_GL33_H_
+#define MIPCHAIN_GL33_H_
+
+#include <vector>
+
+#include "WorkerPool.hpp"
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * Where one level of a mip chain is in the chain's data.
+ */
+struct MipLevel
+{
+	uint32 width = 0;
+	uint32 height = 0;
+	size_t offset = 0;
+	size_t size = 0;
+};
+
+/**
+ * Fills levels with the layout of a tightly packed mip chain of 8 bit images with the given number of channels: level 0
+ * first, then every level half the size of the previous one, rounded down, until 1 x 1.
+ *
+ * Images whose data is exactly this size already contain their mip chain.
+ *
+ * @return The size of the whole chain, in bytes.
+ */
+size_t mipChainLayout(const uint32 width, const uint32 height, const uint32 channels, std::vector<MipLevel>& levels);
+
+/**
+ * Generates the mip chain of image into chain, laid out as mipChainLayout() describes, with a 2 x 2 box filter. Along
+ * odd sizes the filter widens to 3 weighted taps, so the last row or column is not dropped.
+ *
+ * When gammaCorrect is set, the color channels are averaged after decoding them with the 2.2 gamma lighting.frag
+ * decodes albedo with, and encoded again afterwards. Alpha is always averaged as is.
+ *
+ * Rows of large levels are split over the threads of workerPool.
+ */
+void generateMipChain(
+	const byte* image,
+	const uint32 width,
+	const uint32 height,
+	const uint32 channels,
+	const bool gammaCorrect,
+	std::vector<byte>& chain,
+	std::vector<MipLevel>& levels,
+	WorkerPool& workerPool
+);
+
+}
+}
+}
+}
+
+#endif /* MIPCHAIN_GL33_H_ */
@@ -2,6 +2,9 @@
 #define OPENGLRENDERER_GL33_H_
 
 #include <string>
+#include <unordered_map>
+#include <chrono>
+#include <memory>
 
 #include <GL/glew.h>
 #include <SDL.h>
@@ -21,7 +24,35 @@
 #include "../gl/Texture2d.hpp"
 #include "../gl/Texture2dArray.hpp"
 #include "../gl/TextureCubeMap.hpp"
+#include "../gl/TextureBuffer.hpp"
 #include "../gl/FrameBuffer.hpp"
+#include "../gl/UniformBuffer.hpp"
+#include "../gl/ArrayBuffer.hpp"
+
+#include "RenderQueue.hpp"
+#include "Culling.hpp"
+#include "TransformStore.hpp"
+#include "StridedSpan.hpp"
+#include "VertexFormat.hpp"
+#include "BoneFormat.hpp"
+#include "BonePose.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshArena.hpp"
+#include "StreamingBuffer.hpp"
+#include "LineBatcher.hpp"
+#include "IDebugLineRenderer.hpp"
+#include "IRenderStatisticsProvider.hpp"
+#include "ITransformBatcher.hpp"
+#include "IAnimationLodController.hpp"
+#include "IStreamedTerrainFactory.hpp"
+#include "TerrainQuadtree.hpp"
+#include "TerrainPatch.hpp"
+#include "StreamedTerrain.hpp"
+#include "TerrainHeightNormal.hpp"
+#include "MaterialPacking.hpp"
+#include "TextureUploadQueue.hpp"
+#include "MipChain.hpp"
+#include "WorkerPool.hpp"
 
 #include "handles/HandleVector.hpp"
 #include "utilities/Properties.hpp"
@@ -39,29 +70,51 @@ namespace opengl_renderer
 namespace gl33
 {
 
-struct Vbo
-{
-	GLuint id;
-};
-
-struct Ebo
+struct Ubo
 {
 	GLuint id;
-	GLenum mode;
-	GLsizei count;
-	GLenum type;
 };
 
-struct Ubo
+/**
+ * The bone transformations of a BonesHandle. Palettes are packed into the bone palette texture buffer every frame, for
+ * the renderables that are drawn.
+ */
+struct BonePalette
 {
-	GLuint id;
+	std::vector<glm::mat4> transformations;
+
+	// The sample before transformations and transformations itself, decomposed. Reduced rate palettes are interpolated
+	// from the one towards the other
+	std::vector<BonePose> previousPoses;
+	std::vector<BonePose> poses;
+	uint32 sampleFrame = 0;
+
+	// Level of the most detailed renderable drawn with the bones in animationLodFrame
+	AnimationLodLevel animationLodLevel = AnimationLodLevel::FULL;
+	uint32 animationLodFrame = 0;
+	uint32 reducedUpdateInterval = 1;
+
+	// transformations in the bone format, reused until they change, and while the bones are frozen
+	std::vector<glm::vec4> packedTransformations;
+	bool packed = false;
+
+	// Where the palette was packed, in texels, valid if frame matches the render() call being built
+	uint32 frame = 0;
+	uint32 offset = 0;
 };
 
+/**
+ * A mesh, stored as an allocation in one of the mesh arenas.
+ */
 struct Vao
 {
-	GLuint id;
-	Vbo vbo[4];
-	Ebo ebo;
+	uint32 arena = 0;
+	uint32 allocation = 0;
+	GLenum mode = GL_TRIANGLES;
+	BoundingSphere boundingSphere;
+	VertexFormat vertexFormat = VertexFormat::FLOAT;
+	glm::vec3 positionScale = glm::vec3(1.0f);
+	glm::vec3 positionBias = glm::vec3(0.0f);
 };
 
 struct GraphicsData
@@ -73,18 +126,88 @@ struct GraphicsData
 
 struct Renderable
 {
-	Vao vao;
-	Ubo ubo;
+	MeshHandle meshHandle;
+	BonesHandle bonesHandle;
 	TextureHandle textureHandle;
 	MaterialHandle materialHandle;
-	GraphicsData graphicsData;
+	uint32 transformIndex = 0;
 	glm::ivec4 boneIds;
 	glm::vec4 boneWeights;
+	AnimationLod animationLod;
 
 	bool hasBones = false;
 	bool hasBoneAttachment = false;
 };
 
+/**
+ * Per-instance vertex attributes streamed for every instanced draw.
+ */
+struct InstanceData
+{
+	glm::mat4 modelMatrix;
+	glm::mat3 normalMatrix;
+
+	// First texel of the instance's bone palette, relative to the frame's bone palettes, or -1 without bones or when
+	// the mesh was already posed by the skinning stage
+	int32 bonePalette = -1;
+
+	// Bones a bone attachment follows, all weights are zero for other instances
+	glm::ivec4 boneAttachmentIds = glm::ivec4(0);
+	glm::vec4 boneAttachmentWeights = glm::vec4(0.0f);
+};
+
+/**
+ * A run of renderables that share mesh and textures, drawn with a single instanced draw call.
+ */
+struct InstanceBatch
+{
+	const Renderable* renderable = nullptr;
+	const Vao* vao = nullptr;
+	uint32 firstInstance = 0;
+	uint32 instanceCount = 0;
+
+	// First of the frame's posed vertices the batch is drawn from, or -1 if it is drawn from its mesh arena
+	int32 posedBaseVertex = -1;
+};
+
+/**
+ * A skinned mesh posed by a bone palette, skinned once per frame into the frame's posed vertices.
+ */
+struct SkinningJob
+{
+	const Vao* vao = nullptr;
+	int32 bonePalette = 0;
+	uint32 firstVertex = 0;
+};
+
+/**
+ * Layout of a command in the draw indirect buffer, as defined by ARB_draw_indirect.
+ */
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+/**
+ * A run of instance batches that only differ in mesh and instance data, submitted with a single
+ * glMultiDrawElementsIndirect call. Every batch reads its instances through baseInstance, so the instance
+ * attributes point at the start of the frame's instance data.
+ *
+ * Without multi draw indirect support every run holds a single instance batch.
+ */
+struct MultiDrawBatch
+{
+	uint32 firstInstanceBatch = 0;
+	uint32 instanceBatchCount = 0;
+	uint32 instanceCount = 0;
+	uint32 firstCommand = 0;
+	GLenum indexType = GL_UNSIGNED_INT;
+};
+
 struct TerrainRenderable
 {
 	Vao vao;
@@ -95,13 +218,23 @@ struct TerrainRenderable
 
 struct Terrain
 {
+	// Only the bounds are used, the terrain is drawn in chunks of the shared terrain patch
 	Vao vao;
 	uint32 width = 0;
 	uint32 height = 0;
+
+	// Height of the full range of the height map
+	float32 heightScale = 0.0f;
+	TerrainQuadtree quadtree;
 	TextureHandle textureHandle;
 	TextureHandle terrainMapTextureHandle;
+	TextureHandle displacementMapTextureHandle;
+	float32 displacementScale = 0.0f;
 	TextureHandle splatMapTextureHandles[3];
 	Texture2dArray splatMapTexture2dArrays[5];
+
+	// Set for terrain created with createStreamedTerrain(), which has no height or terrain map textures
+	std::unique_ptr<StreamedTerrain> streamed;
 };
 
 struct SkyboxRenderable
@@ -120,6 +253,24 @@ struct Skybox
 	TextureCubeMap textureCubeMap;
 };
 
+/**
+ * Per-frame data shared by every shader program. The layout matches the std140 'FrameData' uniform block
+ * declared in the shaders, so the struct is uploaded as-is.
+ */
+struct FrameData
+{
+	glm::mat4 view = glm::mat4(1.0f);
+	glm::mat4 projection = glm::mat4(1.0f);
+	glm::mat4 viewProjection = glm::mat4(1.0f);
+	glm::mat4 lightSpaceMatrix = glm::mat4(1.0f);
+	glm::vec4 cameraPosition = glm::vec4(0.0f);
+	glm::vec2 viewport = glm::vec2(0.0f);
+	float32 time = 0.0f;
+	float32 padding = 0.0f;
+};
+
+static_assert(sizeof(FrameData) == 288, "FrameData must match the std140 layout of the FrameData uniform block");
+
 struct Material
 {
 	Texture2d albedo;
@@ -130,6 +281,7 @@ struct Material
 struct RenderScene
 {
 	handles::HandleVector<Renderable, RenderableHandle> renderables;
+	TransformStore transforms;
 	handles::HandleVector<GraphicsData, PointLightHandle> pointLights;
 	handles::HandleVector<TerrainRenderable, TerrainRenderableHandle> terrain;
 	handles::HandleVector<SkyboxRenderable, SkyboxRenderableHandle> skyboxes;
@@ -142,7 +294,13 @@ struct Camera
 	glm::quat orientation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
 };
 
-class OpenGlRenderer : public IGraphicsEngine
+class OpenGlRenderer :
+	public IGraphicsEngine,
+	public IDebugLineRenderer,
+	public IRenderStatisticsProvider,
+	public ITransformBatcher,
+	public IAnimationLodController,
+	public IStreamedTerrainFactory
 {
 public:
 	OpenGlRenderer(utilities::Properties* properties, fs::IFileSystem* fileSystem, logger::ILogger* logger);
@@ -164,6 +322,13 @@ public:
 	void renderLines(const std::vector<std::tuple<glm::vec3, glm::vec3, glm::vec3>>& lineData) override;
 	void endRender() override;
 
+	void renderBox(const glm::vec3& minimum, const glm::vec3& maximum, const glm::vec3& color) override;
+	void renderSphere(const glm::vec3& center, const float32 radius, const glm::vec3& color) override;
+	void renderFrustum(const glm::mat4& viewProjection, const glm::vec3& color) override;
+	void renderLines(const LineVertex* vertices, const size_t vertexCount, const LineStyle& lineStyle) override;
+	LineVertex* reserveLines(const size_t vertexCount, const LineStyle& lineStyle) override;
+	void commitLines(const size_t vertexCount) override;
+
 	RenderSceneHandle createRenderScene() override;
     bool valid(const RenderSceneHandle& renderSceneHandle) const override;
 	void destroy(const RenderSceneHandle& renderSceneHandle) override;
@@ -331,6 +496,22 @@ public:
 	void addEventListener(IEventListener* eventListener) override;
 	void removeEventListener(IEventListener* eventListener) override;
 
+	const RenderStatistics& renderStatistics() const override;
+
+	void transforms(
+		const RenderSceneHandle& renderSceneHandle,
+		const StridedSpan<RenderableHandle>& renderableHandles,
+		const StridedSpan<glm::vec3>& positions,
+		const StridedSpan<glm::quat>& orientations = StridedSpan<glm::quat>(),
+		const StridedSpan<glm::vec3>& scales = StridedSpan<glm::vec3>()
+	) override;
+
+	void animationLod(const RenderSceneHandle& renderSceneHandle, const RenderableHandle& renderableHandle, const AnimationLod& animationLod) override;
+	AnimationLodLevel animationLodLevel(const BonesHandle& bonesHandle) const override;
+	bool animationUpdateDue(const BonesHandle& bonesHandle) const override;
+
+	TerrainHandle createStreamedTerrain(const std::string& filename, const ISplatMap& splatMap) override;
+
 private:
 	uint32 width_;
 	uint32 height_;
@@ -351,7 +532,7 @@ private:
 	handles::HandleVector<Terrain, TerrainHandle> terrains_;
 	handles::HandleVector<Skybox, SkyboxHandle> skyboxes_;
 	handles::HandleVector<Ubo, SkeletonHandle> skeletons_;
-	handles::HandleVector<Ubo, BonesHandle> bones_;
+	handles::HandleVector<BonePalette, BonesHandle> bones_;
 	handles::HandleVector<Texture2d, TextureHandle> texture2ds_;
 	handles::HandleVector<Material, MaterialHandle> materials_;
 	Camera camera_;
@@ -360,6 +541,105 @@ private:
 	glm::mat4 view_ = glm::mat4(1.0f);
 	glm::mat4 projection_ = glm::mat4(1.0f);
 
+	FrameData frameData_;
+	RenderStatistics renderStatistics_;
+	RenderQueue renderQueue_;
+	std::vector<const Renderable*> queuedRenderables_;
+	Frustum cameraFrustum_;
+	Frustum lightFrustum_;
+	BoundingSphereList renderableBounds_;
+
+	// Transform slots of the renderables passed to transforms()
+	std::vector<uint32> transformIndices_;
+	std::vector<uint8> visibleToCamera_;
+	std::vector<uint8> visibleToLight_;
+	std::vector<InstanceData> instanceData_;
+	std::vector<InstanceBatch> shadowInstanceBatches_;
+	std::vector<InstanceBatch> instanceBatches_;
+	std::vector<DrawElementsIndirectCommand> drawCommands_;
+	std::vector<MultiDrawBatch> multiDrawBatches_;
+
+	// Per-frame data (frame uniforms, instances, draw commands, bones, debug lines) is sub-allocated from here
+	StreamingBuffer streamingBuffer_;
+	GLint uniformBufferOffsetAlignment_ = 256;
+	StreamingAllocation instanceDataAllocation_;
+	StreamingAllocation drawCommandAllocation_;
+
+	// Debug lines of the current frame
+	LineBatcher lineBatcher_;
+
+	// Images of created textures and materials waiting to be transferred, and bytes transferred per frame
+	TextureUploadQueue textureUploadQueue_;
+	bool asynchronousTextureUpload_ = true;
+	GLsizeiptr textureUploadBudget_ = 4 * 1024 * 1024;
+
+	// Whether mip levels are generated on the CPU instead of with glGenerateMipmap, and scratch storage for them
+	bool cpuMipmaps_ = false;
+	std::vector<byte> mipChain_;
+	std::vector<MipLevel> mipLevels_;
+
+	// Threads that mip chains and packed materials are generated on, kept for the renderer's lifetime
+	WorkerPool workerPool_;
+
+	// Grid drawn once per selected terrain chunk, and the grid of patches drawn per tile when terrain is tessellated
+	TerrainPatch terrainPatch_;
+	TerrainPatch terrainTessellationPatch_;
+	std::vector<TerrainChunk> terrainChunks_;
+	uint32 terrainChunkResolution_ = 16;
+	uint32 terrainLodCount_ = 6;
+	float32 terrainDetailDistance_ = 64.0f;
+	bool terrainTessellation_ = false;
+	uint32 terrainTessellationTriangleSize_ = 8;
+
+	// Streamed terrain tiles kept on the GPU per terrain, distance around the camera to load, and bytes uploaded per frame
+	uint32 terrainStreamingSlotCount_ = 256;
+	float32 terrainStreamingDistance_ = 512.0f;
+	GLsizeiptr terrainStreamingUploadBudget_ = 1024 * 1024;
+
+	// Bone palettes of the skinned instances being drawn, streamed into one texture buffer
+	std::vector<glm::vec4> bonePaletteData_;
+	uint32 bonePaletteFrame_ = 0;
+
+	// Frames rendered, advanced in beginRender(). Animation LOD levels and bone samples are stamped with it, so every
+	// render scene drawn in a frame sees the same frame
+	uint32 animationLodFrame_ = 0;
+	GLint bonePaletteBase_ = 0;
+
+	// GL 3.3 only guarantees 65536 texels per texture buffer. With ARB_texture_buffer_range the texture buffer views just
+	// the palettes in the streaming buffer, otherwise it spans all of bonePaletteBuffer_, which is sized to stay in reach
+	GLint maxTextureBufferSize_ = 65536;
+	GLint textureBufferOffsetAlignment_ = 16;
+	bool textureBufferRange_ = false;
+	StreamingBuffer bonePaletteBuffer_;
+	std::vector<glm::mat4> interpolatedTransformations_;
+	TextureBuffer bonePaletteTexture_;
+	std::chrono::steady_clock::time_point startTime_;
+
+	// Skinned meshes posed this frame, by mesh and bones handle index, shared by the shadow and geometry pass
+	std::vector<SkinningJob> skinningJobs_;
+	std::unordered_map<uint64, uint32> skinningJobIndices_;
+	uint32 skinnedVertexCount_ = 0;
+	StreamingAllocation skinnedVertexAllocation_;
+
+	// Vertex arrays over the posed vertices with the index buffer of each skinned mesh arena
+	GLuint posedVertexArrays_[4] = {};
+
+	BoneFormat boneFormat_ = BoneFormat::MAT4;
+	AnimationLod animationLod_;
+	bool transformFeedbackSkinning_ = false;
+	bool compactVertexFormat_ = false;
+	bool optimizeMeshes_ = false;
+	bool weldVertices_ = false;
+	bool multiDrawIndirect_ = false;
+
+	// One arena per vertex format, unskinned and skinned, see meshArena()
+	MeshArena meshArenas_[4];
+	uint32 meshArenaVertexCapacity_ = 0;
+	uint32 meshArenaIndexCapacity_ = 0;
+
+	// Vertex remaps of optimized meshes, by mesh handle index, for per vertex data that arrives later (skeletons)
+	std::unordered_map<uint32, std::vector<uint32>> meshVertexRemaps_;
+
 	utilities::Properties* properties_;
 	fs::IFileSystem* fileSystem_;
 	logger::ILogger* logger_;
@@ -368,15 +648,97 @@ private:
 	void initializeOpenGlShaderPrograms();
 	void initializeOpenGlBuffers();
 
+	void buildInstanceBatches(RenderScene& renderScene);
+	void buildMultiDrawBatches();
+	int32 bonePaletteOffset(const BonesHandle& bonesHandle);
+	void updateAnimationLod(const Renderable& renderable, const BoundingSphere& boundingSphere);
+	AnimationLodLevel animationLodLevel(const BonePalette& bonePalette) const;
+
+	/**
+	 * Returns the first posed vertex of the renderable's mesh posed by its bones, adding a skinning job the first time
+	 * the pair is seen this frame.
+	 */
+	int32 posedBaseVertex(const Renderable& renderable);
+
+	/**
+	 * Runs the frame's skinning jobs with transform feedback and points the posed vertex arrays at the results.
+	 */
+	void skinVertices();
+
+	GLuint vertexArray(const InstanceBatch& instanceBatch) const;
+
 	MeshHandle createStaticMesh(
 		const std::vector<glm::vec3>& vertices,
 		const std::vector<uint32>& indices,
 		const std::vector<glm::vec4>& colors,
 		const std::vector<glm::vec3>& normals,
-		const std::vector<glm::vec2>& textureCoordinates
+		const std::vector<glm::vec2>& textureCoordinates,
+		const VertexFormat vertexFormat = VertexFormat::FLOAT
+	);
+
+	/**
+	 * Returns the index of the mesh arena for the given vertex format, creating the arena on first use.
+	 */
+	uint32 meshArena(const VertexFormat vertexFormat, const bool skinned);
+
+	void optimizeStaticMesh(
+		std::vector<glm::vec3>& vertices,
+		std::vector<uint32>& indices,
+		std::vector<glm::vec4>& colors,
+		std::vector<glm::vec3>& normals,
+		std::vector<glm::vec2>& textureCoordinates,
+		std::vector<uint32>& vertexRemap
 	);
 
+	/**
+	 * Uploads the albedo, normal and metalness, roughness and ambient occlusion images of the splat map materials into
+	 * the texture arrays of the terrain.
+	 */
+	void createSplatMapTextures(Terrain& terrain, const ISplatMap& splatMap);
+
+	/**
+	 * Creates a mipmapped texture from size bytes of data, through the texture upload queue when uploads are
+	 * asynchronous, in which case the texture samples as placeholder until the image is transferred.
+	 *
+	 * Data holding a whole mip chain is uploaded level by level. Otherwise the mip levels are generated on the CPU when
+	 * cpuMipmaps_ is set, gamma correct for color textures, and with glGenerateMipmap when it is not.
+	 */
+	void generateTexture2d(
+		Texture2d& texture,
+		const GLint format,
+		const GLsizei width,
+		const GLsizei height,
+		const byte* data,
+		const size_t size,
+		const bool gammaCorrect,
+		const glm::vec4& placeholder
+	);
+
+	/**
+	 * Allocates every mip level of an RGBA texture array, when cpuMipmaps_ is set, so layers can be uploaded level by
+	 * level with uploadTexture2dArrayLayer(). The array must be bound.
+	 */
+	void allocateTexture2dArrayMipLevels(const GLsizei width, const GLsizei height, const GLsizei depth);
+
+	/**
+	 * Uploads an RGBA image into layer of the bound texture array, with its mip levels when cpuMipmaps_ is set. Data
+	 * holding a whole mip chain provides them, otherwise they are generated on the CPU.
+	 */
+	void uploadTexture2dArrayLayer(const GLsizei width, const GLsizei height, const GLsizei layer, const byte* data, const size_t size, const bool gammaCorrect);
+
+	/**
+	 * Finishes the mip levels of the bound texture array, with glGenerateMipmap unless cpuMipmaps_ is set.
+	 */
+	void finishTexture2dArrayMipLevels();
+
 	std::string loadShaderContents(const std::string& filename) const;
+
+	/**
+	 * Loads the shader in filename with the contents of preludeFilenames, in order, inserted after its #version and
+	 * #extension lines, so shaders can share functions. A #line directive keeps compile errors pointing at the lines of
+	 * filename.
+	 */
+	std::string loadShaderContents(const std::string& filename, const std::vector<std::string>& preludeFilenames) const;
 	GLuint createShaderProgram(const GLuint vertexShader, const GLuint fragmentShader);
 	GLuint compileShader(const std::string& source, const GLenum type);
 
@@ -0,0 +1,47 @@
+#ifndef PARALLELROWS_GL33_H_
+#define PARALLELROWS_GL33_H_
+
+#include <algorithm>
+
+#include "WorkerPool.hpp"
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * Calls function(firstRow, lastRow) for chunks of whole rows of a width x height image, with lastRow exclusive, on the
+ * threads of workerPool. Images with fewer than minPixelsPerThread pixels per thread are split into fewer chunks, down
+ * to a single one, which the calling thread processes alone. Returns once every chunk is done.
+ */
+template <typename Function>
+void parallelRows(WorkerPool& workerPool, const uint32 width, const uint32 height, const size_t minPixelsPerThread, Function function)
+{
+	if (height == 0) return;
+
+	const size_t pixels = static_cast<size_t>(width) * height;
+
+	const size_t chunkCount = std::max(std::min(std::min(static_cast<size_t>(workerPool.threadCount()), pixels / std::max(minPixelsPerThread, static_cast<size_t>(1))), static_cast<size_t>(height)), static_cast<size_t>(1));
+
+	const uint32 rowsPerChunk = static_cast<uint32>((height + chunkCount - 1) / chunkCount);
+
+	workerPool.run((height + rowsPerChunk - 1) / rowsPerChunk, [&function, rowsPerChunk, height](const uint32 chunk) {
+		const uint32 firstRow = chunk * rowsPerChunk;
+
+		function(firstRow, std::min(firstRow + rowsPerChunk, height));
+	});
+}
+
+}
+}
+}
+}
+
+#endif /* PARALLELROWS_GL33_H_ */
@@ -0,0 +1,78 @@
+#ifndef RENDERQUEUE_GL33_H_
+#define RENDERQUEUE_GL33_H_
+
+#include <vector>
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+enum class RenderPass : uint32
+{
+	SHADOW = 0,
+	GEOMETRY = 1
+};
+
+struct RenderQueueItem
+{
+	uint64 key;
+	uint32 index;
+};
+
+/**
+ * Collects draw items tagged with a 64-bit sort key and sorts them so that items sharing GPU state end up next
+ * to each other.
+ *
+ * Key layout, from most to least significant bits:
+ *
+ * | pass (4) | program (8) | skinned (1) | material (16) | mesh (16) | depth (19) |
+ *
+ * Fields wider than their slot are truncated. That only affects the order of the items, so callers must compare
+ * the actual state of neighbouring items when deciding what can be drawn together.
+ */
+class RenderQueue
+{
+public:
+	RenderQueue() = default;
+
+	static uint64 key(
+		const RenderPass pass,
+		const uint32 program,
+		const bool skinned,
+		const uint32 material,
+		const uint32 mesh,
+		const float32 depth
+	);
+
+	static RenderPass pass(const uint64 key);
+
+	void clear();
+	void push(const uint64 key, const uint32 index);
+
+	/**
+	 * Sorts the queued items by key using a least significant digit radix sort.
+	 *
+	 * The sort is stable, and byte positions where every key has the same value are skipped.
+	 */
+	void sort();
+
+	const std::vector<RenderQueueItem>& items() const;
+
+private:
+	std::vector<RenderQueueItem> items_;
+	std::vector<RenderQueueItem> scratch_;
+};
+
+}
+}
+}
+}
+
+#endif /* RENDERQUEUE_GL33_H_ */
@@ -0,0 +1,13 @@
+#ifndef SIMD_GL33_H_
+#define SIMD_GL33_H_
+
+/**
+ * ICE_ENGINE_SSE2 is defined when the target supports SSE2, which every x86-64 target does. Code using the intrinsics
+ * checks it and keeps a scalar fallback for other targets.
+ */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ICE_ENGINE_SSE2
+#include <emmintrin.h>
+#endif
+
+#endif /* SIMD_GL33_H_ */
@@ -0,0 +1,134 @@
+#ifndef STREAMEDTERRAIN_GL33_H_
+#define STREAMEDTERRAIN_GL33_H_
+
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "../gl/Texture2d.hpp"
+#include "../gl/Texture2dArray.hpp"
+
+#include "TerrainTileLoader.hpp"
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * Terrain whose height, normal and terrain map data stays on disk in a TerrainTileFile, with only the tiles around the
+ * camera resident on the GPU.
+ *
+ * Resident tiles live in the layers of two texture arrays, one slot per layer, and an integer texture with one texel
+ * per tile maps tiles to slots (-1 when not resident). Tiles are read by a TerrainTileLoader and uploaded by update()
+ * under a per-frame byte budget. When every slot is taken, the farthest tile outside of the streaming distance is
+ * evicted.
+ *
+ * The overview of the tile file is uploaded once and stays resident, so terrain over tiles that are not resident is
+ * still drawn, at the resolution of the overview.
+ */
+class StreamedTerrain
+{
+public:
+	StreamedTerrain(const std::string& filename, const uint32 slotCount);
+	StreamedTerrain(const StreamedTerrain& other) = delete;
+	StreamedTerrain& operator=(const StreamedTerrain& other) = delete;
+	~StreamedTerrain();
+
+	void destroy();
+
+	/**
+	 * Uploads loaded tiles, at least one if uploadBudget is positive and then as long as it is not exceeded, and
+	 * requests the missing tiles within distance of cameraPosition, nearest first. cameraPosition is in terrain space.
+	 *
+	 * @return The number of bytes uploaded.
+	 */
+	GLsizeiptr update(const glm::vec3& cameraPosition, const float32 distance, const GLsizeiptr uploadBudget);
+
+	void bind(
+		const GLuint heightNormalUnit,
+		const GLuint terrainMapUnit,
+		const GLuint tileSlotsUnit,
+		const GLuint heightNormalOverviewUnit,
+		const GLuint terrainMapOverviewUnit
+	);
+
+	uint32 width() const;
+	uint32 height() const;
+	uint32 tileSize() const;
+	glm::ivec2 tileCount() const;
+
+	/**
+	 * Samples of the whole terrain between two samples of the overview.
+	 */
+	uint32 overviewStep() const;
+
+	uint32 residentTileCount() const;
+	bool valid() const;
+
+private:
+	enum class SlotState : uint8
+	{
+		FREE,
+		LOADING,
+		RESIDENT
+	};
+
+	struct Slot
+	{
+		uint32 tile = 0;
+		SlotState state = SlotState::FREE;
+	};
+
+	struct TileDistance
+	{
+		float32 distanceSquared;
+		uint32 tile;
+	};
+
+	TerrainTileLoader loader_;
+
+	gl::Texture2dArray heightNormalTiles_;
+	gl::Texture2dArray terrainMapTiles_;
+	gl::Texture2d tileSlots_;
+	gl::Texture2d heightNormalOverview_;
+	gl::Texture2d terrainMapOverview_;
+
+	std::vector<Slot> slots_;
+
+	// Slot of every tile, or -1, including slots still loading
+	std::vector<int32> tileSlotIndices_;
+
+	// What tileSlots_ holds, slots of resident tiles only
+	std::vector<int32> residentTileSlotIndices_;
+	bool tileSlotsDirty_ = false;
+
+	std::vector<bool> failedTiles_;
+	uint32 loadingCount_ = 0;
+	uint32 residentCount_ = 0;
+
+	// Scratch storage, keeps its capacity between frames
+	std::vector<TileDistance> wantedTiles_;
+	std::vector<uint32> wantedFrames_;
+	uint32 frame_ = 0;
+
+	void upload(const TerrainTile& tile);
+	int32 acquireSlot(const glm::vec3& cameraPosition);
+	float32 distanceSquared(const uint32 tile, const glm::vec3& position) const;
+};
+
+}
+}
+}
+}
+
+#endif /* STREAMEDTERRAIN_GL33_H_ */
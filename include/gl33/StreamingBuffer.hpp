@@ -0,0 +1,112 @@
+#ifndef STREAMINGBUFFER_GL33_H_
+#define STREAMINGBUFFER_GL33_H_
+
+#include <utility>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * A range of a StreamingBuffer written during the current frame. Bind buffer, not the streaming buffer's current
+ * buffer, as the streaming buffer may have grown since.
+ */
+struct StreamingAllocation
+{
+	GLuint buffer = 0;
+	GLintptr offset = 0;
+	GLsizeiptr size = 0;
+};
+
+/**
+ * Ring buffer for data that is written by the CPU once per frame and read by the GPU during that frame.
+ *
+ * The buffer is split into one region per frame in flight. Allocations within a frame are linear, and a fence placed
+ * at the end of the frame guards the region until the GPU is done with it, so writes never wait on the driver. The
+ * buffer is mapped persistently when ARB_buffer_storage is available, otherwise every upload maps its range
+ * unsynchronized.
+ *
+ * The same buffer can be bound to any target, i.e. as vertex, uniform or draw indirect buffer.
+ */
+class StreamingBuffer
+{
+public:
+	StreamingBuffer() = default;
+	StreamingBuffer(const StreamingBuffer& other) = delete;
+	StreamingBuffer& operator=(const StreamingBuffer& other) = delete;
+	~StreamingBuffer();
+
+	/**
+	 * Regions start out frameSize bytes large. If maxFrameSize is not 0, they never grow beyond it.
+	 */
+	void generate(const GLsizeiptr frameSize, const bool persistentMapping, const GLsizeiptr maxFrameSize = 0);
+	void destroy();
+
+	/**
+	 * Copies data into the current frame's region. If the region is full, the buffer grows; allocations made earlier in
+	 * the frame stay valid.
+	 *
+	 * @throws std::runtime_error If growing would exceed the maximum frame size.
+	 */
+	StreamingAllocation upload(const GLvoid* data, const GLsizeiptr size, const GLsizeiptr alignment);
+
+	/**
+	 * Reserves a range of the current frame's region without writing to it, for data written by the GPU, i.e. with
+	 * transform feedback.
+	 */
+	StreamingAllocation allocate(const GLsizeiptr size, const GLsizeiptr alignment);
+
+	/**
+	 * Reserves a range of the current frame's region and maps it, so data can be written in place instead of copied.
+	 * Nothing else may be allocated from the buffer until unmap().
+	 */
+	StreamingAllocation map(const GLsizeiptr size, const GLsizeiptr alignment, GLvoid*& data);
+	void unmap();
+
+	/**
+	 * Fences the current frame's region and moves on to the next region, waiting for the GPU to finish with it if
+	 * necessary.
+	 */
+	void endFrame();
+
+	GLsizeiptr frameSize() const;
+	bool persistentMapping() const;
+	bool valid() const;
+
+	static constexpr uint32 FRAME_COUNT = 3;
+
+private:
+	GLuint buffer_ = 0;
+	uint8* mappedData_ = nullptr;
+	GLsizeiptr frameSize_ = 0;
+	GLsizeiptr maxFrameSize_ = 0;
+	bool persistentMapping_ = false;
+	bool mapped_ = false;
+
+	uint32 frame_ = 0;
+	GLintptr head_ = 0;
+	GLsync fences_[FRAME_COUNT] = {};
+
+	// Buffers replaced by growing, with the number of frames until the GPU is guaranteed to be done with them
+	std::vector<std::pair<GLuint, uint32>> retiredBuffers_;
+
+	void create(const GLsizeiptr frameSize);
+	void release();
+};
+
+}
+}
+}
+}
+
+#endif /* STREAMINGBUFFER_GL33_H_ */
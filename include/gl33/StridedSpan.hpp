@@ -0,0 +1,68 @@
+#ifndef STRIDEDSPAN_GL33_H_
+#define STRIDEDSPAN_GL33_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * A read only view of size elements of type T whose consecutive elements are stride bytes apart.
+ *
+ * This lets callers pass a member of an array of structures (stride = sizeof(struct)) as well as a tightly packed
+ * array (stride = sizeof(T)) without copying it first. A default constructed span is empty.
+ */
+template <typename T>
+class StridedSpan
+{
+public:
+	StridedSpan() = default;
+
+	StridedSpan(const T* data, const size_t size, const size_t stride = sizeof(T))
+		: data_(reinterpret_cast<const char*>(data)), size_(size), stride_(stride)
+	{
+	}
+
+	StridedSpan(const std::vector<T>& data) : StridedSpan(data.data(), data.size())
+	{
+	}
+
+	const T& operator[](const size_t index) const
+	{
+		return *reinterpret_cast<const T*>(data_ + index * stride_);
+	}
+
+	size_t size() const
+	{
+		return size_;
+	}
+
+	size_t stride() const
+	{
+		return stride_;
+	}
+
+	bool empty() const
+	{
+		return (size_ == 0);
+	}
+
+private:
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+	size_t stride_ = sizeof(T);
+};
+
+}
+}
+}
+}
+
+#endif /* STRIDEDSPAN_GL33_H_ */
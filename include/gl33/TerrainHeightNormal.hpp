@@ -0,0 +1,40 @@
+#ifndef TERRAINHEIGHTNORMAL_GL33_H_
+#define TERRAINHEIGHTNORMAL_GL33_H_
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * Packs a height map into RGBA16 texels, so the terrain shaders get everything they need for a vertex with one fetch:
+ * red is the height, green and blue the normal with y and z swapped, encoded with octahedralEncode(), alpha is unused.
+ * Swapping puts the terrain's up on the side of the octahedron that is not folded.
+ *
+ * Heights are read from the alpha channel of the RGBA8 height map. Normals are computed from the heights with central
+ * differences, for samples one unit apart and heights of heightScale * (alpha - 0.5).
+ */
+void packHeightNormals(
+	const byte* heightMap,
+	const uint32 width,
+	const uint32 height,
+	const float32 heightScale,
+	std::vector<uint16>& texels
+);
+
+}
+}
+}
+}
+
+#endif /* TERRAINHEIGHTNORMAL_GL33_H_ */
@@ -0,0 +1,59 @@
+#ifndef TERRAINPATCH_GL33_H_
+#define TERRAINPATCH_GL33_H_
+
+#include <GL/glew.h>
+
+#include "StreamingBuffer.hpp"
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * A square grid of resolution x resolution quads, shared by every terrain chunk. Vertices hold their grid coordinates,
+ * the terrain vertex shader places them using the per-instance TerrainChunk.
+ *
+ * The quads are either split into triangles, or drawn as four vertex patches for the tessellation stages.
+ */
+class TerrainPatch
+{
+public:
+	TerrainPatch() = default;
+	TerrainPatch(const TerrainPatch& other) = delete;
+	TerrainPatch& operator=(const TerrainPatch& other) = delete;
+	~TerrainPatch();
+
+	void generate(const uint32 resolution, const bool patches = false);
+	void destroy();
+
+	/**
+	 * Draws one instance of the patch per TerrainChunk in the given allocation.
+	 */
+	void draw(const StreamingAllocation& chunks, const uint32 chunkCount);
+
+	uint32 resolution() const;
+	bool patches() const;
+	bool valid() const;
+
+private:
+	GLuint vertexArray_ = 0;
+	GLuint vertexBuffer_ = 0;
+	GLuint indexBuffer_ = 0;
+	GLsizei indexCount_ = 0;
+	uint32 resolution_ = 0;
+	bool patches_ = false;
+};
+
+}
+}
+}
+}
+
+#endif /* TERRAINPATCH_GL33_H_ */
@@ -0,0 +1,119 @@
+#ifndef TERRAINQUADTREE_GL33_H_
+#define TERRAINQUADTREE_GL33_H_
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Culling.hpp"
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * A square of terrain drawn with one instance of the terrain patch, in terrain grid units. Laid out as the per-instance
+ * attributes of deferred_lighting_terrain_geometry_pass.vert.
+ */
+struct TerrainChunk
+{
+	glm::vec2 offset;
+	float32 size = 0.0f;
+	float32 lod = 0.0f;
+
+	// Distances from the camera over which the odd vertices of the chunk morph onto the next coarser level
+	glm::vec2 morphRange;
+};
+
+/**
+ * Continuous distance-based level of detail (CDLOD) selection over a height map.
+ *
+ * A node of level l covers 2 * chunkResolution << l grid units and is drawn as up to four chunks of chunkResolution
+ * quads, so every level has half the vertex density of the one below it. Level l is used within lodRange(l) of the
+ * camera, and vertices morph into the next level before the range ends, so neighbouring chunks of different levels
+ * meet without cracks.
+ *
+ * That only holds if every node lies within the range where its parent's level has not started morphing yet. Ranges
+ * double from level to level, and grow further where the diagonal of a node's box would reach past that point.
+ */
+class TerrainQuadtree
+{
+public:
+	TerrainQuadtree() = default;
+
+	/**
+	 * @param width Number of height map samples along x.
+	 * @param height Number of height map samples along z.
+	 * @param chunkResolution Quads along one side of a chunk, must be even.
+	 * @param lodCount Number of levels of detail.
+	 * @param detailDistance Range of the finest level, every coarser level at least doubles it.
+	 * @param minimumHeight Lowest height of the terrain, in terrain space.
+	 * @param maximumHeight Highest height of the terrain, in terrain space.
+	 */
+	TerrainQuadtree(
+		const uint32 width,
+		const uint32 height,
+		const uint32 chunkResolution,
+		const uint32 lodCount,
+		const float32 detailDistance,
+		const float32 minimumHeight,
+		const float32 maximumHeight
+	);
+
+	/**
+	 * Appends the chunks to draw for a camera at the given position, in terrain space. Nodes whose bounds, transformed
+	 * by modelMatrix, are outside of the frustum are skipped.
+	 *
+	 * @return The number of nodes skipped by frustum culling.
+	 */
+	uint32 select(const glm::vec3& cameraPosition, const Frustum& frustum, const glm::mat4& modelMatrix, std::vector<TerrainChunk>& chunks) const;
+
+	/**
+	 * Appends chunks of tileSize grid units covering the whole terrain at the finest level, for when the level of detail
+	 * comes from tessellation instead. Tiles outside of the frustum are skipped.
+	 *
+	 * @return The number of tiles skipped by frustum culling.
+	 */
+	uint32 tile(const uint32 tileSize, const Frustum& frustum, const glm::mat4& modelMatrix, std::vector<TerrainChunk>& chunks) const;
+
+	float32 lodRange(const uint32 lod) const;
+	uint32 lodCount() const;
+	uint32 chunkResolution() const;
+
+private:
+	uint32 width_ = 0;
+	uint32 height_ = 0;
+	uint32 chunkResolution_ = 0;
+	float32 minimumHeight_ = 0.0f;
+	float32 maximumHeight_ = 0.0f;
+	std::vector<float32> lodRanges_;
+
+	struct Selection
+	{
+		glm::vec3 cameraPosition;
+		const Frustum* frustum;
+		const glm::mat4* modelMatrix;
+		std::vector<TerrainChunk>* chunks;
+		uint32 culled;
+	};
+
+	bool select(const uint32 x, const uint32 z, const uint32 lod, Selection& selection) const;
+	void addNode(const uint32 x, const uint32 z, const uint32 lod, Selection& selection) const;
+	void addChunk(const uint32 x, const uint32 z, const uint32 lod, Selection& selection) const;
+	bool visible(const uint32 x, const uint32 z, const uint32 size, const Frustum& frustum, const glm::mat4& modelMatrix) const;
+	bool inRange(const uint32 x, const uint32 z, const uint32 size, const glm::vec3& position, const float32 range) const;
+};
+
+}
+}
+}
+}
+
+#endif /* TERRAINQUADTREE_GL33_H_ */
@@ -0,0 +1,124 @@
+#ifndef TERRAINTILEFILE_GL33_H_
+#define TERRAINTILEFILE_GL33_H_
+
+#include <string>
+#include <vector>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+struct TerrainTileFileHeader
+{
+	char magic[4];
+	uint32 version = 0;
+
+	// Height map samples of the whole terrain along x and z
+	uint32 width = 0;
+	uint32 height = 0;
+
+	// Quads along one side of a tile, a tile stores tileSize + 1 samples per side so neighbouring tiles share their edge
+	uint32 tileSize = 0;
+	uint32 tileCountX = 0;
+	uint32 tileCountZ = 0;
+
+	// Samples of the whole terrain between two samples of the overview
+	uint32 overviewStep = 0;
+};
+
+static_assert(sizeof(TerrainTileFileHeader) == 32, "TerrainTileFileHeader must be tightly packed");
+
+/**
+ * Paged terrain data on disk. The header is followed by a table with the offset of every tile, row by row, the overview
+ * and the tiles themselves. A tile holds its RGBA16 height and normal samples, laid out as the height map texture of a
+ * static terrain (see packHeightNormals()), followed by its RGBA8 terrain map samples. The overview holds both images
+ * of the whole terrain at every overviewStep-th sample, small enough to stay resident as a fallback for tiles that are
+ * not.
+ *
+ * The file is memory mapped read only, so reading tiles from several threads at once is safe and pages that are not
+ * read never take memory.
+ */
+class TerrainTileFile
+{
+public:
+	TerrainTileFile() = default;
+	explicit TerrainTileFile(const std::string& filename);
+	TerrainTileFile(const TerrainTileFile& other) = delete;
+	TerrainTileFile& operator=(const TerrainTileFile& other) = delete;
+
+	/**
+	 * Copies a tile out of the mapping, replacing the contents of heightNormal and terrainMap.
+	 */
+	void read(const uint32 tile, std::vector<uint16>& heightNormal, std::vector<byte>& terrainMap) const;
+
+	const TerrainTileFileHeader& header() const;
+	uint32 tileCount() const;
+
+	/**
+	 * Samples along one side of a tile.
+	 */
+	uint32 tileSamples() const;
+
+	/**
+	 * Bytes of the height and normal image and of the terrain map image of a tile.
+	 */
+	size_t tileHeightNormalSize() const;
+	size_t tileTerrainMapSize() const;
+
+	/**
+	 * Samples of the overview along x and z.
+	 */
+	uint32 overviewWidth() const;
+	uint32 overviewHeight() const;
+
+	/**
+	 * The overview images, pointing into the mapping and valid for as long as the file is.
+	 */
+	const uint16* overviewHeightNormal() const;
+	const byte* overviewTerrainMap() const;
+
+	/**
+	 * Splits whole terrain images of width x height samples, RGBA16 height and normal as packed by packHeightNormals() and
+	 * RGBA8 terrain map, into tiles, along with their overview, and writes them to filename.
+	 */
+	static void write(
+		const std::string& filename,
+		const uint32 width,
+		const uint32 height,
+		const uint32 tileSize,
+		const uint16* heightNormal,
+		const byte* terrainMap
+	);
+
+	static constexpr uint32 VERSION = 2;
+
+	/**
+	 * Most samples along one side of the overview written by write().
+	 */
+	static constexpr uint32 OVERVIEW_MAX_SAMPLES = 512;
+
+private:
+	boost::interprocess::file_mapping file_;
+	boost::interprocess::mapped_region region_;
+
+	TerrainTileFileHeader header_;
+	const uint64* tileOffsets_ = nullptr;
+	const byte* overview_ = nullptr;
+};
+
+}
+}
+}
+}
+
+#endif /* TERRAINTILEFILE_GL33_H_ */
@@ -0,0 +1,86 @@
+#ifndef TERRAINTILELOADER_GL33_H_
+#define TERRAINTILELOADER_GL33_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TerrainTileFile.hpp"
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+struct TerrainTile
+{
+	uint32 index = 0;
+
+	// Both empty if the tile could not be read
+	std::vector<uint16> heightNormal;
+	std::vector<byte> terrainMap;
+};
+
+/**
+ * Reads tiles of a TerrainTileFile on a worker thread, in the order they were requested.
+ *
+ * The worker copies tiles out of the memory mapped file, so page faults happen there rather than on the render thread.
+ * Requests and loaded tiles are handed over under a mutex, and the render thread collects loaded tiles with pop()
+ * without waiting on reads.
+ */
+class TerrainTileLoader
+{
+public:
+	explicit TerrainTileLoader(const std::string& filename);
+	TerrainTileLoader(const TerrainTileLoader& other) = delete;
+	TerrainTileLoader& operator=(const TerrainTileLoader& other) = delete;
+	~TerrainTileLoader();
+
+	void request(const uint32 tile);
+
+	/**
+	 * Moves the oldest loaded tile into tile.
+	 *
+	 * @return false if no tile has finished loading.
+	 */
+	bool pop(TerrainTile& tile);
+
+	const TerrainTileFileHeader& header() const;
+	uint32 tileSamples() const;
+	size_t tileHeightNormalSize() const;
+	size_t tileTerrainMapSize() const;
+	uint32 overviewWidth() const;
+	uint32 overviewHeight() const;
+	const uint16* overviewHeightNormal() const;
+	const byte* overviewTerrainMap() const;
+
+private:
+	TerrainTileFile file_;
+
+	std::mutex mutex_;
+	std::condition_variable condition_;
+	std::deque<uint32> requests_;
+	std::deque<TerrainTile> loaded_;
+	bool stop_ = false;
+
+	// Started last, so everything above exists before the worker runs
+	std::thread thread_;
+
+	void run();
+};
+
+}
+}
+}
+}
+
+#endif /* TERRAINTILELOADER_GL33_H_ */
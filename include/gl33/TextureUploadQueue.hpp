@@ -0,0 +1,129 @@
+#ifndef TEXTUREUPLOADQUEUE_GL33_H_
+#define TEXTUREUPLOADQUEUE_GL33_H_
+
+#include <deque>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "../gl/Texture2d.hpp"
+
+#include "MipChain.hpp"
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * Moves texture uploads off the call that creates the texture.
+ *
+ * enqueue() gives the texture a single texel placeholder and copies the image into a pixel unpack buffer, which is all
+ * the work done on the calling thread. process() then transfers queued images from their buffers into the textures,
+ * under a per-frame byte budget, and generates mipmaps on the GPU. The transfer is asynchronous: a fence placed after
+ * it tells when the staging buffer can be released.
+ *
+ * Textures keep their name throughout, so handles stay valid and draws sample the placeholder until the image is in.
+ *
+ * Staging buffers go back to a pool once their fence has signalled and are reused for later images, so a steady stream
+ * of uploads neither creates buffers nor has the driver synchronize when they are mapped.
+ */
+class TextureUploadQueue
+{
+public:
+	TextureUploadQueue() = default;
+	TextureUploadQueue(const TextureUploadQueue& other) = delete;
+	TextureUploadQueue& operator=(const TextureUploadQueue& other) = delete;
+	~TextureUploadQueue();
+
+	void generate();
+	void destroy();
+
+	/**
+	 * Creates texture with a placeholder of one texel and queues the images in data, laid out as levels describes, as its
+	 * mip levels. With a single level, generateMipmap has the GPU generate the others.
+	 */
+	void enqueue(
+		gl::Texture2d& texture,
+		const GLint internalFormat,
+		const GLenum format,
+		const GLenum type,
+		const GLvoid* data,
+		const std::vector<MipLevel>& levels,
+		const bool generateMipmap,
+		const glm::vec4& placeholder
+	);
+
+	/**
+	 * Transfers queued images, at least one if uploadBudget is positive and then as long as it is not exceeded, and
+	 * releases the staging buffers of finished transfers.
+	 *
+	 * @return The number of bytes transferred.
+	 */
+	GLsizeiptr process(const GLsizeiptr uploadBudget);
+
+	uint32 pendingCount() const;
+	bool valid() const;
+
+private:
+	struct StagingBuffer
+	{
+		GLuint buffer = 0;
+		GLsizeiptr capacity = 0;
+	};
+
+	struct Upload
+	{
+		GLuint texture = 0;
+		StagingBuffer stagingBuffer;
+		GLint internalFormat = 0;
+		GLenum format = 0;
+		GLenum type = 0;
+		GLsizeiptr size = 0;
+		std::vector<MipLevel> levels;
+		bool generateMipmap = false;
+	};
+
+	struct Transfer
+	{
+		StagingBuffer stagingBuffer;
+		GLsync fence = nullptr;
+	};
+
+	bool valid_ = false;
+
+	std::deque<Upload> uploads_;
+	std::deque<Transfer> transfers_;
+
+	// Staging buffers the GPU is done with, and their total capacity
+	std::vector<StagingBuffer> freeStagingBuffers_;
+	GLsizeiptr freeStagingBytes_ = 0;
+
+	void transfer(const Upload& upload);
+	void release();
+
+	/**
+	 * Returns the smallest pooled staging buffer of at least size bytes, or a new one.
+	 */
+	StagingBuffer acquire(const GLsizeiptr size);
+
+	/**
+	 * Returns stagingBuffer to the pool, or deletes it if the pool is full.
+	 */
+	void recycle(const StagingBuffer& stagingBuffer);
+};
+
+}
+}
+}
+}
+
+#endif /* TEXTUREUPLOADQUEUE_GL33_H_ */
@@ -0,0 +1,90 @@
+#ifndef TRANSFORMSTORE_GL33_H_
+#define TRANSFORMSTORE_GL33_H_
+
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "StridedSpan.hpp"
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * Transforms of a render scene's renderables, stored as a structure of arrays.
+ *
+ * Model and normal matrices are cached. Setters mark an entry dirty, and update() recomputes the matrices of
+ * dirty entries only, so static objects cost nothing per frame.
+ */
+class TransformStore
+{
+public:
+	TransformStore() = default;
+
+	uint32 create(const glm::vec3& position, const glm::quat& orientation, const glm::vec3& scale);
+	void destroy(const uint32 index);
+
+	const glm::vec3& position(const uint32 index) const;
+	const glm::quat& orientation(const uint32 index) const;
+	const glm::vec3& scale(const uint32 index) const;
+
+	void position(const uint32 index, const glm::vec3& position);
+	void orientation(const uint32 index, const glm::quat& orientation);
+	void scale(const uint32 index, const glm::vec3& scale);
+
+	/**
+	 * Sets position, orientation and scale of the given entry at once, marking it dirty a single time.
+	 */
+	void set(const uint32 index, const glm::vec3& position, const glm::quat& orientation, const glm::vec3& scale);
+
+	/**
+	 * Sets entry indices[i] from element i of each non empty span, leaving the components of empty spans unchanged.
+	 *
+	 * Written with non-temporal stores where SSE2 is available: a batch of thousands of entries goes to memory without
+	 * first reading every cache line it touches, and without evicting the rest of the frame's data.
+	 */
+	void set(
+		const uint32* indices,
+		const size_t count,
+		const StridedSpan<glm::vec3>& positions,
+		const StridedSpan<glm::quat>& orientations,
+		const StridedSpan<glm::vec3>& scales
+	);
+
+	/**
+	 * Recomputes the model and normal matrices of all dirty entries, four entries at a time where SSE2 is available.
+	 */
+	void update();
+
+	const glm::mat4& modelMatrix(const uint32 index) const;
+	const glm::mat3& normalMatrix(const uint32 index) const;
+
+private:
+	std::vector<glm::vec3> positions_;
+	std::vector<glm::quat> orientations_;
+	std::vector<glm::vec3> scales_;
+	std::vector<glm::mat4> modelMatrices_;
+	std::vector<glm::mat3> normalMatrices_;
+
+	std::vector<uint8> dirty_;
+	std::vector<uint32> dirtyIndices_;
+	std::vector<uint32> freeIndices_;
+
+	void markDirty(const uint32 index);
+};
+
+}
+}
+}
+}
+
+#endif /* TRANSFORMSTORE_GL33_H_ */
@@ -0,0 +1,113 @@
+#ifndef VERTEXFORMAT_GL33_H_
+#define VERTEXFORMAT_GL33_H_
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+enum class VertexFormat : uint8
+{
+	/**
+	 * Interleaved FloatVertex (48 bytes per vertex).
+	 */
+	FLOAT = 0,
+
+	/**
+	 * Interleaved CompactVertex (20 bytes per vertex).
+	 */
+	COMPACT
+};
+
+/**
+ * An interleaved vertex with 32 bit float attributes.
+ */
+struct FloatVertex
+{
+	glm::vec3 position;
+	glm::vec4 color;
+	glm::vec3 normal;
+	glm::vec2 textureCoordinate;
+};
+
+static_assert(sizeof(FloatVertex) == 48, "FloatVertex must be tightly packed");
+
+/**
+ * An interleaved, quantized vertex:
+ *
+ * - position: snorm16 relative to the mesh bounds (w is padding)
+ * - normal: octahedral encoded snorm16
+ * - color: unorm8
+ * - textureCoordinate: half float
+ */
+struct CompactVertex
+{
+	int16 position[4];
+	int16 normal[2];
+	uint8 color[4];
+	uint16 textureCoordinate[2];
+};
+
+static_assert(sizeof(CompactVertex) == 20, "CompactVertex must be tightly packed");
+
+/**
+ * Compact vertices of a mesh along with what the vertex shader needs to undo the position quantization, i.e.
+ * position = positionBias + positionScale * quantizedPosition.
+ */
+struct CompactVertices
+{
+	std::vector<CompactVertex> vertices;
+	glm::vec3 positionScale = glm::vec3(1.0f);
+	glm::vec3 positionBias = glm::vec3(0.0f);
+};
+
+/**
+ * Returns the size in bytes of one vertex of the given format.
+ */
+size_t vertexSize(const VertexFormat vertexFormat);
+
+/**
+ * Interleaves the given vertex attributes.
+ *
+ * Missing colors, normals or texture coordinates (i.e. empty vectors) are filled with zero.
+ */
+std::vector<FloatVertex> floatVertices(
+	const std::vector<glm::vec3>& vertices,
+	const std::vector<glm::vec4>& colors,
+	const std::vector<glm::vec3>& normals,
+	const std::vector<glm::vec2>& textureCoordinates
+);
+
+/**
+ * Quantizes and interleaves the given vertex attributes.
+ *
+ * Missing colors, normals or texture coordinates (i.e. empty vectors) are filled with zero, (0, 0, 1) and zero.
+ */
+CompactVertices compactVertices(
+	const std::vector<glm::vec3>& vertices,
+	const std::vector<glm::vec4>& colors,
+	const std::vector<glm::vec3>& normals,
+	const std::vector<glm::vec2>& textureCoordinates
+);
+
+/**
+ * Maps a unit vector onto the [-1, 1] square (octahedral encoding). A zero vector encodes as (0, 0, 1).
+ */
+glm::vec2 octahedralEncode(const glm::vec3& normal);
+
+}
+}
+}
+}
+
+#endif /* VERTEXFORMAT_GL33_H_ */
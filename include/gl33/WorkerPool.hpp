@@ -0,0 +1,77 @@
+#ifndef WORKERPOOL_GL33_H_
+#define WORKERPOOL_GL33_H_
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Types.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+/**
+ * Worker threads that live as long as the pool, so splitting work over threads costs a wake up instead of creating and
+ * joining threads every time.
+ *
+ * run() hands out jobs to the workers and the calling thread, which makes threadCount() threads in total.
+ */
+class WorkerPool
+{
+public:
+	/**
+	 * Starts threadCount - 1 workers, or one less than the hardware has if threadCount is 0.
+	 */
+	explicit WorkerPool(const uint32 threadCount = 0);
+	WorkerPool(const WorkerPool& other) = delete;
+	WorkerPool& operator=(const WorkerPool& other) = delete;
+	~WorkerPool();
+
+	/**
+	 * Calls job(i) for every i in [0, jobCount) and returns once every call has returned. If jobs throw, the first
+	 * exception is rethrown here. Only one thread may call run() at a time.
+	 */
+	void run(const uint32 jobCount, const std::function<void(const uint32)>& job);
+
+	uint32 threadCount() const;
+
+private:
+	std::mutex mutex_;
+	std::condition_variable jobsAvailable_;
+	std::condition_variable jobsFinished_;
+
+	const std::function<void(const uint32)>* job_ = nullptr;
+	uint32 jobCount_ = 0;
+	uint32 nextJob_ = 0;
+	uint32 unfinishedJobs_ = 0;
+	std::exception_ptr exception_;
+	bool stop_ = false;
+
+	// Started last, so everything above exists before the workers run
+	std::vector<std::thread> threads_;
+
+	void work();
+
+	/**
+	 * Runs jobs until none are left to take. Called with lock held, which is released while a job runs.
+	 */
+	void runJobs(std::unique_lock<std::mutex>& lock);
+
+	void stop();
+};
+
+}
+}
+}
+}
+
+#endif /* WORKERPOOL_GL33_H_ */
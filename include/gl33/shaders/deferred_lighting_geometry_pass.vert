@@ -1,20 +1,19 @@
 // Adapted from: https://github.com/JoeyDeVries/LearnOpenGL/blob/master/src/5.advanced_lighting/8.1.deferred_shading/8.1.g_buffer.vs
 #version 330 core
 
-uniform mat4 projectionMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 modelMatrix;
-uniform mat4 pvmMatrix;
-uniform mat3 normalMatrix;
-uniform bool hasBones = false;
-uniform bool hasBoneAttachment = false;
-uniform ivec4 boneAttachmentIds;
-uniform vec4 boneAttachmentWeights;
+// Bones and compact vertices are read with the functions of octahedral.glsl and skinning.glsl, inserted when the
+// shader is loaded
 
-layout (std140) uniform Bones
+layout (std140) uniform FrameData
 {
-	mat4 bones[100];
-};
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	mat4 lightSpaceMatrix;
+	vec4 cameraPosition;
+	vec2 viewport;
+	float time;
+} frameData;
 
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec4 color;
@@ -22,6 +21,11 @@ layout (location = 2) in vec3 normal;
 layout (location = 3) in vec2 textureCoordinate;
 layout (location = 4) in ivec4 boneIds;
 layout (location = 5) in vec4 boneWeights;
+layout (location = 6) in mat4 modelMatrix;
+layout (location = 10) in mat3 normalMatrix;
+layout (location = 13) in int bonePalette;
+layout (location = 14) in ivec4 boneAttachmentIds;
+layout (location = 15) in vec4 boneAttachmentWeights;
 
 out vec3 FragPos;
 out vec2 TexCoords;
@@ -29,30 +33,31 @@ out vec3 Normal;
 
 void main()
 {
-	vec4 tempModelSpacePosition = vec4(position, 1.0);
+	vec3 meshPosition = positionBias + positionScale * position;
+	vec3 meshNormal = compactVertexFormat ? octahedralDecode(normal.xy) : normal;
+	
+	vec4 tempModelSpacePosition = vec4(meshPosition, 1.0);
+	
+	// Bone attachments follow the bones given per instance instead of the bones of their vertices
+	bool hasBoneAttachment = (bonePalette >= 0 && boneAttachmentWeights != vec4(0.0));
+	bool hasBones = (bonePalette >= 0 && !hasBoneAttachment);
 	
 	if (hasBones)
 	{
 		// Calculate the transformation on the vertex position based on the bone weightings
-		mat4 boneTransform = bones[ boneIds[0] ] * boneWeights[0];
-		boneTransform     += bones[ boneIds[1] ] * boneWeights[1];
-		boneTransform     += bones[ boneIds[2] ] * boneWeights[2];
-		boneTransform     += bones[ boneIds[3] ] * boneWeights[3];
+		mat4 boneTransform = blendBones(bonePalette, boneIds, boneWeights);
 	
 		//mat4 tempM = mat4(1.0);
 		//boneTransform = tempM;
 	
 		// This is for animating the model
-		tempModelSpacePosition = boneTransform * vec4(position, 1.0);
+		tempModelSpacePosition = boneTransform * vec4(meshPosition, 1.0);
 	}
 	if (hasBoneAttachment)
 	{
-		mat4 boneTransform = bones[ boneAttachmentIds[0] ] * boneAttachmentWeights[0];
-		boneTransform     += bones[ boneAttachmentIds[1] ] * boneAttachmentWeights[1];
-		boneTransform     += bones[ boneAttachmentIds[2] ] * boneAttachmentWeights[2];
-		boneTransform     += bones[ boneAttachmentIds[3] ] * boneAttachmentWeights[3];
+		mat4 boneTransform = blendBones(bonePalette, boneAttachmentIds, boneAttachmentWeights);
 		
-		tempModelSpacePosition = boneTransform * vec4(position, 1.0);
+		tempModelSpacePosition = boneTransform * vec4(meshPosition, 1.0);
 	}
 
 //	vec4 worldPos = modelMatrix * vec4(position, 1.0);
@@ -60,11 +65,9 @@ void main()
     FragPos = worldPos.xyz; 
     TexCoords = textureCoordinate;
     
-    mat3 normalMatrix2 = transpose(inverse(mat3(modelMatrix)));
-    Normal = normalMatrix2 * normal;
+    Normal = normalMatrix * meshNormal;
     
-//    gl_Position = pvmMatrix * vec4(position, 1.0);
-    gl_Position = pvmMatrix * tempModelSpacePosition;
+    gl_Position = frameData.viewProjection * worldPos;
 
     //gl_Position = projection * view * worldPos;
     
@@ -0,0 +1,74 @@
+#version 330 core
+
+layout (location = 0) out vec3 gPosition;
+layout (location = 1) out vec3 gNormal;
+layout (location = 2) out vec4 gAlbedoSpec;
+layout (location = 3) out vec3 gMetallicRoughnessAmbientOcclusion;
+
+in vec3 Position;
+in vec2 TexCoords;
+in vec3 FragPos;
+in vec3 Normal;
+
+// Resident tiles, see StreamedTerrain
+uniform usampler2DArray terrainMapTiles;
+uniform isampler2D tileSlots;
+uniform float tileSize = 64.0;
+uniform usampler2D terrainMapOverview;
+uniform float overviewStep = 16.0;
+uniform sampler2DArray splatMapAlbedoTextures;
+uniform sampler2DArray splatMapNormalTextures;
+uniform sampler2DArray splatMapMetallicRoughnessAmbientOcclusionTextures;
+
+uvec4 terrainMapTexel(vec2 position)
+{
+	ivec2 tileCount = textureSize(tileSlots, 0);
+	ivec2 tile = min(ivec2(position / tileSize), tileCount - 1);
+	ivec2 tilePosition = min(ivec2(position - vec2(tile) * tileSize), ivec2(tileSize));
+	
+	int slot = texelFetch(tileSlots, tile, 0).r;
+	
+	// Nearest sample of the overview when the tile is not resident
+	if (slot < 0)
+	{
+		return texelFetch(terrainMapOverview, min(ivec2(position / overviewStep + 0.5), textureSize(terrainMapOverview, 0) - 1), 0);
+	}
+	
+	return texelFetch(terrainMapTiles, ivec3(tilePosition, slot), 0);
+}
+
+void main()
+{
+    // store the fragment position vector in the first gbuffer texture
+    gPosition = FragPos;
+    // also store the per-fragment normals into the gbuffer
+    gNormal = normalize(Normal);
+    // and the diffuse per-fragment color
+    
+    uvec4 terrainMap = terrainMapTexel(Position.xz);
+    
+    uint whichTexture0 = terrainMap.r;
+    uint whichTexture1 = terrainMap.g;
+    uint whichTexture2 = terrainMap.b;
+    
+    uint whichTexturePercentAsUint0 = terrainMap.a >> 4;
+    uint whichTexturePercentAsUint1 = (terrainMap.a << 28) >> 28;
+    
+    float whichTexturePercent0 = float(whichTexturePercentAsUint0) / 16.0f;
+    float whichTexturePercent1 = float(whichTexturePercentAsUint1) / 16.0f;
+    float whichTexturePercent2 = 1.0f - whichTexturePercent0 - whichTexturePercent1;
+    
+    gAlbedoSpec.rgb = 	texture(splatMapAlbedoTextures, vec3(TexCoords, whichTexture0)).rgb * whichTexturePercent0 +
+						texture(splatMapAlbedoTextures, vec3(TexCoords, whichTexture1)).rgb * whichTexturePercent1 +
+						texture(splatMapAlbedoTextures, vec3(TexCoords, whichTexture2)).rgb * whichTexturePercent2
+						;
+
+    //gAlbedoSpec.rgb = vec3(0.3f, 0.3f, 0.3f);
+    // store specular intensity in gAlbedoSpec's alpha component
+    gAlbedoSpec.a = 0.1f; //texture(texture_specular1, TexCoords).r;
+    
+    gMetallicRoughnessAmbientOcclusion.rgb = 	texture(splatMapMetallicRoughnessAmbientOcclusionTextures, vec3(TexCoords, whichTexture0)).rgb * whichTexturePercent0 +
+												texture(splatMapMetallicRoughnessAmbientOcclusionTextures, vec3(TexCoords, whichTexture1)).rgb * whichTexturePercent1 +
+												texture(splatMapMetallicRoughnessAmbientOcclusionTextures, vec3(TexCoords, whichTexture2)).rgb * whichTexturePercent2
+												;
+}
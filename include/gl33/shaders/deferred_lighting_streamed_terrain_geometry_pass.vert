@@ -0,0 +1,98 @@
+#version 330 core
+
+layout (std140) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	mat4 lightSpaceMatrix;
+	vec4 cameraPosition;
+	vec2 viewport;
+	float time;
+} frameData;
+
+uniform mat4 modelMatrix;
+uniform mat3 normalMatrix;
+
+// Number of height map samples along x and z
+uniform vec2 terrainSize;
+
+// Camera position in terrain space, where levels of detail are selected
+uniform vec3 terrainCameraPosition;
+
+// Quads along one side of the patch
+uniform float chunkResolution = 16.0;
+
+// Patch vertex, in quads from the corner of the chunk
+layout (location = 0) in vec2 gridPosition;
+
+// Per chunk, see TerrainChunk: offset and size in grid units, level of detail, and the distances of the morph
+layout (location = 4) in vec4 chunk;
+layout (location = 5) in vec2 morphRange;
+
+// Resident tiles, see StreamedTerrain. A tile has tileSize + 1 samples per side, tileSlots holds the layer of every
+// tile, or -1 when it is not resident. Tiles are laid out as the height map of a static terrain, height in r and
+// octahedral encoded normal in gb, see packHeightNormals()
+uniform sampler2DArray heightMapTiles;
+uniform isampler2D tileSlots;
+uniform float tileSize = 64.0;
+
+// Every overviewStep-th sample of the whole terrain, always resident
+uniform sampler2D heightMapOverview;
+uniform float overviewStep = 16.0;
+
+// Height of the full range of the height map
+uniform float heightScale = 15.0;
+
+out vec3 Position;
+out vec3 FragPos;
+out vec2 TexCoords;
+out vec3 Normal;
+
+// Samples on the edge between two tiles are stored in both, so the later tile is as good as the earlier one
+vec4 heightMapTexel(vec2 position)
+{
+	ivec2 tileCount = textureSize(tileSlots, 0);
+	ivec2 tile = min(ivec2(position / tileSize), tileCount - 1);
+	vec2 tilePosition = position - vec2(tile) * tileSize;
+	
+	int slot = texelFetch(tileSlots, tile, 0).r;
+	
+	if (slot < 0)
+	{
+		return textureLod(heightMapOverview, (position / overviewStep + 0.5) / vec2(textureSize(heightMapOverview, 0)), 0.0);
+	}
+	
+	return textureLod(heightMapTiles, vec3((tilePosition + 0.5) / (tileSize + 1.0), float(slot)), 0.0);
+}
+
+void main()
+{
+	float quadSize = chunk.z / chunkResolution;
+	vec2 position = chunk.xy + gridPosition * quadSize;
+	
+	// Distance to the vertical line through the vertex within the height range, as in the static terrain
+	float halfHeightScale = heightScale * 0.5;
+	vec3 closest = vec3(position.x, clamp(terrainCameraPosition.y, -halfHeightScale, halfHeightScale), position.y);
+	float morph = clamp((distance(terrainCameraPosition, closest) - morphRange.x) / (morphRange.y - morphRange.x), 0.0, 1.0);
+	
+	// Odd vertices slide onto their even neighbours, which are the vertices of the next coarser level
+	position = chunk.xy + (gridPosition - fract(gridPosition * 0.5) * 2.0 * morph) * quadSize;
+	
+	// Chunks at the far edges may reach past the last sample
+	position = min(position, terrainSize - 1.0);
+	
+	Position = vec3(position.x, 0.0, position.y);
+
+	vec4 heightNormal = heightMapTexel(position);
+	vec3 newPosition = vec3(position.x, heightScale * (heightNormal.r - 0.5), position.y);
+	
+	vec4 worldPos = modelMatrix * vec4(newPosition, 1.0);
+	FragPos = worldPos.xyz;
+	
+	Normal = normalMatrix * octahedralDecode(heightNormal.gb * 2.0 - 1.0).xzy;
+	
+	TexCoords = position / 16;
+	
+	gl_Position = frameData.viewProjection * worldPos;
+}
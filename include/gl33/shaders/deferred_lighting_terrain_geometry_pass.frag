@@ -11,6 +11,9 @@ in vec2 TexCoords;
 in vec3 FragPos;
 in vec3 Normal;
 
+// Number of height map samples along x and z
+uniform vec2 terrainSize;
+
 uniform usampler2D terrainMapTexture;
 uniform sampler2DArray splatMapAlbedoTextures;
 uniform sampler2DArray splatMapNormalTextures;
@@ -24,12 +27,14 @@ void main()
     gNormal = normalize(Normal);
     // and the diffuse per-fragment color
     
-    uint whichTexture0 = texture(terrainMapTexture, Position.xz/257).r;
-    uint whichTexture1 = texture(terrainMapTexture, Position.xz/257).g;
-    uint whichTexture2 = texture(terrainMapTexture, Position.xz/257).b;
+    uvec4 terrainMap = texture(terrainMapTexture, Position.xz/terrainSize);
+    
+    uint whichTexture0 = terrainMap.r;
+    uint whichTexture1 = terrainMap.g;
+    uint whichTexture2 = terrainMap.b;
     
-    uint whichTexturePercentAsUint0 = texture(terrainMapTexture, Position.xz/257).a >> 4;
-    uint whichTexturePercentAsUint1 = (texture(terrainMapTexture, Position.xz/257).a << 28) >> 28;
+    uint whichTexturePercentAsUint0 = terrainMap.a >> 4;
+    uint whichTexturePercentAsUint1 = (terrainMap.a << 28) >> 28;
     
     float whichTexturePercent0 = float(whichTexturePercentAsUint0) / 16.0f;
     float whichTexturePercent1 = float(whichTexturePercentAsUint1) / 16.0f;
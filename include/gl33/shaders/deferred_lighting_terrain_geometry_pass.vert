@@ -1,49 +1,76 @@
 // Adapted from: https://github.com/JoeyDeVries/LearnOpenGL/blob/master/src/5.advanced_lighting/8.1.deferred_shading/8.1.g_buffer.vs
 #version 330 core
 
-uniform mat4 projectionMatrix;
-uniform mat4 viewMatrix;
+layout (std140) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	mat4 lightSpaceMatrix;
+	vec4 cameraPosition;
+	vec2 viewport;
+	float time;
+} frameData;
+
 uniform mat4 modelMatrix;
-uniform mat4 pvmMatrix;
 uniform mat3 normalMatrix;
 
-layout (location = 0) in vec3 position;
-layout (location = 1) in vec4 color;
-layout (location = 2) in vec3 normal;
-layout (location = 3) in vec2 textureCoordinate;
+// Number of height map samples along x and z
+uniform vec2 terrainSize;
+
+// Camera position in terrain space, where levels of detail are selected
+uniform vec3 terrainCameraPosition;
+
+// Quads along one side of the patch
+uniform float chunkResolution = 16.0;
+
+// Patch vertex, in quads from the corner of the chunk
+layout (location = 0) in vec2 gridPosition;
 
+// Per chunk, see TerrainChunk: offset and size in grid units, level of detail, and the distances of the morph
+layout (location = 4) in vec4 chunk;
+layout (location = 5) in vec2 morphRange;
+
+// Height in r and octahedral encoded normal in gb, with y and z swapped so up is the unfolded side, see
+// packHeightNormals()
 uniform sampler2D heightMapTexture;
 
+// Height of the full range of the height map
+uniform float heightScale = 15.0;
+
 out vec3 Position;
 out vec3 FragPos;
 out vec2 TexCoords;
 out vec3 Normal;
 
-const float MAX_HEIGHT = 15.0f;
-
 void main()
 {
-	Position = position;
-
-	vec4 textureValue = texture(heightMapTexture, position.xz/257);
-	//float height = MAX_HEIGHT * (textureValue.a - 1.0f);
-	float height = MAX_HEIGHT * (textureValue.a - 0.5f);
-	//float height = MAX_HEIGHT * textureValue.a;
-	vec3 newPosition = vec3(position.x, height, position.z);
-	
-    vec4 worldPos = modelMatrix * vec4(newPosition, 1.0);
-    FragPos = worldPos.xyz; 
-    /*
-    TexCoords = textureCoordinate;
-    */
-    mat3 normalMatrix2 = transpose(inverse(mat3(modelMatrix)));
-    Normal = normalMatrix2 * textureValue.rgb;
-    
-    TexCoords = position.xz/16;
-    
-    gl_Position = pvmMatrix * vec4(newPosition, 1.0);
-
-    //gl_Position = projection * view * worldPos;
-    
-	//texCoord = textureCoordinate;
+	float quadSize = chunk.z / chunkResolution;
+	vec2 position = chunk.xy + gridPosition * quadSize;
+	
+	// Distance to the vertical line through the vertex within the height range, like the node bounds the quadtree
+	// selects with, so the height map is only sampled once
+	float halfHeightScale = heightScale * 0.5;
+	vec3 closest = vec3(position.x, clamp(terrainCameraPosition.y, -halfHeightScale, halfHeightScale), position.y);
+	float morph = clamp((distance(terrainCameraPosition, closest) - morphRange.x) / (morphRange.y - morphRange.x), 0.0, 1.0);
+	
+	// Odd vertices slide onto their even neighbours, which are the vertices of the next coarser level
+	position = chunk.xy + (gridPosition - fract(gridPosition * 0.5) * 2.0 * morph) * quadSize;
+	
+	// Chunks at the far edges may reach past the last sample
+	position = min(position, terrainSize - 1.0);
+	
+	Position = vec3(position.x, 0.0, position.y);
+
+	vec4 heightNormal = textureLod(heightMapTexture, (position + 0.5) / terrainSize, 0.0);
+	vec3 newPosition = vec3(position.x, heightScale * (heightNormal.r - 0.5), position.y);
+	
+	vec4 worldPos = modelMatrix * vec4(newPosition, 1.0);
+	FragPos = worldPos.xyz;
+	
+	Normal = normalMatrix * octahedralDecode(heightNormal.gb * 2.0 - 1.0).xzy;
+	
+	TexCoords = position / 16;
+	
+	gl_Position = frameData.viewProjection * worldPos;
 }
@@ -0,0 +1,23 @@
+#version 330 core
+
+// Number of height map samples along x and z
+uniform vec2 terrainSize;
+
+// Quads along one side of the patch
+uniform float chunkResolution = 8.0;
+
+// Patch vertex, in quads from the corner of the chunk
+layout (location = 0) in vec2 gridPosition;
+
+// Per chunk, see TerrainChunk: offset and size in grid units
+layout (location = 4) in vec4 chunk;
+
+out vec2 ControlPosition;
+
+void main()
+{
+	vec2 position = chunk.xy + gridPosition * (chunk.z / chunkResolution);
+	
+	// Chunks at the far edges may reach past the last sample
+	ControlPosition = min(position, terrainSize - 1.0);
+}
@@ -32,9 +32,16 @@ const int NR_LIGHTS = 6;
 const int NR_DIRECTIONAL_LIGHTS = 1;
 uniform Light lights[NR_LIGHTS];
 uniform DirectionalLight directionalLights[NR_DIRECTIONAL_LIGHTS];
-uniform vec3 lightPos;
-uniform vec3 viewPos;
-uniform mat4 lightSpaceMatrix;
+layout (std140) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	mat4 lightSpaceMatrix;
+	vec4 cameraPosition;
+	vec2 viewport;
+	float time;
+} frameData;
 
 const float PI = 3.14159265359;
 
@@ -251,7 +258,7 @@ void main()
 	float ao = texture(gMetallicRoughnessAmbientOcclusion, TexCoords).b;
 
 	vec3 N = tangentNormal;//tangentNormalSpaceToWorldSpace(tangentNormal, WorldPos, TexCoords);
-    vec3 V = normalize(viewPos - WorldPos);
+    vec3 V = normalize(frameData.cameraPosition.xyz - WorldPos);
 
     // calculate reflectance at normal incidence; if dia-electric (like plastic) use F0
     // of 0.04 and if it's a metal, use the albedo color as F0 (metallic workflow)
@@ -333,7 +340,7 @@ void main()
         //Lo += (kD * albedo / PI + specular) * radiance * NdotL;  // note that we already multiplied the BRDF by the Fresnel (kS) so we won't multiply by kS again
 
         // Shadow mapping
-	    vec4 FragPosLightSpace = lightSpaceMatrix * vec4(WorldPos, 1.0);
+	    vec4 FragPosLightSpace = frameData.lightSpaceMatrix * vec4(WorldPos, 1.0);
 	    float shadow = ShadowCalculation(FragPosLightSpace, normalize(tangentNormal), L);
 	    //lighting -= (0.2 * vec3(shadow, shadow, shadow));
 
@@ -1,16 +1,24 @@
 // Source: http://bulletphysics.org/Bullet/phpBB3/viewtopic.php?t=11517
 #version 330 core
 layout (location = 0) in vec3 position;
-layout (location = 1) in vec3 color;
+layout (location = 1) in vec4 color;
 
-out vec3 ourColor;
+out vec4 ourColor;
 
-uniform mat4 projectionMatrix;
-uniform mat4 viewMatrix;
+layout (std140) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	mat4 lightSpaceMatrix;
+	vec4 cameraPosition;
+	vec2 viewport;
+	float time;
+} frameData;
 
 void main()
 {
-    gl_Position = projectionMatrix * viewMatrix * vec4(position, 1.0f);
+    gl_Position = frameData.viewProjection * vec4(position, 1.0f);
 
     ourColor = color;
 }
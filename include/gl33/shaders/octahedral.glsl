@@ -0,0 +1,14 @@
+// Inverse of octahedralEncode() in VertexFormat.hpp, for e in [-1, 1]^2. loadShaderContents() inserts it after the
+// #version line of the shaders that decode normals.
+
+vec3 octahedralDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	
+	if (n.z < 0.0)
+	{
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	}
+	
+	return normalize(n);
+}
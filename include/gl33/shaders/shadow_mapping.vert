@@ -1,11 +1,44 @@
 // Source: https://learnopengl.com/code_viewer_gh.php?code=src/5.advanced_lighting/3.1.2.shadow_mapping_base/3.1.2.shadow_mapping_depth.vs
 #version 330 core
+
+// Bones and compact vertices are read with the functions of octahedral.glsl and skinning.glsl, inserted when the
+// shader is loaded
+
 layout (location = 0) in vec3 aPos;
+layout (location = 4) in ivec4 boneIds;
+layout (location = 5) in vec4 boneWeights;
+layout (location = 6) in mat4 modelMatrix;
+layout (location = 13) in int bonePalette;
+layout (location = 14) in ivec4 boneAttachmentIds;
+layout (location = 15) in vec4 boneAttachmentWeights;
 
-uniform mat4 lightSpaceMatrix;
-uniform mat4 modelMatrix;
+layout (std140) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	mat4 lightSpaceMatrix;
+	vec4 cameraPosition;
+	vec2 viewport;
+	float time;
+} frameData;
 
 void main()
 {
-    gl_Position = lightSpaceMatrix * modelMatrix * vec4(aPos, 1.0);
+	vec4 modelSpacePosition = vec4(positionBias + positionScale * aPos, 1.0);
+	
+	// Same as the geometry pass, so shadows follow the bones of instances that are not posed beforehand
+	bool hasBoneAttachment = (bonePalette >= 0 && boneAttachmentWeights != vec4(0.0));
+	bool hasBones = (bonePalette >= 0 && !hasBoneAttachment);
+	
+	if (hasBones)
+	{
+		modelSpacePosition = blendBones(bonePalette, boneIds, boneWeights) * modelSpacePosition;
+	}
+	if (hasBoneAttachment)
+	{
+		modelSpacePosition = blendBones(bonePalette, boneAttachmentIds, boneAttachmentWeights) * modelSpacePosition;
+	}
+	
+	gl_Position = frameData.lightSpaceMatrix * modelMatrix * modelSpacePosition;
 }
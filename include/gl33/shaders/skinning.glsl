@@ -0,0 +1,95 @@
+// Shared by every vertex shader that reads mesh vertices, after octahedral.glsl. loadShaderContents() inserts both after
+// the #version line.
+
+// Bone palettes of every skinned instance of the frame, see BoneFormat.hpp for the layout of a bone
+uniform samplerBuffer bonePalettes;
+uniform int bonePaletteBase = 0;
+
+// 0: mat4 (4 texels), 1: mat3x4 rows (3 texels), 2: dual quaternion (2 texels)
+uniform int boneFormat = 0;
+
+// Compact meshes store positions as snorm16 relative to their bounds and normals octahedral encoded
+uniform bool compactVertexFormat = false;
+uniform vec3 positionScale = vec3(1.0);
+uniform vec3 positionBias = vec3(0.0);
+
+// palette is the first texel of the mesh's palette, relative to the frame's bone palettes
+int boneTexel(int palette, int boneId)
+{
+	int texelsPerBone = (boneFormat == 1) ? 3 : ((boneFormat == 2) ? 2 : 4);
+	
+	return bonePaletteBase + palette + boneId * texelsPerBone;
+}
+
+mat4 bone(int palette, int boneId)
+{
+	int texel = boneTexel(palette, boneId);
+	
+	return mat4(
+		texelFetch(bonePalettes, texel),
+		texelFetch(bonePalettes, texel + 1),
+		texelFetch(bonePalettes, texel + 2),
+		texelFetch(bonePalettes, texel + 3)
+	);
+}
+
+mat4 blendBones(int palette, ivec4 ids, vec4 weights)
+{
+	if (boneFormat == 1)
+	{
+		// Blend the rows, the last row of an affine matrix is always (0, 0, 0, 1)
+		vec4 rows[3] = vec4[3](vec4(0.0), vec4(0.0), vec4(0.0));
+		
+		for (int i = 0; i < 4; ++i)
+		{
+			int texel = boneTexel(palette, ids[i]);
+			
+			rows[0] += texelFetch(bonePalettes, texel) * weights[i];
+			rows[1] += texelFetch(bonePalettes, texel + 1) * weights[i];
+			rows[2] += texelFetch(bonePalettes, texel + 2) * weights[i];
+		}
+		
+		return transpose(mat4(rows[0], rows[1], rows[2], vec4(0.0, 0.0, 0.0, 1.0)));
+	}
+	
+	if (boneFormat == 2)
+	{
+		// Dual quaternion linear blending, quaternions in the opposite hemisphere of the first are negated
+		int firstTexel = boneTexel(palette, ids[0]);
+		vec4 firstReal = texelFetch(bonePalettes, firstTexel);
+		vec4 real = vec4(0.0);
+		vec4 dual = vec4(0.0);
+		
+		for (int i = 0; i < 4; ++i)
+		{
+			int texel = boneTexel(palette, ids[i]);
+			vec4 r = texelFetch(bonePalettes, texel);
+			float w = (dot(r, firstReal) < 0.0) ? -weights[i] : weights[i];
+			
+			real += r * w;
+			dual += texelFetch(bonePalettes, texel + 1) * w;
+		}
+		
+		float len = length(real);
+		real /= len;
+		dual /= len;
+		
+		vec3 t = 2.0 * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz));
+		
+		float x = real.x, y = real.y, z = real.z, w = real.w;
+		
+		return mat4(
+			vec4(1.0 - 2.0 * (y * y + z * z), 2.0 * (x * y + w * z), 2.0 * (x * z - w * y), 0.0),
+			vec4(2.0 * (x * y - w * z), 1.0 - 2.0 * (x * x + z * z), 2.0 * (y * z + w * x), 0.0),
+			vec4(2.0 * (x * z + w * y), 2.0 * (y * z - w * x), 1.0 - 2.0 * (x * x + y * y), 0.0),
+			vec4(t, 1.0)
+		);
+	}
+	
+	mat4 boneTransform = bone(palette, ids[0]) * weights[0];
+	boneTransform     += bone(palette, ids[1]) * weights[1];
+	boneTransform     += bone(palette, ids[2]) * weights[2];
+	boneTransform     += bone(palette, ids[3]) * weights[3];
+	
+	return boneTransform;
+}
@@ -0,0 +1,33 @@
+#version 330 core
+
+// Poses the vertices of a skinned mesh once per frame. The outputs are captured with transform feedback, in the layout
+// of FloatVertex, and drawn by both the shadow and the geometry pass. Bones are blended with octahedral.glsl and skinning.glsl, inserted when
+// the shader is loaded.
+
+// First texel of the palette of the mesh being posed, relative to the frame's bone palettes
+uniform int bonePalette = 0;
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec4 color;
+layout (location = 2) in vec3 normal;
+layout (location = 3) in vec2 textureCoordinate;
+layout (location = 4) in ivec4 boneIds;
+layout (location = 5) in vec4 boneWeights;
+
+out vec3 posedPosition;
+out vec4 posedColor;
+out vec3 posedNormal;
+out vec2 posedTextureCoordinate;
+
+void main()
+{
+	vec3 meshPosition = positionBias + positionScale * position;
+	vec3 meshNormal = compactVertexFormat ? octahedralDecode(normal.xy) : normal;
+	
+	mat4 boneTransform = blendBones(bonePalette, boneIds, boneWeights);
+	
+	posedPosition = (boneTransform * vec4(meshPosition, 1.0)).xyz;
+	posedColor = color;
+	posedNormal = normalize(mat3(boneTransform) * meshNormal);
+	posedTextureCoordinate = textureCoordinate;
+}
@@ -4,13 +4,22 @@ layout (location = 0) in vec3 aPos;
 
 out vec3 TexCoords;
 
-uniform mat4 projectionMatrix;
-uniform mat4 viewMatrix;
+layout (std140) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	mat4 lightSpaceMatrix;
+	vec4 cameraPosition;
+	vec2 viewport;
+	float time;
+} frameData;
 
 void main()
 {
     TexCoords = aPos;
     // gl_Position = projectionMatrix * viewMatrix * vec4(aPos, 1.0);
-    vec4 pos = projectionMatrix * viewMatrix * vec4(aPos, 1.0);
+    // Strip the translation from the view matrix so the skybox stays centered on the camera
+    vec4 pos = frameData.projection * mat4(mat3(frameData.view)) * vec4(aPos, 1.0);
     gl_Position = pos.xyww;
 }
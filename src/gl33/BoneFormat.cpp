@@ -0,0 +1,243 @@
+#include <cstring>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include "gl33/BoneFormat.hpp"
+#include "gl33/Simd.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+namespace
+{
+
+void packMat3x4(const glm::mat4* bones, const size_t count, glm::vec4* texels)
+{
+#if defined(ICE_ENGINE_SSE2)
+	for (size_t i = 0; i < count; ++i)
+	{
+		__m128 row0 = _mm_loadu_ps(&bones[i][0][0]);
+		__m128 row1 = _mm_loadu_ps(&bones[i][1][0]);
+		__m128 row2 = _mm_loadu_ps(&bones[i][2][0]);
+		__m128 row3 = _mm_loadu_ps(&bones[i][3][0]);
+
+		// Columns in, rows out
+		_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+
+		_mm_storeu_ps(&texels[i * 3][0], row0);
+		_mm_storeu_ps(&texels[i * 3 + 1][0], row1);
+		_mm_storeu_ps(&texels[i * 3 + 2][0], row2);
+	}
+#else
+	for (size_t i = 0; i < count; ++i)
+	{
+		const auto& bone = bones[i];
+
+		for (glm::length_t row = 0; row < 3; ++row)
+		{
+			texels[i * 3 + row] = glm::vec4(bone[0][row], bone[1][row], bone[2][row], bone[3][row]);
+		}
+	}
+#endif
+}
+
+#if defined(ICE_ENGINE_SSE2)
+/**
+ * Loads column of 4 bones and transposes it, so x, y and z each hold one component of the 4 columns.
+ */
+void loadColumn(const glm::mat4* bones, const glm::length_t column, __m128& x, __m128& y, __m128& z)
+{
+	__m128 c0 = _mm_loadu_ps(&bones[0][column][0]);
+	__m128 c1 = _mm_loadu_ps(&bones[1][column][0]);
+	__m128 c2 = _mm_loadu_ps(&bones[2][column][0]);
+	__m128 c3 = _mm_loadu_ps(&bones[3][column][0]);
+
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+	x = c0;
+	y = c1;
+	z = c2;
+}
+
+void normalize(__m128& x, __m128& y, __m128& z)
+{
+	const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+
+	x = _mm_div_ps(x, length);
+	y = _mm_div_ps(y, length);
+	z = _mm_div_ps(z, length);
+}
+
+__m128 select(const __m128 mask, const __m128 a, const __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+#endif
+
+void packDualQuaternions(const glm::mat4* bones, const size_t count, glm::vec4* texels)
+{
+	size_t i = 0;
+
+#if defined(ICE_ENGINE_SSE2)
+	// Four bones per iteration, one bone per lane. Follows the scalar loop below, with glm::quat_cast's choice of the
+	// largest component made with masks instead of branches.
+	for (; i + 4 <= count; i += 4)
+	{
+		// mCR is row R of column C, as in glm's m[C][R]
+		__m128 m00, m01, m02, m10, m11, m12, m20, m21, m22, tx, ty, tz;
+
+		loadColumn(&bones[i], 0, m00, m01, m02);
+		loadColumn(&bones[i], 1, m10, m11, m12);
+		loadColumn(&bones[i], 2, m20, m21, m22);
+		loadColumn(&bones[i], 3, tx, ty, tz);
+
+		// Remove scale, the rotation has to be pure
+		normalize(m00, m01, m02);
+		normalize(m10, m11, m12);
+		normalize(m20, m21, m22);
+
+		const __m128 fourWSquaredMinus1 = _mm_add_ps(_mm_add_ps(m00, m11), m22);
+		const __m128 fourXSquaredMinus1 = _mm_sub_ps(_mm_sub_ps(m00, m11), m22);
+		const __m128 fourYSquaredMinus1 = _mm_sub_ps(_mm_sub_ps(m11, m00), m22);
+		const __m128 fourZSquaredMinus1 = _mm_sub_ps(_mm_sub_ps(m22, m00), m11);
+
+		// Same tie breaking as glm::quat_cast, a later component wins only if it is strictly bigger
+		const __m128 biggerX = _mm_cmpgt_ps(fourXSquaredMinus1, fourWSquaredMinus1);
+		__m128 biggest = _mm_max_ps(fourWSquaredMinus1, fourXSquaredMinus1);
+		const __m128 biggerY = _mm_cmpgt_ps(fourYSquaredMinus1, biggest);
+		biggest = _mm_max_ps(biggest, fourYSquaredMinus1);
+		const __m128 isZ = _mm_cmpgt_ps(fourZSquaredMinus1, biggest);
+		biggest = _mm_max_ps(biggest, fourZSquaredMinus1);
+
+		const __m128 isY = _mm_andnot_ps(isZ, biggerY);
+		const __m128 isX = _mm_andnot_ps(_mm_or_ps(isZ, biggerY), biggerX);
+
+		const __m128 biggestValue = _mm_mul_ps(_mm_sqrt_ps(_mm_add_ps(biggest, _mm_set1_ps(1.0f))), _mm_set1_ps(0.5f));
+		const __m128 mult = _mm_div_ps(_mm_set1_ps(0.25f), biggestValue);
+
+		const __m128 d12 = _mm_mul_ps(_mm_sub_ps(m12, m21), mult);
+		const __m128 d20 = _mm_mul_ps(_mm_sub_ps(m20, m02), mult);
+		const __m128 d01 = _mm_mul_ps(_mm_sub_ps(m01, m10), mult);
+		const __m128 s01 = _mm_mul_ps(_mm_add_ps(m01, m10), mult);
+		const __m128 s20 = _mm_mul_ps(_mm_add_ps(m20, m02), mult);
+		const __m128 s12 = _mm_mul_ps(_mm_add_ps(m12, m21), mult);
+
+		__m128 w = select(isZ, d01, select(isY, d20, select(isX, d12, biggestValue)));
+		__m128 x = select(isZ, s20, select(isY, s01, select(isX, biggestValue, d12)));
+		__m128 y = select(isZ, s12, select(isY, biggestValue, select(isX, s01, d20)));
+		__m128 z = select(isZ, biggestValue, select(isY, s12, select(isX, s20, d01)));
+
+		const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w))));
+
+		x = _mm_div_ps(x, length);
+		y = _mm_div_ps(y, length);
+		z = _mm_div_ps(z, length);
+		w = _mm_div_ps(w, length);
+
+		// dual = (0, translation) * real / 2
+		const __m128 half = _mm_set1_ps(0.5f);
+		__m128 dualX = _mm_mul_ps(half, _mm_add_ps(_mm_mul_ps(w, tx), _mm_sub_ps(_mm_mul_ps(ty, z), _mm_mul_ps(tz, y))));
+		__m128 dualY = _mm_mul_ps(half, _mm_add_ps(_mm_mul_ps(w, ty), _mm_sub_ps(_mm_mul_ps(tz, x), _mm_mul_ps(tx, z))));
+		__m128 dualZ = _mm_mul_ps(half, _mm_add_ps(_mm_mul_ps(w, tz), _mm_sub_ps(_mm_mul_ps(tx, y), _mm_mul_ps(ty, x))));
+		__m128 dualW = _mm_mul_ps(_mm_set1_ps(-0.5f), _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, x), _mm_mul_ps(ty, y)), _mm_mul_ps(tz, z)));
+
+		// One bone per register again
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		_MM_TRANSPOSE4_PS(dualX, dualY, dualZ, dualW);
+
+		_mm_storeu_ps(&texels[i * 2][0], x);
+		_mm_storeu_ps(&texels[i * 2 + 1][0], dualX);
+		_mm_storeu_ps(&texels[i * 2 + 2][0], y);
+		_mm_storeu_ps(&texels[i * 2 + 3][0], dualY);
+		_mm_storeu_ps(&texels[i * 2 + 4][0], z);
+		_mm_storeu_ps(&texels[i * 2 + 5][0], dualZ);
+		_mm_storeu_ps(&texels[i * 2 + 6][0], w);
+		_mm_storeu_ps(&texels[i * 2 + 7][0], dualW);
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		const auto& bone = bones[i];
+
+		// Remove scale, quat_cast expects a pure rotation
+		const glm::mat3 rotation = glm::mat3(
+			glm::normalize(glm::vec3(bone[0])),
+			glm::normalize(glm::vec3(bone[1])),
+			glm::normalize(glm::vec3(bone[2]))
+		);
+
+		const glm::quat real = glm::normalize(glm::quat_cast(rotation));
+		const glm::vec3 translation = glm::vec3(bone[3]);
+		const glm::quat dual = (glm::quat(0.0f, translation.x, translation.y, translation.z) * real) * 0.5f;
+
+		texels[i * 2] = glm::vec4(real.x, real.y, real.z, real.w);
+		texels[i * 2 + 1] = glm::vec4(dual.x, dual.y, dual.z, dual.w);
+	}
+}
+
+}
+
+const char* boneFormatName(const BoneFormat boneFormat)
+{
+	switch (boneFormat)
+	{
+		case BoneFormat::MAT3X4:
+			return "mat3x4";
+
+		case BoneFormat::DUAL_QUATERNION:
+			return "dualQuaternion";
+
+		default:
+			return "mat4";
+	}
+}
+
+uint32 texelsPerBone(const BoneFormat boneFormat)
+{
+	switch (boneFormat)
+	{
+		case BoneFormat::MAT3X4:
+			return 3;
+
+		case BoneFormat::DUAL_QUATERNION:
+			return 2;
+
+		default:
+			return 4;
+	}
+}
+
+void packBones(const glm::mat4* bones, const size_t count, const BoneFormat boneFormat, std::vector<glm::vec4>& texels)
+{
+	if (count == 0) return;
+
+	const size_t first = texels.size();
+	texels.resize(first + count * texelsPerBone(boneFormat));
+
+	switch (boneFormat)
+	{
+		case BoneFormat::MAT3X4:
+			packMat3x4(bones, count, &texels[first]);
+			break;
+
+		case BoneFormat::DUAL_QUATERNION:
+			packDualQuaternions(bones, count, &texels[first]);
+			break;
+
+		default:
+			std::memcpy(&texels[first], bones, count * sizeof(glm::mat4));
+			break;
+	}
+}
+
+}
+}
+}
+}
@@ -0,0 +1,65 @@
+#include "gl33/BonePose.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+void decomposeBones(const glm::mat4* bones, const size_t count, std::vector<BonePose>& poses)
+{
+	poses.resize(count);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const auto& bone = bones[i];
+		auto& pose = poses[i];
+
+		const glm::mat3 basis = glm::mat3(bone);
+
+		pose.translation = glm::vec3(bone[3]);
+		pose.scale = glm::vec3(glm::length(basis[0]), glm::length(basis[1]), glm::length(basis[2]));
+
+		// Mirrored bones keep the reflection in the scale, quat_cast expects a pure rotation
+		if (glm::determinant(basis) < 0.0f)
+		{
+			pose.scale.x = -pose.scale.x;
+		}
+
+		const glm::mat3 rotation = glm::mat3(basis[0] / pose.scale.x, basis[1] / pose.scale.y, basis[2] / pose.scale.z);
+
+		pose.rotation = glm::normalize(glm::quat_cast(rotation));
+	}
+}
+
+void interpolateBones(const std::vector<BonePose>& from, const std::vector<BonePose>& to, const float32 t, std::vector<glm::mat4>& bones)
+{
+	bones.resize(to.size());
+
+	for (size_t i = 0; i < to.size(); ++i)
+	{
+		const auto& a = from[i];
+		const auto& b = to[i];
+
+		// q and -q are the same rotation, take the one on the short arc
+		const glm::quat target = (glm::dot(a.rotation, b.rotation) < 0.0f ? -b.rotation : b.rotation);
+
+		const glm::mat3 rotation = glm::mat3_cast(glm::slerp(a.rotation, target, t));
+		const glm::vec3 scale = glm::mix(a.scale, b.scale, t);
+
+		bones[i] = glm::mat4(
+			glm::vec4(rotation[0] * scale.x, 0.0f),
+			glm::vec4(rotation[1] * scale.y, 0.0f),
+			glm::vec4(rotation[2] * scale.z, 0.0f),
+			glm::vec4(glm::mix(a.translation, b.translation, t), 1.0f)
+		);
+	}
+}
+
+}
+}
+}
+}
@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <limits>
+
+#include "gl33/Culling.hpp"
+#include "gl33/Simd.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+Frustum frustum(const glm::mat4& viewProjection)
+{
+	// glm is column major, so row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+	const auto row = [&viewProjection](const int i) {
+		return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	};
+
+	Frustum result;
+
+	result.planes[0] = row(3) + row(0);
+	result.planes[1] = row(3) - row(0);
+	result.planes[2] = row(3) + row(1);
+	result.planes[3] = row(3) - row(1);
+	result.planes[4] = row(3) + row(2);
+	result.planes[5] = row(3) - row(2);
+
+	for (auto& plane : result.planes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	return result;
+}
+
+BoundingSphere boundingSphere(const std::vector<glm::vec3>& vertices)
+{
+	BoundingSphere result;
+
+	if (vertices.empty()) return result;
+
+	glm::vec3 minimum = glm::vec3(std::numeric_limits<float32>::max());
+	glm::vec3 maximum = glm::vec3(std::numeric_limits<float32>::lowest());
+
+	for (const auto& vertex : vertices)
+	{
+		minimum = glm::min(minimum, vertex);
+		maximum = glm::max(maximum, vertex);
+	}
+
+	result.center = (minimum + maximum) * 0.5f;
+
+	float32 radiusSquared = 0.0f;
+	for (const auto& vertex : vertices)
+	{
+		const glm::vec3 delta = vertex - result.center;
+		radiusSquared = std::max(radiusSquared, glm::dot(delta, delta));
+	}
+
+	result.radius = glm::sqrt(radiusSquared);
+
+	return result;
+}
+
+BoundingSphere transformBoundingSphere(const BoundingSphere& sphere, const glm::mat4& modelMatrix)
+{
+	const float32 scaleSquared = std::max(
+		std::max(glm::dot(glm::vec3(modelMatrix[0]), glm::vec3(modelMatrix[0])), glm::dot(glm::vec3(modelMatrix[1]), glm::vec3(modelMatrix[1]))),
+		glm::dot(glm::vec3(modelMatrix[2]), glm::vec3(modelMatrix[2]))
+	);
+
+	BoundingSphere result;
+	result.center = glm::vec3(modelMatrix * glm::vec4(sphere.center, 1.0f));
+	result.radius = sphere.radius * glm::sqrt(scaleSquared);
+
+	return result;
+}
+
+bool intersects(const Frustum& frustum, const BoundingSphere& sphere)
+{
+	for (const auto& plane : frustum.planes)
+	{
+		if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) return false;
+	}
+
+	return true;
+}
+
+void BoundingSphereList::clear()
+{
+	x_.clear();
+	y_.clear();
+	z_.clear();
+	radius_.clear();
+	size_ = 0;
+}
+
+void BoundingSphereList::push(const BoundingSphere& sphere)
+{
+	if (size_ % 4 == 0)
+	{
+		x_.resize(size_ + 4, 0.0f);
+		y_.resize(size_ + 4, 0.0f);
+		z_.resize(size_ + 4, 0.0f);
+		radius_.resize(size_ + 4, 0.0f);
+	}
+
+	x_[size_] = sphere.center.x;
+	y_[size_] = sphere.center.y;
+	z_[size_] = sphere.center.z;
+	radius_[size_] = sphere.radius;
+
+	++size_;
+}
+
+uint32 BoundingSphereList::size() const
+{
+	return size_;
+}
+
+BoundingSphere BoundingSphereList::sphere(const uint32 index) const
+{
+	BoundingSphere sphere;
+	sphere.center = glm::vec3(x_[index], y_[index], z_[index]);
+	sphere.radius = radius_[index];
+
+	return sphere;
+}
+
+void BoundingSphereList::cull(const Frustum& frustum, std::vector<uint8>& visible) const
+{
+	visible.resize(x_.size());
+
+#if defined(ICE_ENGINE_SSE2)
+	__m128 planeX[6];
+	__m128 planeY[6];
+	__m128 planeZ[6];
+	__m128 planeW[6];
+
+	for (int p = 0; p < 6; ++p)
+	{
+		planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+		planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+		planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+		planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+	}
+
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+
+	for (size_t i = 0; i < x_.size(); i += 4)
+	{
+		const __m128 x = _mm_loadu_ps(&x_[i]);
+		const __m128 y = _mm_loadu_ps(&y_[i]);
+		const __m128 z = _mm_loadu_ps(&z_[i]);
+		const __m128 negativeRadius = _mm_xor_ps(_mm_loadu_ps(&radius_[i]), signMask);
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+		for (int p = 0; p < 6; ++p)
+		{
+			__m128 distance = _mm_add_ps(_mm_mul_ps(planeX[p], x), planeW[p]);
+			distance = _mm_add_ps(_mm_mul_ps(planeY[p], y), distance);
+			distance = _mm_add_ps(_mm_mul_ps(planeZ[p], z), distance);
+
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+
+		const int mask = _mm_movemask_ps(inside);
+
+		visible[i] = static_cast<uint8>(mask & 1);
+		visible[i + 1] = static_cast<uint8>((mask >> 1) & 1);
+		visible[i + 2] = static_cast<uint8>((mask >> 2) & 1);
+		visible[i + 3] = static_cast<uint8>((mask >> 3) & 1);
+	}
+#else
+	for (size_t i = 0; i < x_.size(); ++i)
+	{
+		BoundingSphere sphere;
+		sphere.center = glm::vec3(x_[i], y_[i], z_[i]);
+		sphere.radius = radius_[i];
+
+		visible[i] = static_cast<uint8>(intersects(frustum, sphere));
+	}
+#endif
+
+	visible.resize(size_);
+}
+
+}
+}
+}
+}
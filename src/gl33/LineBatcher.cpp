@@ -0,0 +1,294 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "gl33/LineBatcher.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+namespace
+{
+
+constexpr GLsizeiptr LINE_VERTEX_ALIGNMENT = 16;
+
+// Pairs of box corners, corners are numbered by their x, y and z bits
+constexpr uint32 BOX_EDGES[12][2] = {
+	{0, 1}, {2, 3}, {4, 5}, {6, 7},
+	{0, 2}, {1, 3}, {4, 6}, {5, 7},
+	{0, 4}, {1, 5}, {2, 6}, {3, 7}
+};
+
+}
+
+uint32 packLineColor(const glm::vec3& color)
+{
+	return glm::packUnorm4x8(glm::vec4(color, 1.0f));
+}
+
+LineBatcher::~LineBatcher()
+{
+	if (valid())
+	{
+		destroy();
+	}
+}
+
+void LineBatcher::generate()
+{
+	if (valid()) throw std::runtime_error("Cannot generate line batcher - line batcher was already created.");
+
+	glGenVertexArrays(1, &vertexArray_);
+
+	if (vertexArray_ == 0)
+	{
+		throw std::runtime_error("Could not create line batcher vertex array.");
+	}
+
+	glBindVertexArray(vertexArray_);
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glBindVertexArray(0);
+
+	glGetFloatv(GL_ALIASED_LINE_WIDTH_RANGE, lineWidthRange_);
+}
+
+void LineBatcher::destroy()
+{
+	if (!valid()) throw std::runtime_error("Cannot destroy line batcher - line batcher was not created.");
+
+	glDeleteVertexArrays(1, &vertexArray_);
+	vertexArray_ = 0;
+
+	vertices_.clear();
+	lineDraws_.clear();
+
+	// The streaming buffer unmaps itself when destroyed
+	reserved_ = false;
+}
+
+void LineBatcher::line(const glm::vec3& from, const glm::vec3& to, const glm::vec3& color)
+{
+	line(from, to, packLineColor(color));
+}
+
+void LineBatcher::line(const glm::vec3& from, const glm::vec3& to, const uint32 color)
+{
+	vertices_.push_back({from, color});
+	vertices_.push_back({to, color});
+}
+
+void LineBatcher::box(const glm::vec3& minimum, const glm::vec3& maximum, const glm::vec3& color)
+{
+	const uint32 packedColor = packLineColor(color);
+
+	glm::vec3 corners[8];
+	for (uint32 i = 0; i < 8; ++i)
+	{
+		corners[i] = glm::vec3(
+			(i & 1) ? maximum.x : minimum.x,
+			(i & 2) ? maximum.y : minimum.y,
+			(i & 4) ? maximum.z : minimum.z
+		);
+	}
+
+	for (const auto& edge : BOX_EDGES)
+	{
+		line(corners[edge[0]], corners[edge[1]], packedColor);
+	}
+}
+
+void LineBatcher::sphere(const glm::vec3& center, const float32 radius, const glm::vec3& color, const uint32 segments)
+{
+	const uint32 packedColor = packLineColor(color);
+	const float32 step = glm::two_pi<float32>() / static_cast<float32>(std::max(segments, 3u));
+
+	for (uint32 i = 0; i < std::max(segments, 3u); ++i)
+	{
+		const float32 a0 = step * static_cast<float32>(i);
+		const float32 a1 = step * static_cast<float32>(i + 1);
+		const float32 c0 = std::cos(a0) * radius;
+		const float32 s0 = std::sin(a0) * radius;
+		const float32 c1 = std::cos(a1) * radius;
+		const float32 s1 = std::sin(a1) * radius;
+
+		line(center + glm::vec3(c0, s0, 0.0f), center + glm::vec3(c1, s1, 0.0f), packedColor);
+		line(center + glm::vec3(c0, 0.0f, s0), center + glm::vec3(c1, 0.0f, s1), packedColor);
+		line(center + glm::vec3(0.0f, c0, s0), center + glm::vec3(0.0f, c1, s1), packedColor);
+	}
+}
+
+void LineBatcher::frustum(const glm::mat4& viewProjection, const glm::vec3& color)
+{
+	const uint32 packedColor = packLineColor(color);
+	const glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+
+	// Unproject the corners of the normalized device coordinate cube
+	glm::vec3 corners[8];
+	for (uint32 i = 0; i < 8; ++i)
+	{
+		const glm::vec4 corner = inverseViewProjection * glm::vec4(
+			(i & 1) ? 1.0f : -1.0f,
+			(i & 2) ? 1.0f : -1.0f,
+			(i & 4) ? 1.0f : -1.0f,
+			1.0f
+		);
+
+		corners[i] = glm::vec3(corner) / corner.w;
+	}
+
+	for (const auto& edge : BOX_EDGES)
+	{
+		line(corners[edge[0]], corners[edge[1]], packedColor);
+	}
+}
+
+void LineBatcher::lines(const LineVertex* vertices, const size_t vertexCount, const LineStyle& lineStyle, StreamingBuffer& streamingBuffer)
+{
+	if (vertexCount < 2) return;
+
+	// An odd vertex would pair up with the first vertex of the next draw
+	const size_t lineVertexCount = vertexCount & ~static_cast<size_t>(1);
+
+	LineDraw lineDraw;
+	lineDraw.allocation = streamingBuffer.upload(vertices, lineVertexCount * sizeof(LineVertex), LINE_VERTEX_ALIGNMENT);
+	lineDraw.vertexCount = static_cast<GLsizei>(lineVertexCount);
+	lineDraw.lineStyle = lineStyle;
+
+	lineDraws_.push_back(lineDraw);
+}
+
+LineVertex* LineBatcher::reserveLines(const size_t vertexCount, const LineStyle& lineStyle, StreamingBuffer& streamingBuffer)
+{
+	if (reserved_) throw std::runtime_error("Cannot reserve lines - lines were already reserved.");
+
+	GLvoid* data = nullptr;
+
+	reservation_ = LineDraw();
+	reservation_.vertexCount = static_cast<GLsizei>(vertexCount);
+	reservation_.lineStyle = lineStyle;
+
+	// Mapping an empty range is an error
+	if (vertexCount > 0)
+	{
+		reservation_.allocation = streamingBuffer.map(static_cast<GLsizeiptr>(vertexCount * sizeof(LineVertex)), LINE_VERTEX_ALIGNMENT, data);
+	}
+
+	reserved_ = true;
+
+	return static_cast<LineVertex*>(data);
+}
+
+void LineBatcher::commitLines(const size_t vertexCount, StreamingBuffer& streamingBuffer)
+{
+	if (!reserved_) throw std::runtime_error("Cannot commit lines - no lines were reserved.");
+	if (vertexCount > static_cast<size_t>(reservation_.vertexCount)) throw std::runtime_error("Cannot commit lines - more vertices were written than reserved.");
+
+	if (reservation_.vertexCount > 0)
+	{
+		streamingBuffer.unmap();
+	}
+
+	reserved_ = false;
+
+	// An odd vertex would pair up with the first vertex of the next draw
+	reservation_.vertexCount = static_cast<GLsizei>(vertexCount & ~static_cast<size_t>(1));
+
+	if (reservation_.vertexCount > 0)
+	{
+		lineDraws_.push_back(reservation_);
+	}
+}
+
+uint32 LineBatcher::flush(StreamingBuffer& streamingBuffer)
+{
+	if (!valid()) throw std::runtime_error("Cannot flush line batcher - line batcher was not created.");
+	if (reserved_) throw std::runtime_error("Cannot flush line batcher - reserved lines were not committed.");
+
+	if (empty()) return 0;
+
+	const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+	uint32 drawCalls = 0;
+
+	glBindVertexArray(vertexArray_);
+
+	if (!vertices_.empty())
+	{
+		LineDraw lineDraw;
+		lineDraw.allocation = streamingBuffer.upload(&vertices_[0], vertices_.size() * sizeof(LineVertex), LINE_VERTEX_ALIGNMENT);
+		lineDraw.vertexCount = static_cast<GLsizei>(vertices_.size());
+
+		draw(lineDraw);
+		++drawCalls;
+	}
+
+	for (const auto& lineDraw : lineDraws_)
+	{
+		draw(lineDraw);
+		++drawCalls;
+	}
+
+	glBindVertexArray(0);
+	glLineWidth(1.0f);
+
+	if (depthTest)
+	{
+		glEnable(GL_DEPTH_TEST);
+	}
+	else
+	{
+		glDisable(GL_DEPTH_TEST);
+	}
+
+	// Keeps the capacity for the next frame
+	vertices_.clear();
+	lineDraws_.clear();
+
+	return drawCalls;
+}
+
+void LineBatcher::draw(const LineDraw& lineDraw)
+{
+	const auto& allocation = lineDraw.allocation;
+
+	glBindBuffer(GL_ARRAY_BUFFER, allocation.buffer);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(LineVertex), (GLvoid*)(allocation.offset + offsetof(LineVertex, position)));
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(LineVertex), (GLvoid*)(allocation.offset + offsetof(LineVertex, color)));
+
+	if (lineDraw.lineStyle.depthTest)
+	{
+		glEnable(GL_DEPTH_TEST);
+	}
+	else
+	{
+		glDisable(GL_DEPTH_TEST);
+	}
+
+	glLineWidth(glm::clamp(lineDraw.lineStyle.width, lineWidthRange_[0], lineWidthRange_[1]));
+	glDrawArrays(GL_LINES, 0, lineDraw.vertexCount);
+}
+
+bool LineBatcher::empty() const
+{
+	return vertices_.empty() && lineDraws_.empty();
+}
+
+bool LineBatcher::valid() const
+{
+	return (vertexArray_ != 0);
+}
+
+}
+}
+}
+}
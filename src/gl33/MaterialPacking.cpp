@@ -0,0 +1,112 @@
+#include "gl33/MaterialPacking.hpp"
+#include "gl33/ParallelRows.hpp"
+#include "gl33/Simd.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+namespace
+{
+
+constexpr uint32 CHANNELS = 4;
+constexpr byte DEFAULT_VALUE = 127;
+
+// Below this many pixels per thread, handing rows to a worker costs more than it saves
+constexpr size_t MIN_PIXELS_PER_THREAD = 256 * 1024;
+
+byte average(const byte* image, const size_t pixel)
+{
+	if (image == nullptr) return DEFAULT_VALUE;
+
+	const size_t i = pixel * CHANNELS;
+
+	return static_cast<byte>((image[i] + image[i + 1] + image[i + 2]) / 3);
+}
+
+#if defined(ICE_ENGINE_SSE2)
+/**
+ * Averages the red, green and blue channels of 8 RGBA8 pixels, one result per 16 bit lane.
+ */
+__m128i average8(const byte* image, const size_t pixel)
+{
+	if (image == nullptr) return _mm_set1_epi16(DEFAULT_VALUE);
+
+	const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(image + pixel * CHANNELS));
+	const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(image + (pixel + 4) * CHANNELS));
+	const __m128i mask = _mm_set1_epi32(0xFF);
+
+	const __m128i sumLow = _mm_add_epi32(
+		_mm_add_epi32(_mm_and_si128(low, mask), _mm_and_si128(_mm_srli_epi32(low, 8), mask)),
+		_mm_and_si128(_mm_srli_epi32(low, 16), mask)
+	);
+	const __m128i sumHigh = _mm_add_epi32(
+		_mm_add_epi32(_mm_and_si128(high, mask), _mm_and_si128(_mm_srli_epi32(high, 8), mask)),
+		_mm_and_si128(_mm_srli_epi32(high, 16), mask)
+	);
+
+	// Sums are at most 765, so the signed saturation never kicks in
+	const __m128i sum = _mm_packs_epi32(sumLow, sumHigh);
+
+	// (sum * 43691) >> 17 equals sum / 3 for every sum below 98304
+	return _mm_srli_epi16(_mm_mulhi_epu16(sum, _mm_set1_epi16(static_cast<int16>(43691))), 1);
+}
+#endif
+
+void packRows(const byte* metalness, const byte* roughness, const byte* ambientOcclusion, const size_t first, const size_t last, byte* texels)
+{
+	size_t pixel = first;
+
+#if defined(ICE_ENGINE_SSE2)
+	for (; pixel + 8 <= last; pixel += 8)
+	{
+		const __m128i m = average8(metalness, pixel);
+		const __m128i r = average8(roughness, pixel);
+		const __m128i ao = average8(ambientOcclusion, pixel);
+
+		// Metalness in the low byte and roughness in the high byte of each lane, then interleaved with ambient
+		// occlusion and a zero byte into RGBA
+		const __m128i metalnessRoughness = _mm_or_si128(m, _mm_slli_epi16(r, 8));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(texels + pixel * CHANNELS), _mm_unpacklo_epi16(metalnessRoughness, ao));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(texels + (pixel + 4) * CHANNELS), _mm_unpackhi_epi16(metalnessRoughness, ao));
+	}
+#endif
+
+	for (; pixel < last; ++pixel)
+	{
+		const size_t i = pixel * CHANNELS;
+
+		texels[i] = average(metalness, pixel);
+		texels[i + 1] = average(roughness, pixel);
+		texels[i + 2] = average(ambientOcclusion, pixel);
+		texels[i + 3] = 0;
+	}
+}
+
+}
+
+void packMetalnessRoughnessAmbientOcclusion(
+	const byte* metalness,
+	const byte* roughness,
+	const byte* ambientOcclusion,
+	const uint32 width,
+	const uint32 height,
+	byte* texels,
+	WorkerPool& workerPool
+)
+{
+	parallelRows(workerPool, width, height, MIN_PIXELS_PER_THREAD, [=](const uint32 firstRow, const uint32 lastRow) {
+		packRows(metalness, roughness, ambientOcclusion, static_cast<size_t>(firstRow) * width, static_cast<size_t>(lastRow) * width, texels);
+	});
+}
+
+}
+}
+}
+}
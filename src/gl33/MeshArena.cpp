@@ -0,0 +1,470 @@
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+
+#include "gl33/MeshArena.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+namespace
+{
+
+constexpr GLsizeiptr INDEX_UNIT_SIZE = 4;
+
+uint32 indexUnits(const uint32 indexCount, const GLenum indexType)
+{
+	return (indexType == GL_UNSIGNED_SHORT ? (indexCount + 1) / 2 : indexCount);
+}
+
+GLsizeiptr indexSize(const GLenum indexType)
+{
+	return (indexType == GL_UNSIGNED_SHORT ? sizeof(uint16) : sizeof(uint32));
+}
+
+void copyBufferSubData(const GLuint source, const GLuint destination, const GLintptr sourceOffset, const GLintptr destinationOffset, const GLsizeiptr size)
+{
+	if (size == 0) return;
+
+	glBindBuffer(GL_COPY_READ_BUFFER, source);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, destination);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, sourceOffset, destinationOffset, size);
+}
+
+}
+
+RangeAllocator::RangeAllocator(const uint32 capacity)
+{
+	grow(capacity);
+}
+
+uint32 RangeAllocator::allocate(const uint32 size)
+{
+	if (size == 0) return 0;
+
+	for (auto it = freeBlocks_.begin(); it != freeBlocks_.end(); ++it)
+	{
+		if (it->second < size) continue;
+
+		const uint32 offset = it->first;
+		const uint32 remaining = it->second - size;
+
+		freeBlocks_.erase(it);
+
+		if (remaining > 0)
+		{
+			freeBlocks_.emplace(offset + size, remaining);
+		}
+
+		used_ += size;
+
+		return offset;
+	}
+
+	return INVALID_OFFSET;
+}
+
+void RangeAllocator::free(const uint32 offset, const uint32 size)
+{
+	if (size == 0) return;
+
+	uint32 blockOffset = offset;
+	uint32 blockSize = size;
+
+	auto next = freeBlocks_.lower_bound(offset);
+
+	if (next != freeBlocks_.begin())
+	{
+		auto previous = std::prev(next);
+
+		if (previous->first + previous->second == offset)
+		{
+			blockOffset = previous->first;
+			blockSize += previous->second;
+			freeBlocks_.erase(previous);
+		}
+	}
+
+	if (next != freeBlocks_.end() && offset + size == next->first)
+	{
+		blockSize += next->second;
+		freeBlocks_.erase(next);
+	}
+
+	freeBlocks_.emplace(blockOffset, blockSize);
+
+	used_ -= size;
+}
+
+void RangeAllocator::grow(const uint32 capacity)
+{
+	if (capacity <= capacity_) return;
+
+	const uint32 oldCapacity = capacity_;
+
+	// Add the new space as a used block and free it, so it merges with a free block at the end
+	capacity_ = capacity;
+	used_ += capacity - oldCapacity;
+
+	free(oldCapacity, capacity - oldCapacity);
+}
+
+uint32 RangeAllocator::capacity() const
+{
+	return capacity_;
+}
+
+uint32 RangeAllocator::used() const
+{
+	return used_;
+}
+
+uint32 RangeAllocator::largestFreeBlock() const
+{
+	uint32 largest = 0;
+
+	for (const auto& block : freeBlocks_)
+	{
+		largest = std::max(largest, block.second);
+	}
+
+	return largest;
+}
+
+MeshArena::~MeshArena()
+{
+	if (valid())
+	{
+		destroy();
+	}
+}
+
+void MeshArena::generate(const VertexFormat vertexFormat, const bool skinned, const uint32 vertexCapacity, const uint32 indexCapacity)
+{
+	if (valid()) throw std::runtime_error("Cannot generate mesh arena - mesh arena was already created.");
+
+	vertexFormat_ = vertexFormat;
+	skinned_ = skinned;
+	vertexSize_ = static_cast<GLsizeiptr>(vertexSize(vertexFormat));
+
+	glGenVertexArrays(1, &vertexArray_);
+
+	if (vertexArray_ == 0)
+	{
+		throw std::runtime_error("Could not create mesh arena vertex array.");
+	}
+
+	vertexAllocator_ = RangeAllocator();
+	indexAllocator_ = RangeAllocator();
+	allocations_.clear();
+	freeAllocations_.clear();
+
+	reallocate(vertexCapacity, indexCapacity, false);
+}
+
+void MeshArena::destroy()
+{
+	if (!valid()) throw std::runtime_error("Cannot destroy mesh arena - mesh arena was not created.");
+
+	glDeleteVertexArrays(1, &vertexArray_);
+	vertexArray_ = 0;
+
+	vertexBuffer_ = gl::ArrayBuffer();
+	skinVertexBuffer_ = gl::ArrayBuffer();
+	indexBuffer_ = gl::ElementArrayBuffer();
+
+	vertexAllocator_ = RangeAllocator();
+	indexAllocator_ = RangeAllocator();
+	allocations_.clear();
+	freeAllocations_.clear();
+}
+
+uint32 MeshArena::allocate(const uint32 vertexCount, const uint32 indexCount, const GLenum indexType)
+{
+	if (!valid()) throw std::runtime_error("Cannot allocate mesh - mesh arena was not created.");
+
+	const uint32 units = indexUnits(indexCount, indexType);
+
+	uint32 baseVertex = vertexAllocator_.allocate(vertexCount);
+	uint32 firstIndexUnit = indexAllocator_.allocate(units);
+
+	if (baseVertex == RangeAllocator::INVALID_OFFSET || firstIndexUnit == RangeAllocator::INVALID_OFFSET)
+	{
+		if (baseVertex != RangeAllocator::INVALID_OFFSET) vertexAllocator_.free(baseVertex, vertexCount);
+		if (firstIndexUnit != RangeAllocator::INVALID_OFFSET) indexAllocator_.free(firstIndexUnit, units);
+
+		// Grow geometrically so that streaming many small meshes does not copy the buffers every time
+		const uint32 vertexCapacity = std::max(vertexAllocator_.capacity() * 2, vertexAllocator_.capacity() + vertexCount);
+		const uint32 indexCapacity = std::max(indexAllocator_.capacity() * 2, indexAllocator_.capacity() + units);
+
+		reallocate(vertexCapacity, indexCapacity, false);
+
+		baseVertex = vertexAllocator_.allocate(vertexCount);
+		firstIndexUnit = indexAllocator_.allocate(units);
+	}
+
+	uint32 id = 0;
+
+	if (!freeAllocations_.empty())
+	{
+		id = freeAllocations_.back();
+		freeAllocations_.pop_back();
+	}
+	else
+	{
+		id = static_cast<uint32>(allocations_.size());
+		allocations_.emplace_back();
+	}
+
+	auto& allocation = allocations_[id];
+	allocation.baseVertex = baseVertex;
+	allocation.vertexCount = vertexCount;
+	allocation.firstIndexUnit = firstIndexUnit;
+	allocation.indexUnits = units;
+	allocation.indexCount = indexCount;
+	allocation.indexType = indexType;
+	allocation.allocated = true;
+
+	return id;
+}
+
+void MeshArena::free(const uint32 id)
+{
+	auto& allocation = allocations_[id];
+
+	if (!allocation.allocated) throw std::runtime_error("Cannot free mesh - mesh was not allocated.");
+
+	vertexAllocator_.free(allocation.baseVertex, allocation.vertexCount);
+	indexAllocator_.free(allocation.firstIndexUnit, allocation.indexUnits);
+
+	allocation = MeshAllocation();
+	freeAllocations_.push_back(id);
+}
+
+const MeshAllocation& MeshArena::allocation(const uint32 id) const
+{
+	return allocations_[id];
+}
+
+void MeshArena::vertices(const uint32 id, const GLvoid* data)
+{
+	const auto& allocation = allocations_[id];
+
+	vertexBuffer_.bufferSubData(allocation.baseVertex * vertexSize_, allocation.vertexCount * vertexSize_, data);
+}
+
+void MeshArena::skinVertices(const uint32 id, const GLvoid* data)
+{
+	if (!skinned_) throw std::runtime_error("Cannot set skin vertices - mesh arena is not skinned.");
+
+	const auto& allocation = allocations_[id];
+	constexpr GLsizeiptr size = sizeof(SkinVertex);
+
+	skinVertexBuffer_.bufferSubData(allocation.baseVertex * size, allocation.vertexCount * size, data);
+}
+
+void MeshArena::indices(const uint32 id, const GLvoid* data)
+{
+	const auto& allocation = allocations_[id];
+
+	// The element array buffer binding is vertex array state, so bind through the arena's vertex array
+	glBindVertexArray(vertexArray_);
+	indexBuffer_.bufferSubData(allocation.indexOffset(), allocation.indexCount * indexSize(allocation.indexType), data);
+	glBindVertexArray(0);
+}
+
+void MeshArena::copy(const uint32 id, MeshArena& destination, const uint32 destinationId)
+{
+	if (vertexFormat_ != destination.vertexFormat_) throw std::runtime_error("Cannot copy mesh - mesh arenas have different vertex formats.");
+
+	const auto& source = allocations_[id];
+	const auto& target = destination.allocations_[destinationId];
+
+	if (source.vertexCount != target.vertexCount || source.indexUnits != target.indexUnits)
+	{
+		throw std::runtime_error("Cannot copy mesh - allocations have different sizes.");
+	}
+
+	copyBufferSubData(vertexBuffer_, destination.vertexBuffer_, source.baseVertex * vertexSize_, target.baseVertex * vertexSize_, source.vertexCount * vertexSize_);
+	copyBufferSubData(indexBuffer_, destination.indexBuffer_, source.indexOffset(), target.indexOffset(), source.indexUnits * INDEX_UNIT_SIZE);
+}
+
+float32 MeshArena::fragmentation() const
+{
+	const auto fragmentation = [](const RangeAllocator& allocator) {
+		const uint32 free = allocator.capacity() - allocator.used();
+
+		return (free == 0 ? 0.0f : 1.0f - static_cast<float32>(allocator.largestFreeBlock()) / static_cast<float32>(free));
+	};
+
+	return std::max(fragmentation(vertexAllocator_), fragmentation(indexAllocator_));
+}
+
+void MeshArena::defragment()
+{
+	reallocate(vertexAllocator_.capacity(), indexAllocator_.capacity(), true);
+}
+
+GLuint MeshArena::id() const
+{
+	return vertexArray_;
+}
+
+GLuint MeshArena::indexBuffer() const
+{
+	return indexBuffer_.id();
+}
+
+VertexFormat MeshArena::vertexFormat() const
+{
+	return vertexFormat_;
+}
+
+bool MeshArena::skinned() const
+{
+	return skinned_;
+}
+
+bool MeshArena::valid() const
+{
+	return (vertexArray_ != 0);
+}
+
+void MeshArena::reallocate(const uint32 vertexCapacity, const uint32 indexCapacity, const bool compact)
+{
+	gl::ArrayBuffer vertexBuffer;
+	gl::ArrayBuffer skinVertexBuffer;
+	gl::ElementArrayBuffer indexBuffer;
+
+	vertexBuffer.generate();
+	vertexBuffer.bufferData(vertexCapacity * vertexSize_, nullptr, GL_STATIC_DRAW);
+
+	if (skinned_)
+	{
+		skinVertexBuffer.generate();
+		skinVertexBuffer.bufferData(vertexCapacity * static_cast<GLsizeiptr>(sizeof(SkinVertex)), nullptr, GL_STATIC_DRAW);
+	}
+
+	// Create the index buffer while no vertex array is bound, so no vertex array's element array binding changes
+	glBindVertexArray(0);
+	indexBuffer.generate();
+	indexBuffer.bufferData(indexCapacity * INDEX_UNIT_SIZE, nullptr, GL_STATIC_DRAW);
+
+	// Keep the allocations in the order they are laid out in
+	std::vector<uint32> order;
+	for (uint32 i = 0; i < allocations_.size(); ++i)
+	{
+		if (allocations_[i].allocated) order.push_back(i);
+	}
+
+	std::sort(order.begin(), order.end(), [this](const uint32 a, const uint32 b) {
+		return allocations_[a].baseVertex < allocations_[b].baseVertex;
+	});
+
+	uint32 nextVertex = 0;
+	uint32 nextIndexUnit = 0;
+
+	for (const auto id : order)
+	{
+		auto& allocation = allocations_[id];
+
+		const uint32 baseVertex = (compact ? nextVertex : allocation.baseVertex);
+		const uint32 firstIndexUnit = (compact ? nextIndexUnit : allocation.firstIndexUnit);
+
+		if (vertexBuffer_.valid())
+		{
+			copyBufferSubData(vertexBuffer_, vertexBuffer, allocation.baseVertex * vertexSize_, baseVertex * vertexSize_, allocation.vertexCount * vertexSize_);
+			copyBufferSubData(indexBuffer_, indexBuffer, allocation.indexOffset(), firstIndexUnit * INDEX_UNIT_SIZE, allocation.indexUnits * INDEX_UNIT_SIZE);
+
+			if (skinned_)
+			{
+				constexpr GLsizeiptr size = sizeof(SkinVertex);
+				copyBufferSubData(skinVertexBuffer_, skinVertexBuffer, allocation.baseVertex * size, baseVertex * size, allocation.vertexCount * size);
+			}
+		}
+
+		allocation.baseVertex = baseVertex;
+		allocation.firstIndexUnit = firstIndexUnit;
+
+		nextVertex += allocation.vertexCount;
+		nextIndexUnit += allocation.indexUnits;
+	}
+
+	if (compact)
+	{
+		vertexAllocator_ = RangeAllocator(vertexCapacity);
+		indexAllocator_ = RangeAllocator(indexCapacity);
+
+		vertexAllocator_.allocate(nextVertex);
+		indexAllocator_.allocate(nextIndexUnit);
+	}
+	else
+	{
+		vertexAllocator_.grow(vertexCapacity);
+		indexAllocator_.grow(indexCapacity);
+	}
+
+	// The old buffers are deleted when the temporaries go out of scope
+	vertexBuffer_ = std::move(vertexBuffer);
+	skinVertexBuffer_ = std::move(skinVertexBuffer);
+	indexBuffer_ = std::move(indexBuffer);
+
+	setVertexAttributes();
+}
+
+void MeshArena::setVertexAttributes()
+{
+	glBindVertexArray(vertexArray_);
+
+	vertexBuffer_.bind();
+
+	const GLsizei stride = static_cast<GLsizei>(vertexSize_);
+
+	if (vertexFormat_ == VertexFormat::COMPACT)
+	{
+		glVertexAttribPointer(0, 4, GL_SHORT, GL_TRUE, stride, (GLvoid*)(offsetof(CompactVertex, position)));
+		glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (GLvoid*)(offsetof(CompactVertex, color)));
+		glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, stride, (GLvoid*)(offsetof(CompactVertex, normal)));
+		glVertexAttribPointer(3, 2, GL_HALF_FLOAT, GL_FALSE, stride, (GLvoid*)(offsetof(CompactVertex, textureCoordinate)));
+	}
+	else
+	{
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(offsetof(FloatVertex, position)));
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(offsetof(FloatVertex, color)));
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(offsetof(FloatVertex, normal)));
+		glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(offsetof(FloatVertex, textureCoordinate)));
+	}
+
+	for (GLuint i = 0; i < 4; ++i)
+	{
+		glEnableVertexAttribArray(i);
+	}
+
+	if (skinned_)
+	{
+		skinVertexBuffer_.bind();
+
+		constexpr GLsizei skinStride = sizeof(SkinVertex);
+
+		glVertexAttribIPointer(4, 4, GL_INT, skinStride, (GLvoid*)(offsetof(SkinVertex, boneIds)));
+		glEnableVertexAttribArray(4);
+		glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, skinStride, (GLvoid*)(offsetof(SkinVertex, boneWeights)));
+		glEnableVertexAttribArray(5);
+	}
+
+	indexBuffer_.bind();
+
+	glBindVertexArray(0);
+}
+
+}
+}
+}
+}
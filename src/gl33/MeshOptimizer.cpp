@@ -0,0 +1,506 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include "gl33/MeshOptimizer.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+namespace
+{
+
+// Scoring parameters from Tom Forsyth's paper
+constexpr uint32 FORSYTH_CACHE_SIZE = 32;
+constexpr float32 FORSYTH_CACHE_DECAY_POWER = 1.5f;
+constexpr float32 FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+constexpr float32 FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+constexpr float32 FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+constexpr uint32 INVALID_TRIANGLE = 0xFFFFFFFFu;
+
+float32 vertexScore(const int32 cachePosition, const uint32 remainingTriangles)
+{
+	if (remainingTriangles == 0)
+	{
+		return -1.0f;
+	}
+
+	float32 score = 0.0f;
+
+	if (cachePosition >= 0)
+	{
+		if (cachePosition < 3)
+		{
+			// The vertices of the last triangle get a fixed score so that strips are not favoured over fans
+			score = FORSYTH_LAST_TRIANGLE_SCORE;
+		}
+		else
+		{
+			const float32 scaler = 1.0f / static_cast<float32>(FORSYTH_CACHE_SIZE - 3);
+			score = std::pow(1.0f - static_cast<float32>(cachePosition - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+		}
+	}
+
+	// Boost vertices with few remaining triangles so that lone triangles are not left behind
+	score += FORSYTH_VALENCE_BOOST_SCALE * std::pow(static_cast<float32>(remainingTriangles), -FORSYTH_VALENCE_BOOST_POWER);
+
+	return score;
+}
+
+/**
+ * A FIFO vertex cache using timestamps, so that lookups are O(1).
+ */
+class FifoVertexCache
+{
+public:
+	FifoVertexCache(const size_t vertexCount, const uint32 cacheSize)
+		: timestamps_(vertexCount, 0), cacheSize_(cacheSize), timestamp_(cacheSize + 1)
+	{
+	}
+
+	/**
+	 * Returns true if the vertex missed the cache, in which case it is now cached.
+	 */
+	bool miss(const uint32 vertex)
+	{
+		if (timestamp_ - timestamps_[vertex] <= cacheSize_)
+		{
+			return false;
+		}
+
+		timestamps_[vertex] = timestamp_++;
+
+		return true;
+	}
+
+private:
+	std::vector<uint32> timestamps_;
+	uint32 cacheSize_;
+	uint32 timestamp_;
+};
+
+struct WeldKey
+{
+	float32 values[12];
+
+	bool operator==(const WeldKey& other) const
+	{
+		return std::memcmp(values, other.values, sizeof(values)) == 0;
+	}
+};
+
+struct WeldKeyHash
+{
+	size_t operator()(const WeldKey& key) const
+	{
+		uint64 hash = 14695981039346656037ull;
+		const auto bytes = reinterpret_cast<const unsigned char*>(key.values);
+
+		for (size_t i = 0; i < sizeof(key.values); ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+
+		return static_cast<size_t>(hash);
+	}
+};
+
+}
+
+VertexCacheStatistics vertexCacheStatistics(const std::vector<uint32>& indices, const size_t vertexCount, const uint32 cacheSize)
+{
+	VertexCacheStatistics statistics;
+
+	if (indices.empty())
+	{
+		return statistics;
+	}
+
+	FifoVertexCache cache(vertexCount, cacheSize);
+	std::vector<uint8> referenced(vertexCount, 0);
+
+	size_t misses = 0;
+	size_t referencedCount = 0;
+
+	for (const auto index : indices)
+	{
+		if (cache.miss(index)) ++misses;
+
+		if (!referenced[index])
+		{
+			referenced[index] = 1;
+			++referencedCount;
+		}
+	}
+
+	statistics.acmr = static_cast<float32>(misses) / static_cast<float32>(indices.size() / 3);
+	statistics.atvr = static_cast<float32>(misses) / static_cast<float32>(referencedCount);
+
+	return statistics;
+}
+
+std::vector<uint32> weldVertices(
+	const std::vector<glm::vec3>& vertices,
+	const std::vector<glm::vec4>& colors,
+	const std::vector<glm::vec3>& normals,
+	const std::vector<glm::vec2>& textureCoordinates,
+	std::vector<uint32>& indices
+)
+{
+	std::vector<uint32> remap(vertices.size());
+	std::unordered_map<WeldKey, uint32, WeldKeyHash> uniqueVertices;
+	uniqueVertices.reserve(vertices.size());
+
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		WeldKey key;
+		std::memset(key.values, 0, sizeof(key.values));
+
+		std::memcpy(&key.values[0], &vertices[i], sizeof(glm::vec3));
+		if (!colors.empty()) std::memcpy(&key.values[3], &colors[i], sizeof(glm::vec4));
+		if (!normals.empty()) std::memcpy(&key.values[7], &normals[i], sizeof(glm::vec3));
+		if (!textureCoordinates.empty()) std::memcpy(&key.values[10], &textureCoordinates[i], sizeof(glm::vec2));
+
+		const auto result = uniqueVertices.emplace(key, static_cast<uint32>(uniqueVertices.size()));
+
+		remap[i] = result.first->second;
+	}
+
+	for (auto& index : indices)
+	{
+		index = remap[index];
+	}
+
+	return remap;
+}
+
+void optimizeVertexCache(std::vector<uint32>& indices, const size_t vertexCount)
+{
+	const size_t triangleCount = indices.size() / 3;
+
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// The triangles that still have to be emitted for every vertex, in compressed row storage
+	std::vector<uint32> remainingTriangles(vertexCount, 0);
+	for (const auto index : indices)
+	{
+		++remainingTriangles[index];
+	}
+
+	std::vector<uint32> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		adjacencyOffsets[i + 1] = adjacencyOffsets[i] + remainingTriangles[i];
+	}
+
+	std::vector<uint32> adjacency(indices.size());
+	{
+		std::vector<uint32> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			adjacency[fill[indices[i]]++] = static_cast<uint32>(i / 3);
+		}
+	}
+
+	std::vector<int32> cachePositions(vertexCount, -1);
+	std::vector<float32> scores(vertexCount);
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		scores[i] = vertexScore(-1, remainingTriangles[i]);
+	}
+
+	std::vector<uint8> emitted(triangleCount, 0);
+	std::vector<uint32> result;
+	result.reserve(indices.size());
+
+	std::vector<uint32> cache;
+	std::vector<uint32> newCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+	uint32 bestTriangle = INVALID_TRIANGLE;
+	size_t nextTriangle = 0;
+
+	for (size_t n = 0; n < triangleCount; ++n)
+	{
+		// Nothing in the cache is connected to an unemitted triangle, so continue with the next one in input order
+		if (bestTriangle == INVALID_TRIANGLE)
+		{
+			while (emitted[nextTriangle]) ++nextTriangle;
+			bestTriangle = static_cast<uint32>(nextTriangle);
+		}
+
+		emitted[bestTriangle] = 1;
+
+		const uint32* triangle = &indices[bestTriangle * 3];
+		result.insert(result.end(), triangle, triangle + 3);
+
+		for (int k = 0; k < 3; ++k)
+		{
+			const uint32 vertex = triangle[k];
+			auto begin = adjacency.begin() + adjacencyOffsets[vertex];
+			auto end = begin + remainingTriangles[vertex];
+
+			std::iter_swap(std::find(begin, end, bestTriangle), end - 1);
+			--remainingTriangles[vertex];
+		}
+
+		// Move the triangle's vertices to the front of the simulated LRU cache
+		newCache.clear();
+		newCache.insert(newCache.end(), triangle, triangle + 3);
+
+		for (const auto vertex : cache)
+		{
+			if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+			{
+				newCache.push_back(vertex);
+			}
+		}
+
+		for (size_t i = FORSYTH_CACHE_SIZE; i < newCache.size(); ++i)
+		{
+			cachePositions[newCache[i]] = -1;
+			scores[newCache[i]] = vertexScore(-1, remainingTriangles[newCache[i]]);
+		}
+
+		if (newCache.size() > FORSYTH_CACHE_SIZE) newCache.resize(FORSYTH_CACHE_SIZE);
+		cache.swap(newCache);
+
+		for (size_t i = 0; i < cache.size(); ++i)
+		{
+			cachePositions[cache[i]] = static_cast<int32>(i);
+			scores[cache[i]] = vertexScore(static_cast<int32>(i), remainingTriangles[cache[i]]);
+		}
+
+		// Only triangles touching the cache changed their score, so the best next triangle is one of them
+		bestTriangle = INVALID_TRIANGLE;
+		float32 bestScore = -1.0f;
+
+		for (const auto vertex : cache)
+		{
+			const auto begin = adjacency.begin() + adjacencyOffsets[vertex];
+			const auto end = begin + remainingTriangles[vertex];
+
+			for (auto it = begin; it != end; ++it)
+			{
+				const uint32* t = &indices[*it * 3];
+				const float32 score = scores[t[0]] + scores[t[1]] + scores[t[2]];
+
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = *it;
+				}
+			}
+		}
+	}
+
+	indices.swap(result);
+}
+
+void optimizeOverdraw(std::vector<uint32>& indices, const std::vector<glm::vec3>& vertices, const uint32 cacheSize)
+{
+	const size_t triangleCount = indices.size() / 3;
+
+	if (triangleCount < 2)
+	{
+		return;
+	}
+
+	// Start a new cluster wherever a triangle misses the cache with all three vertices; the cache is cold there anyway
+	std::vector<size_t> clusterStarts;
+	{
+		FifoVertexCache cache(vertices.size(), cacheSize);
+
+		for (size_t i = 0; i < triangleCount; ++i)
+		{
+			int misses = 0;
+			for (int k = 0; k < 3; ++k)
+			{
+				if (cache.miss(indices[i * 3 + k])) ++misses;
+			}
+
+			if (i == 0 || misses == 3) clusterStarts.push_back(i);
+		}
+	}
+
+	clusterStarts.push_back(triangleCount);
+
+	const size_t clusterCount = clusterStarts.size() - 1;
+
+	if (clusterCount < 2)
+	{
+		return;
+	}
+
+	std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+	glm::vec3 meshCentroid = glm::vec3(0.0f);
+	float32 meshArea = 0.0f;
+
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		float32 clusterArea = 0.0f;
+
+		for (size_t i = clusterStarts[c]; i < clusterStarts[c + 1]; ++i)
+		{
+			const glm::vec3& p0 = vertices[indices[i * 3]];
+			const glm::vec3& p1 = vertices[indices[i * 3 + 1]];
+			const glm::vec3& p2 = vertices[indices[i * 3 + 2]];
+
+			// The length of the cross product is twice the triangle area, so the sum is an area weighted normal
+			const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			const float32 area = glm::length(normal);
+
+			clusterNormals[c] += normal;
+			clusterCentroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+			clusterArea += area;
+		}
+
+		meshCentroid += clusterCentroids[c];
+		meshArea += clusterArea;
+
+		if (clusterArea > 0.0f) clusterCentroids[c] /= clusterArea;
+	}
+
+	if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+	// Clusters facing away from the center occlude the rest of the mesh for most viewpoints, so draw them first
+	std::vector<float32> sortKeys(clusterCount, 0.0f);
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		const float32 length = glm::length(clusterNormals[c]);
+
+		if (length > 0.0f)
+		{
+			sortKeys[c] = glm::dot(clusterCentroids[c] - meshCentroid, clusterNormals[c] / length);
+		}
+	}
+
+	std::vector<uint32> clusterOrder(clusterCount);
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		clusterOrder[c] = static_cast<uint32>(c);
+	}
+
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKeys](const uint32 a, const uint32 b) {
+		return sortKeys[a] > sortKeys[b];
+	});
+
+	std::vector<uint32> result;
+	result.reserve(indices.size());
+
+	for (const auto c : clusterOrder)
+	{
+		result.insert(result.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+	}
+
+	indices.swap(result);
+}
+
+std::vector<uint32> optimizeVertexFetch(std::vector<uint32>& indices, const size_t vertexCount)
+{
+	std::vector<uint32> remap(vertexCount, REMOVED_VERTEX);
+	uint32 nextVertex = 0;
+
+	for (auto& index : indices)
+	{
+		if (remap[index] == REMOVED_VERTEX)
+		{
+			remap[index] = nextVertex++;
+		}
+
+		index = remap[index];
+	}
+
+	return remap;
+}
+
+MeshOptimization optimizeMesh(
+	std::vector<glm::vec3>& vertices,
+	std::vector<uint32>& indices,
+	std::vector<glm::vec4>& colors,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& textureCoordinates,
+	const bool weld
+)
+{
+	MeshOptimization optimization;
+	optimization.originalVertexCount = vertices.size();
+	optimization.vertexCount = vertices.size();
+	optimization.vertexRemap.resize(vertices.size());
+
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		optimization.vertexRemap[i] = static_cast<uint32>(i);
+	}
+
+	const auto validAttribute = [&vertices](const size_t size) {
+		return (size == 0 || size == vertices.size());
+	};
+
+	const bool valid = !indices.empty()
+		&& indices.size() % 3 == 0
+		&& validAttribute(colors.size())
+		&& validAttribute(normals.size())
+		&& validAttribute(textureCoordinates.size())
+		&& *std::max_element(indices.begin(), indices.end()) < vertices.size();
+
+	if (!valid)
+	{
+		return optimization;
+	}
+
+	optimization.before = vertexCacheStatistics(indices, vertices.size());
+
+	// Without welding every vertex keeps its own index
+	const auto weldRemap = (weld ? weldVertices(vertices, colors, normals, textureCoordinates, indices) : optimization.vertexRemap);
+	const size_t weldedVertexCount = (weldRemap.empty() ? 0 : *std::max_element(weldRemap.begin(), weldRemap.end()) + 1);
+
+	if (weld)
+	{
+		remapVertices(vertices, weldRemap, weldedVertexCount);
+		remapVertices(colors, weldRemap, weldedVertexCount);
+		remapVertices(normals, weldRemap, weldedVertexCount);
+		remapVertices(textureCoordinates, weldRemap, weldedVertexCount);
+	}
+
+	optimizeVertexCache(indices, weldedVertexCount);
+	optimizeOverdraw(indices, vertices);
+
+	const auto fetchRemap = optimizeVertexFetch(indices, weldedVertexCount);
+	const size_t vertexCount = weldedVertexCount - static_cast<size_t>(std::count(fetchRemap.begin(), fetchRemap.end(), REMOVED_VERTEX));
+
+	remapVertices(vertices, fetchRemap, vertexCount);
+	remapVertices(colors, fetchRemap, vertexCount);
+	remapVertices(normals, fetchRemap, vertexCount);
+	remapVertices(textureCoordinates, fetchRemap, vertexCount);
+
+	for (size_t i = 0; i < optimization.vertexRemap.size(); ++i)
+	{
+		optimization.vertexRemap[i] = fetchRemap[weldRemap[i]];
+	}
+
+	optimization.vertexCount = vertexCount;
+	optimization.after = vertexCacheStatistics(indices, vertexCount);
+
+	return optimization;
+}
+
+}
+}
+}
+}
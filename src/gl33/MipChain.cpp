@@ -0,0 +1,295 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "gl33/MipChain.hpp"
+#include "gl33/ParallelRows.hpp"
+#include "gl33/Simd.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+namespace
+{
+
+// Must match the gamma lighting.frag decodes albedo with
+constexpr float32 GAMMA = 2.2f;
+
+// Below this many pixels per thread, handing rows to a worker costs more than it saves
+constexpr size_t MIN_PIXELS_PER_THREAD = 64 * 1024;
+
+constexpr uint32 ENCODE_BUCKETS = 4096;
+
+/**
+ * Decoding and encoding tables for gamma corrected averaging. Encoding picks the byte whose decoded value is nearest,
+ * starting from the first byte of the value's bucket and stepping over the midpoints between consecutive decoded values
+ * below it, which is rarely more than one step.
+ */
+struct GammaTables
+{
+	float32 decoded[256];
+	float32 midpoints[255];
+	uint8 bucketStarts[ENCODE_BUCKETS];
+
+	GammaTables()
+	{
+		for (uint32 i = 0; i < 256; ++i)
+		{
+			decoded[i] = std::pow(static_cast<float32>(i) / 255.0f, GAMMA);
+		}
+
+		for (uint32 i = 0; i < 255; ++i)
+		{
+			midpoints[i] = (decoded[i] + decoded[i + 1]) * 0.5f;
+		}
+
+		for (uint32 i = 0; i < ENCODE_BUCKETS; ++i)
+		{
+			const float32 bucketStart = static_cast<float32>(i) / static_cast<float32>(ENCODE_BUCKETS);
+
+			bucketStarts[i] = static_cast<uint8>(std::upper_bound(midpoints, midpoints + 255, bucketStart) - midpoints);
+		}
+	}
+
+	byte encode(const float32 value) const
+	{
+		const uint32 bucket = std::min(static_cast<uint32>(value * static_cast<float32>(ENCODE_BUCKETS)), ENCODE_BUCKETS - 1);
+		uint32 encoded = bucketStarts[bucket];
+
+		while (encoded < 255 && midpoints[encoded] <= value)
+		{
+			++encoded;
+		}
+
+		return static_cast<byte>(encoded);
+	}
+};
+
+const GammaTables& gammaTables()
+{
+	static const GammaTables tables;
+
+	return tables;
+}
+
+/**
+ * The source texels one destination texel covers along one axis. Even sizes halve into pairs. Odd sizes 2n + 1 shrink
+ * to n, so every destination texel covers 2 + 1/n source texels, spread over 3 taps whose weights slide along with the
+ * position (a polyphase box filter), and no source texel is left out.
+ */
+struct Taps
+{
+	uint32 first = 0;
+	uint32 count = 0;
+	float32 weights[3] = {0.0f, 0.0f, 0.0f};
+};
+
+Taps taps(const uint32 sourceSize, const uint32 i)
+{
+	Taps result;
+
+	if (sourceSize == 1)
+	{
+		result.count = 1;
+		result.weights[0] = 1.0f;
+	}
+	else if (sourceSize % 2 == 0)
+	{
+		result.first = i * 2;
+		result.count = 2;
+		result.weights[0] = 0.5f;
+		result.weights[1] = 0.5f;
+	}
+	else
+	{
+		const float32 n = static_cast<float32>(sourceSize / 2);
+		const float32 position = static_cast<float32>(i);
+
+		result.first = i * 2;
+		result.count = 3;
+		result.weights[0] = (n - position) / (2.0f * n + 1.0f);
+		result.weights[1] = n / (2.0f * n + 1.0f);
+		result.weights[2] = (position + 1.0f) / (2.0f * n + 1.0f);
+	}
+
+	return result;
+}
+
+void downsampleRows(
+	const byte* source,
+	const MipLevel& sourceLevel,
+	byte* destination,
+	const MipLevel& destinationLevel,
+	const uint32 channels,
+	const bool gammaCorrect,
+	const uint32 firstRow,
+	const uint32 lastRow
+)
+{
+	const uint32 sourceWidth = sourceLevel.width;
+	const uint32 width = destinationLevel.width;
+	const GammaTables* tables = (gammaCorrect ? &gammaTables() : nullptr);
+
+	// Alpha is coverage, not color, and is averaged as is
+	const uint32 colorChannels = (channels == 4 ? 3 : channels);
+
+	std::vector<Taps> columns(width);
+	for (uint32 x = 0; x < width; ++x)
+	{
+		columns[x] = taps(sourceWidth, x);
+	}
+
+	for (uint32 y = firstRow; y < lastRow; ++y)
+	{
+		const Taps rows = taps(sourceLevel.height, y);
+		const byte* row0 = source + static_cast<size_t>(rows.first) * sourceWidth * channels;
+		const byte* row1 = row0 + static_cast<size_t>(sourceWidth) * channels;
+		byte* output = destination + static_cast<size_t>(y) * width * channels;
+
+		uint32 x = 0;
+
+#if defined(ICE_ENGINE_SSE2)
+		// Only 2 x 2 footprints, odd sizes take the weighted path below
+		if (!gammaCorrect && channels == 4 && rows.count == 2 && sourceWidth % 2 == 0)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i rounding = _mm_set1_epi16(2);
+
+			// 4 output pixels from 8 x 2 input pixels
+			for (; x + 4 <= width; x += 4)
+			{
+				const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 2 * 4));
+				const __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 2 * 4 + 16));
+				const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 2 * 4));
+				const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 2 * 4 + 16));
+
+				// Vertical sums, 16 bits per channel, two pixels per register
+				const __m128i sum0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+				const __m128i sum1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+				const __m128i sum2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+				const __m128i sum3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+				// Horizontal sums of neighbouring pixels, which sit in the low and high halves of each register
+				const __m128i low = _mm_add_epi16(_mm_unpacklo_epi64(sum0, sum1), _mm_unpackhi_epi64(sum0, sum1));
+				const __m128i high = _mm_add_epi16(_mm_unpacklo_epi64(sum2, sum3), _mm_unpackhi_epi64(sum2, sum3));
+
+				const __m128i averageLow = _mm_srli_epi16(_mm_add_epi16(low, rounding), 2);
+				const __m128i averageHigh = _mm_srli_epi16(_mm_add_epi16(high, rounding), 2);
+
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(output + x * 4), _mm_packus_epi16(averageLow, averageHigh));
+			}
+		}
+#endif
+
+		for (; x < width; ++x)
+		{
+			const Taps& column = columns[x];
+
+			if (rows.count == 2 && column.count == 2)
+			{
+				const size_t x0 = static_cast<size_t>(column.first) * channels;
+				const size_t x1 = x0 + channels;
+
+				for (uint32 c = 0; c < channels; ++c)
+				{
+					if (tables != nullptr && c < colorChannels)
+					{
+						const float32 sum = tables->decoded[row0[x0 + c]] + tables->decoded[row0[x1 + c]] + tables->decoded[row1[x0 + c]] + tables->decoded[row1[x1 + c]];
+
+						output[x * channels + c] = tables->encode(sum * 0.25f);
+					}
+					else
+					{
+						output[x * channels + c] = static_cast<byte>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+					}
+				}
+
+				continue;
+			}
+
+			for (uint32 c = 0; c < channels; ++c)
+			{
+				const bool decode = (tables != nullptr && c < colorChannels);
+				float32 sum = 0.0f;
+
+				for (uint32 j = 0; j < rows.count; ++j)
+				{
+					const byte* row = source + static_cast<size_t>(rows.first + j) * sourceWidth * channels;
+
+					for (uint32 i = 0; i < column.count; ++i)
+					{
+						const byte value = row[static_cast<size_t>(column.first + i) * channels + c];
+
+						sum += rows.weights[j] * column.weights[i] * (decode ? tables->decoded[value] : static_cast<float32>(value));
+					}
+				}
+
+				output[x * channels + c] = (decode ? tables->encode(sum) : static_cast<byte>(std::min(sum + 0.5f, 255.0f)));
+			}
+		}
+	}
+}
+
+}
+
+size_t mipChainLayout(const uint32 width, const uint32 height, const uint32 channels, std::vector<MipLevel>& levels)
+{
+	levels.clear();
+
+	MipLevel level;
+	level.width = width;
+	level.height = height;
+
+	while (true)
+	{
+		level.size = static_cast<size_t>(level.width) * level.height * channels;
+		levels.push_back(level);
+
+		if (level.width <= 1 && level.height <= 1) break;
+
+		level.offset += level.size;
+		level.width = std::max(level.width / 2, 1u);
+		level.height = std::max(level.height / 2, 1u);
+	}
+
+	return level.offset + level.size;
+}
+
+void generateMipChain(
+	const byte* image,
+	const uint32 width,
+	const uint32 height,
+	const uint32 channels,
+	const bool gammaCorrect,
+	std::vector<byte>& chain,
+	std::vector<MipLevel>& levels,
+	WorkerPool& workerPool
+)
+{
+	chain.resize(mipChainLayout(width, height, channels, levels));
+
+	std::memcpy(&chain[0], image, levels[0].size);
+
+	for (size_t i = 1; i < levels.size(); ++i)
+	{
+		const MipLevel& sourceLevel = levels[i - 1];
+		const MipLevel& destinationLevel = levels[i];
+		const byte* source = &chain[sourceLevel.offset];
+		byte* destination = &chain[destinationLevel.offset];
+
+		parallelRows(workerPool, destinationLevel.width, destinationLevel.height, MIN_PIXELS_PER_THREAD, [&](const uint32 firstRow, const uint32 lastRow) {
+			downsampleRows(source, sourceLevel, destination, destinationLevel, channels, gammaCorrect, firstRow, lastRow);
+		});
+	}
+}
+
+}
+}
+}
+}
@@ -1,6 +1,8 @@
 #include <algorithm>
+#include <cstddef>
 #include <sstream>
 #include <cstring>
+#include <limits>
 #include <unordered_map>
 #include <utility>
 #include <chrono>
@@ -200,11 +202,68 @@ inline GLint getOpenGlImageFormat( int32 format )
 	return (GLint)IImage::Format::FORMAT_UNKNOWN;
 }
 
+// Uniform and uniform block names used by the render loop, hashed at compile time
+constexpr uint64 MODEL_MATRIX_UNIFORM = hashName("modelMatrix");
+constexpr uint64 COMPACT_VERTEX_FORMAT_UNIFORM = hashName("compactVertexFormat");
+constexpr uint64 POSITION_SCALE_UNIFORM = hashName("positionScale");
+constexpr uint64 POSITION_BIAS_UNIFORM = hashName("positionBias");
+constexpr uint64 BONE_PALETTES_UNIFORM = hashName("bonePalettes");
+constexpr uint64 BONE_PALETTE_BASE_UNIFORM = hashName("bonePaletteBase");
+constexpr uint64 BONE_FORMAT_UNIFORM = hashName("boneFormat");
+constexpr uint64 BONE_PALETTE_UNIFORM = hashName("bonePalette");
+constexpr uint64 TEXTURE_DIFFUSE1_UNIFORM = hashName("texture_diffuse1");
+constexpr uint64 NORMAL_TEXTURES_UNIFORM = hashName("normalTextures");
+constexpr uint64 METALLIC_ROUGHNESS_AMBIENT_OCCLUSION_TEXTURES_UNIFORM = hashName("metallicRoughnessAmbientOcclusionTextures");
+constexpr uint64 HEIGHT_MAP_TEXTURE_UNIFORM = hashName("heightMapTexture");
+constexpr uint64 TERRAIN_SIZE_UNIFORM = hashName("terrainSize");
+constexpr uint64 TERRAIN_CAMERA_POSITION_UNIFORM = hashName("terrainCameraPosition");
+constexpr uint64 CHUNK_RESOLUTION_UNIFORM = hashName("chunkResolution");
+constexpr uint64 HEIGHT_SCALE_UNIFORM = hashName("heightScale");
+constexpr uint64 NORMAL_MATRIX_UNIFORM = hashName("normalMatrix");
+constexpr uint64 DISPLACEMENT_MAP_TEXTURE_UNIFORM = hashName("displacementMapTexture");
+constexpr uint64 DISPLACEMENT_SCALE_UNIFORM = hashName("displacementScale");
+constexpr uint64 TRIANGLE_SIZE_UNIFORM = hashName("triangleSize");
+constexpr uint64 HEIGHT_MAP_TILES_UNIFORM = hashName("heightMapTiles");
+constexpr uint64 TERRAIN_MAP_TILES_UNIFORM = hashName("terrainMapTiles");
+constexpr uint64 TILE_SLOTS_UNIFORM = hashName("tileSlots");
+constexpr uint64 TILE_SIZE_UNIFORM = hashName("tileSize");
+constexpr uint64 HEIGHT_MAP_OVERVIEW_UNIFORM = hashName("heightMapOverview");
+constexpr uint64 TERRAIN_MAP_OVERVIEW_UNIFORM = hashName("terrainMapOverview");
+constexpr uint64 OVERVIEW_STEP_UNIFORM = hashName("overviewStep");
+constexpr uint64 TERRAIN_MAP_TEXTURE_UNIFORM = hashName("terrainMapTexture");
+constexpr uint64 SPLAT_MAP_ALBEDO_TEXTURES_UNIFORM = hashName("splatMapAlbedoTextures");
+constexpr uint64 SPLAT_MAP_NORMAL_TEXTURES_UNIFORM = hashName("splatMapNormalTextures");
+constexpr uint64 SPLAT_MAP_METALLIC_ROUGHNESS_AMBIENT_OCCLUSION_TEXTURES_UNIFORM = hashName("splatMapMetallicRoughnessAmbientOcclusionTextures");
+constexpr uint64 G_POSITION_UNIFORM = hashName("gPosition");
+constexpr uint64 G_NORMAL_UNIFORM = hashName("gNormal");
+constexpr uint64 G_ALBEDO_SPEC_UNIFORM = hashName("gAlbedoSpec");
+constexpr uint64 G_METALLIC_ROUGHNESS_AMBIENT_OCCLUSION_UNIFORM = hashName("gMetallicRoughnessAmbientOcclusion");
+constexpr uint64 SHADOW_MAP_UNIFORM = hashName("shadowMap");
+constexpr uint64 LIGHTS_0_POSITION_UNIFORM = hashName("lights[0].Position");
+constexpr uint64 LIGHTS_0_COLOR_UNIFORM = hashName("lights[0].Color");
+constexpr uint64 LIGHTS_0_LINEAR_UNIFORM = hashName("lights[0].Linear");
+constexpr uint64 LIGHTS_0_QUADRATIC_UNIFORM = hashName("lights[0].Quadratic");
+constexpr uint64 DIRECTIONAL_LIGHTS_0_DIRECTION_UNIFORM = hashName("directionalLights[0].direction");
+constexpr uint64 DIRECTIONAL_LIGHTS_0_AMBIENT_UNIFORM = hashName("directionalLights[0].ambient");
+constexpr uint64 DIRECTIONAL_LIGHTS_0_DIFFUSE_UNIFORM = hashName("directionalLights[0].diffuse");
+constexpr uint64 DIRECTIONAL_LIGHTS_0_SPECULAR_UNIFORM = hashName("directionalLights[0].specular");
+constexpr uint64 FRAME_DATA_UNIFORM_BLOCK = hashName("FrameData");
+constexpr uint64 BONES_UNIFORM_BLOCK = hashName("Bones");
+
+// Fixed uniform buffer binding points shared by all shader programs
+constexpr GLuint FRAME_DATA_UNIFORM_BLOCK_BINDING = 0;
+constexpr GLuint BONES_UNIFORM_BLOCK_BINDING = 1;
+
+// Texture unit of the bone palette texture buffer, after the three material textures
+constexpr GLuint BONE_PALETTES_TEXTURE_UNIT = 3;
+
 ShaderProgramHandle lineShaderProgramHandle_;
 ShaderProgramHandle lightingShaderProgramHandle_;
 ShaderProgramHandle skyboxShaderProgramHandle_;
 ShaderProgramHandle deferredLightingGeometryPassProgramHandle_;
 ShaderProgramHandle deferredLightingTerrainGeometryPassProgramHandle_;
+ShaderProgramHandle deferredLightingTerrainTessellationPassProgramHandle_;
+ShaderProgramHandle deferredLightingStreamedTerrainGeometryPassProgramHandle_;
 FrameBuffer frameBuffer_;
 Texture2d positionTexture_;
 Texture2d normalTexture_;
@@ -217,9 +276,29 @@ FrameBuffer shadowMappingFrameBuffer_;
 Texture2d shadowMappingDepthMapTexture_;
 
 ShaderProgramHandle depthDebugShaderProgramHandle_;
+ShaderProgramHandle skinningShaderProgramHandle_;
 uint depthBufferWidth = 1024;
 uint depthBufferHeight = 1024;
 
+// Height of the full range of a terrain height map, passed to the terrain shaders as heightScale
+constexpr float32 TERRAIN_MAX_HEIGHT = 15.0f;
+
+// Height of the detail displacement map at full intensity, in terrain units
+constexpr float32 TERRAIN_DISPLACEMENT_SCALE = 0.5f;
+
+// What textures sample until their image is uploaded: neutral grey, a flat normal, and the default metalness,
+// roughness and ambient occlusion of packMetalnessRoughnessAmbientOcclusion
+const glm::vec4 TEXTURE_PLACEHOLDER = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
+const glm::vec4 NORMAL_TEXTURE_PLACEHOLDER = glm::vec4(0.5f, 0.5f, 1.0f, 1.0f);
+const glm::vec4 METALNESS_ROUGHNESS_AMBIENT_OCCLUSION_TEXTURE_PLACEHOLDER = glm::vec4(127.0f / 255.0f, 127.0f / 255.0f, 127.0f / 255.0f, 0.0f);
+
+// A tessellated terrain tile is a patch of 8 x 8 quads, each subdivided up to 64 times
+constexpr uint32 TERRAIN_TESSELLATION_PATCH_RESOLUTION = 8;
+constexpr uint32 TERRAIN_TESSELLATION_TILE_SIZE = 256;
+
+// Fraction of free mesh arena space outside of the largest free block above which the arena is compacted
+constexpr float32 MESH_ARENA_DEFRAGMENTATION_THRESHOLD = 0.5f;
+
 const unsigned int NR_LIGHTS = 6;
 std::vector<glm::vec3> lightPositions_;
 std::vector<glm::vec3> lightColors_;
@@ -239,6 +318,30 @@ OpenGlRenderer::OpenGlRenderer(utilities::Properties* properties, fs::IFileSyste
 
 OpenGlRenderer::~OpenGlRenderer()
 {
+	// Mesh arenas and the streaming buffer own GL objects, release them while the context still exists
+	for (auto& meshArena : meshArenas_)
+	{
+		if (meshArena.valid()) meshArena.destroy();
+	}
+
+	for (auto& posedVertexArray : posedVertexArrays_)
+	{
+		if (posedVertexArray != 0) glDeleteVertexArrays(1, &posedVertexArray);
+	}
+
+	// Also stops the tile loader threads
+	for (auto& terrain : terrains_)
+	{
+		terrain.streamed.reset();
+	}
+
+	if (lineBatcher_.valid()) lineBatcher_.destroy();
+	if (textureUploadQueue_.valid()) textureUploadQueue_.destroy();
+	if (terrainPatch_.valid()) terrainPatch_.destroy();
+	if (terrainTessellationPatch_.valid()) terrainTessellationPatch_.destroy();
+	if (streamingBuffer_.valid()) streamingBuffer_.destroy();
+	if (bonePaletteBuffer_.valid()) bonePaletteBuffer_.destroy();
+
 	if (openglContext_)
 	{
 		SDL_GL_DeleteContext(openglContext_);
@@ -362,6 +465,88 @@ void OpenGlRenderer::initialize()
 
 	LOG_INFO(logger_, "Width and height set to %s x %s", width_, height_);
 
+	compactVertexFormat_ = properties_->getBoolValue("graphics.compactVertexFormat", false);
+
+	LOG_INFO(logger_, "Use compact vertex format for static meshes: %s", compactVertexFormat_);
+
+	// Instanced attributes honour baseInstance, so per draw instance data needs no shader changes
+	multiDrawIndirect_ = properties_->getBoolValue("graphics.multiDrawIndirect", true)
+		&& GLEW_ARB_draw_indirect
+		&& GLEW_ARB_multi_draw_indirect
+		&& GLEW_ARB_base_instance;
+
+	LOG_INFO(logger_, "Use multi draw indirect: %s", multiDrawIndirect_);
+
+	optimizeMeshes_ = properties_->getBoolValue("graphics.optimizeMeshes", false);
+
+	// Any mesh may get a skeleton after it is created, and welding cannot see the bone ids and weights that come with it,
+	// so welding is only safe when no optimized mesh is ever skinned
+	weldVertices_ = properties_->getBoolValue("graphics.optimizeMeshes.weldVertices", false);
+
+	meshArenaVertexCapacity_ = static_cast<uint32>(properties_->getIntValue(std::string("graphics.meshArena.vertexCapacity"), 1 << 18));
+	meshArenaIndexCapacity_ = static_cast<uint32>(properties_->getIntValue(std::string("graphics.meshArena.indexCapacity"), 1 << 20));
+
+	LOG_INFO(logger_, "Mesh arena capacity set to %s vertices and %s indices", meshArenaVertexCapacity_, meshArenaIndexCapacity_);
+
+	LOG_INFO(logger_, "Optimize meshes: %s (weld vertices: %s)", optimizeMeshes_, weldVertices_);
+
+	const auto boneFormat = properties_->getStringValue("graphics.boneFormat", "mat4");
+
+	if (boneFormat == "mat3x4")
+	{
+		boneFormat_ = BoneFormat::MAT3X4;
+	}
+	else if (boneFormat == "dualQuaternion")
+	{
+		boneFormat_ = BoneFormat::DUAL_QUATERNION;
+	}
+	else
+	{
+		if (boneFormat != "mat4")
+		{
+			LOG_WARN(logger_, "Unknown bone format '%s', valid formats are mat4, mat3x4 and dualQuaternion - using mat4.", boneFormat);
+		}
+
+		boneFormat_ = BoneFormat::MAT4;
+	}
+
+	LOG_INFO(logger_, "Bone format set to %s (%s texels per bone)", boneFormatName(boneFormat_), texelsPerBone(boneFormat_));
+
+	transformFeedbackSkinning_ = properties_->getBoolValue("graphics.transformFeedbackSkinning", true);
+
+	LOG_INFO(logger_, "Skin meshes once per frame with transform feedback: %s", transformFeedbackSkinning_);
+
+	animationLod_.reducedHeight = static_cast<uint32>(properties_->getIntValue(std::string("graphics.animationLod.reducedHeight"), 150));
+	animationLod_.frozenHeight = static_cast<uint32>(properties_->getIntValue(std::string("graphics.animationLod.frozenHeight"), 20));
+	animationLod_.reducedUpdateInterval = static_cast<uint32>(properties_->getIntValue(std::string("graphics.animationLod.reducedUpdateInterval"), 4));
+
+	LOG_INFO(logger_, "Animation LOD: reduced below %s pixels (every %s frames), frozen below %s pixels", animationLod_.reducedHeight, animationLod_.reducedUpdateInterval, animationLod_.frozenHeight);
+
+	// Chunks are drawn with 16 bit indices and morph pairs of quads, so the resolution must be even and small
+	terrainChunkResolution_ = static_cast<uint32>(glm::clamp(properties_->getIntValue(std::string("graphics.terrain.chunkResolution"), 16), 2, 254)) & ~1u;
+	terrainLodCount_ = static_cast<uint32>(glm::clamp(properties_->getIntValue(std::string("graphics.terrain.lodCount"), 6), 1, 16));
+	terrainDetailDistance_ = static_cast<float32>(glm::max(properties_->getIntValue(std::string("graphics.terrain.detailDistance"), 64), 1));
+
+	LOG_INFO(logger_, "Terrain chunk resolution set to %s with %s levels of detail, finest level up to %s units", terrainChunkResolution_, terrainLodCount_, terrainDetailDistance_);
+
+	terrainTessellation_ = properties_->getBoolValue("graphics.terrain.tessellation", false);
+	terrainTessellationTriangleSize_ = static_cast<uint32>(glm::max(properties_->getIntValue(std::string("graphics.terrain.tessellationTriangleSize"), 8), 1));
+
+	terrainStreamingSlotCount_ = static_cast<uint32>(glm::max(properties_->getIntValue(std::string("graphics.terrain.streaming.tileSlots"), 256), 1));
+	terrainStreamingDistance_ = static_cast<float32>(glm::max(properties_->getIntValue(std::string("graphics.terrain.streaming.distance"), 512), 1));
+	terrainStreamingUploadBudget_ = static_cast<GLsizeiptr>(glm::max(properties_->getIntValue(std::string("graphics.terrain.streaming.uploadBudget"), 1024 * 1024), 1));
+
+	LOG_INFO(logger_, "Terrain streaming: %s tile slots, tiles within %s units, %s bytes uploaded per frame", terrainStreamingSlotCount_, terrainStreamingDistance_, terrainStreamingUploadBudget_);
+
+	asynchronousTextureUpload_ = properties_->getBoolValue("graphics.textures.asynchronousUpload", true);
+	textureUploadBudget_ = static_cast<GLsizeiptr>(glm::max(properties_->getIntValue(std::string("graphics.textures.uploadBudget"), 4 * 1024 * 1024), 1));
+
+	LOG_INFO(logger_, "Asynchronous texture upload set to %s with %s bytes uploaded per frame", asynchronousTextureUpload_, textureUploadBudget_);
+
+	cpuMipmaps_ = properties_->getBoolValue("graphics.textures.cpuMipmaps", false);
+
+	LOG_INFO(logger_, "CPU mipmap generation set to %s", cpuMipmaps_);
+
 	if (SDL_Init(SDL_INIT_VIDEO) != 0) throw GraphicsException(std::string("Unable to initialize SDL: ") + SDL_GetError());
 
 	const int glMajorVersion = 3;
@@ -474,12 +659,22 @@ void OpenGlRenderer::initialize()
         LOG_INFO(logger_, "Did not find OpenGL extension ARB_debug_output, cannot enable debug messages");
     }
 
+    if (terrainTessellation_ && !GLEW_ARB_tessellation_shader)
+    {
+        LOG_WARN(logger_, "Did not find OpenGL extension ARB_tessellation_shader, cannot tessellate terrain");
+
+        terrainTessellation_ = false;
+    }
+
+    LOG_INFO(logger_, "Tessellate terrain: %s (triangle size %s pixels)", terrainTessellation_, terrainTessellationTriangleSize_);
+
 	SDL_GL_GetDrawableSize(sdlWindow_, reinterpret_cast<int*>(&width_), reinterpret_cast<int*>(&height_));
 
 	// Set up the model, view, and projection matrices
 	//model_ = glm::scale(glm::mat4(1.0f), glm::vec3(0.5f));
 	model_ = glm::mat4(1.0f);
 	view_ = glm::mat4(1.0f);
+	startTime_ = std::chrono::steady_clock::now();
 	setViewport(width_, height_);
 
 	initializeOpenGlShaderPrograms();
@@ -514,23 +709,44 @@ void OpenGlRenderer::initializeOpenGlShaderPrograms()
 	lineShaderProgramHandle_ = createShaderProgram(lineVertexShaderHandle, lineFragmentShaderHandle);
 
 	// Shadow mapping shader program
-	auto shadowMappingVertexShaderHandle = createVertexShader(loadShaderContents("shadow_mapping.vert"));
+	auto shadowMappingVertexShaderHandle = createVertexShader(loadShaderContents("shadow_mapping.vert", {"octahedral.glsl", "skinning.glsl"}));
 	auto shadowMappingFragmentShaderHandle = createFragmentShader(loadShaderContents("shadow_mapping.frag"));
 
 	shadowMappingShaderProgramHandle_ = createShaderProgram(shadowMappingVertexShaderHandle, shadowMappingFragmentShaderHandle);
 
 	// deferred lighting geometry pass shader program
-	auto deferredLightingGeometryPassVertexShaderHandle = createVertexShader(loadShaderContents("deferred_lighting_geometry_pass.vert"));
+	auto deferredLightingGeometryPassVertexShaderHandle = createVertexShader(loadShaderContents("deferred_lighting_geometry_pass.vert", {"octahedral.glsl", "skinning.glsl"}));
 	auto deferredLightingGeometryPassFragmentShaderHandle = createFragmentShader(loadShaderContents("deferred_lighting_geometry_pass.frag"));
 
 	deferredLightingGeometryPassProgramHandle_ = createShaderProgram(deferredLightingGeometryPassVertexShaderHandle, deferredLightingGeometryPassFragmentShaderHandle);
 
 	// deferred lighting terrain geometry pass shader program
-	auto deferredLightingTerrainGeometryPassVertexShaderHandle = createVertexShader(loadShaderContents("deferred_lighting_terrain_geometry_pass.vert"));
+	auto deferredLightingTerrainGeometryPassVertexShaderHandle = createVertexShader(loadShaderContents("deferred_lighting_terrain_geometry_pass.vert", {"octahedral.glsl"}));
 	auto deferredLightingTerrainGeometryPassFragmentShaderHandle = createFragmentShader(loadShaderContents("deferred_lighting_terrain_geometry_pass.frag"));
 
 	deferredLightingTerrainGeometryPassProgramHandle_ = createShaderProgram(deferredLightingTerrainGeometryPassVertexShaderHandle, deferredLightingTerrainGeometryPassFragmentShaderHandle);
 
+	// deferred lighting terrain tessellation pass shader program, shares the fragment shader of the geometry pass
+	if (terrainTessellation_)
+	{
+		auto deferredLightingTerrainTessellationPassVertexShaderHandle = createVertexShader(loadShaderContents("deferred_lighting_terrain_tessellation.vert"));
+		auto deferredLightingTerrainTessellationPassControlShaderHandle = createTessellationControlShader(loadShaderContents("deferred_lighting_terrain_tessellation.tesc"));
+		auto deferredLightingTerrainTessellationPassEvaluationShaderHandle = createTessellationEvaluationShader(loadShaderContents("deferred_lighting_terrain_tessellation.tese", {"octahedral.glsl"}));
+
+		deferredLightingTerrainTessellationPassProgramHandle_ = createShaderProgram(
+			deferredLightingTerrainTessellationPassVertexShaderHandle,
+			deferredLightingTerrainTessellationPassControlShaderHandle,
+			deferredLightingTerrainTessellationPassEvaluationShaderHandle,
+			deferredLightingTerrainGeometryPassFragmentShaderHandle
+		);
+	}
+
+	// deferred lighting streamed terrain geometry pass shader program
+	auto deferredLightingStreamedTerrainGeometryPassVertexShaderHandle = createVertexShader(loadShaderContents("deferred_lighting_streamed_terrain_geometry_pass.vert", {"octahedral.glsl"}));
+	auto deferredLightingStreamedTerrainGeometryPassFragmentShaderHandle = createFragmentShader(loadShaderContents("deferred_lighting_streamed_terrain_geometry_pass.frag"));
+
+	deferredLightingStreamedTerrainGeometryPassProgramHandle_ = createShaderProgram(deferredLightingStreamedTerrainGeometryPassVertexShaderHandle, deferredLightingStreamedTerrainGeometryPassFragmentShaderHandle);
+
 	// Lighting shader program
 	auto lightingVertexShaderHandle = createVertexShader(loadShaderContents("lighting.vert"));
 	auto lightingFragmentShaderHandle = createFragmentShader(loadShaderContents("lighting.frag"));
@@ -543,6 +759,12 @@ void OpenGlRenderer::initializeOpenGlShaderPrograms()
 
 	skyboxShaderProgramHandle_ = createShaderProgram(skyboxVertexShaderHandle, skyboxFragmentShaderHandle);
 
+	// Skinning shader program, its outputs match the layout of FloatVertex
+	auto skinningVertexShaderHandle = createVertexShader(loadShaderContents("skinning.vert", {"octahedral.glsl", "skinning.glsl"}));
+	const std::vector<std::string> skinningVaryings = {"posedPosition", "posedColor", "posedNormal", "posedTextureCoordinate"};
+
+	skinningShaderProgramHandle_ = shaderPrograms_.create(ShaderProgram(vertexShaders_[skinningVertexShaderHandle], skinningVaryings));
+
 	std::string depthDebugVertexShader = R"(
 #version 330 core
 layout (location = 0) in vec3 aPos;
@@ -648,6 +870,63 @@ void OpenGlRenderer::initializeOpenGlBuffers()
 	renderBuffer_.setStorage(GL_DEPTH_COMPONENT, width_, height_);
 
 	frameBuffer_.attach(renderBuffer_, GL_DEPTH_ATTACHMENT);
+
+	// Per-frame data, which does not depend on the viewport size
+	if (!streamingBuffer_.valid())
+	{
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformBufferOffsetAlignment_);
+
+		const auto streamingBufferFrameSize = properties_->getIntValue(std::string("graphics.streamingBuffer.frameSize"), 1 << 22);
+		const bool persistentMapping = properties_->getBoolValue("graphics.streamingBuffer.persistentMapping", true) && GLEW_ARB_buffer_storage;
+
+		LOG_INFO(logger_, "Streaming buffer frame size set to %s bytes (persistent mapping = %s)", streamingBufferFrameSize, persistentMapping);
+
+		streamingBuffer_.generate(static_cast<GLsizeiptr>(streamingBufferFrameSize), persistentMapping);
+	}
+
+	if (!lineBatcher_.valid())
+	{
+		lineBatcher_.generate();
+	}
+
+	if (!textureUploadQueue_.valid())
+	{
+		textureUploadQueue_.generate();
+	}
+
+	if (!bonePaletteTexture_.valid())
+	{
+		bonePaletteTexture_.generate();
+
+		glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTextureBufferSize_);
+		textureBufferRange_ = GLEW_ARB_texture_buffer_range;
+
+		if (textureBufferRange_)
+		{
+			glGetIntegerv(GL_TEXTURE_BUFFER_OFFSET_ALIGNMENT, &textureBufferOffsetAlignment_);
+			textureBufferOffsetAlignment_ = std::max(textureBufferOffsetAlignment_, static_cast<GLint>(sizeof(glm::vec4)));
+		}
+		else
+		{
+			// Every region must stay within the texels the texture buffer can reach, and start on a whole texel
+			const GLsizeiptr maxFrameSize = static_cast<GLsizeiptr>(maxTextureBufferSize_ / StreamingBuffer::FRAME_COUNT) * static_cast<GLsizeiptr>(sizeof(glm::vec4));
+
+			bonePaletteBuffer_.generate(std::min(maxFrameSize, streamingBuffer_.frameSize()), streamingBuffer_.persistentMapping(), maxFrameSize);
+		}
+
+		LOG_INFO(logger_, "Bone palette texture buffer size limit is %s texels (texture buffer range = %s)", maxTextureBufferSize_, textureBufferRange_);
+	}
+
+	// Streamed terrain uses the CDLOD chunks even when terrain is tessellated
+	if (!terrainPatch_.valid())
+	{
+		terrainPatch_.generate(terrainChunkResolution_);
+	}
+
+	if (terrainTessellation_ && !terrainTessellationPatch_.valid())
+	{
+		terrainTessellationPatch_.generate(TERRAIN_TESSELLATION_PATCH_RESOLUTION, true);
+	}
 }
 
 void OpenGlRenderer::setViewport(const uint32 width, const uint32 height)
@@ -685,282 +964,952 @@ glm::mat4 OpenGlRenderer::getProjectionMatrix() const
 	return projection_;
 }
 
-void OpenGlRenderer::beginRender()
+const RenderStatistics& OpenGlRenderer::renderStatistics() const
 {
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-	glEnable(GL_DEPTH_TEST);
+	return renderStatistics_;
+}
 
-	// Setup camera
-	const glm::quat temp = glm::conjugate(camera_.orientation);
+void OpenGlRenderer::transforms(
+	const RenderSceneHandle& renderSceneHandle,
+	const StridedSpan<RenderableHandle>& renderableHandles,
+	const StridedSpan<glm::vec3>& positions,
+	const StridedSpan<glm::quat>& orientations,
+	const StridedSpan<glm::vec3>& scales
+)
+{
+	const size_t count = renderableHandles.size();
 
-	view_ = glm::mat4_cast(temp);
-	view_ = glm::translate(view_, glm::vec3(-camera_.position.x, -camera_.position.y, -camera_.position.z));
+	if (!positions.empty() && positions.size() != count) throw InvalidArgumentException("Number of positions does not match number of renderables.");
+	if (!orientations.empty() && orientations.size() != count) throw InvalidArgumentException("Number of orientations does not match number of renderables.");
+	if (!scales.empty() && scales.size() != count) throw InvalidArgumentException("Number of scales does not match number of renderables.");
 
-	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-}
+	ice_engine::detail::checkHandleValidity(renderSceneHandles_, renderSceneHandle);
 
-unsigned int quadVAO = 0;
-unsigned int quadVBO;
-void renderQuad()
-{
-    if (quadVAO == 0)
-    {
-        float quadVertices[] = {
-            // positions        // texture Coords
-            -1.0f,  1.0f, 0.0f, 0.0f, 1.0f,
-            -1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
-             1.0f,  1.0f, 0.0f, 1.0f, 1.0f,
-             1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
-        };
-        // setup plane VAO
-        glGenVertexArrays(1, &quadVAO);
-        glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    }
-    glBindVertexArray(quadVAO);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
+	// Look the scene up once, not once per renderable
+	auto& renderScene = renderSceneHandles_[renderSceneHandle];
+	const auto& renderables = renderScene.renderables;
 
-    ASSERT_GL_ERROR();
-}
+	transformIndices_.resize(count);
 
-glm::vec3 direction = glm::vec3(-0.2f, -1.0f, -0.3f);
-//glm::vec3 lPos = glm::vec3(1.0f, 4.0f, 1.0f);
-glm::vec3 ambient = glm::vec3(0.2f, 0.2f, 0.2f);
-glm::vec3 diffuse = glm::vec3(0.2f, 0.2f, 0.2f);
-glm::vec3 specular = glm::vec3(1.0f, 1.0f, 1.0f);
-void OpenGlRenderer::render(const RenderSceneHandle& renderSceneHandle)
-{
-	int modelMatrixLocation = 0;
-	int pvmMatrixLocation = 0;
-	int normalMatrixLocation = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+#if !defined(NDEBUG)
+		ice_engine::detail::checkHandleValidity(renderables, renderableHandles[i]);
+#endif
 
-	//assert( modelMatrixLocation >= 0);
-	//assert( pvmMatrixLocation >= 0);
-	//assert( normalMatrixLocation >= 0);
+		transformIndices_[i] = renderables[renderableHandles[i]].transformIndex;
+	}
 
-	auto& renderScene = renderSceneHandles_[renderSceneHandle];
+	if (count > 0)
+	{
+		renderScene.transforms.set(&transformIndices_[0], count, positions, orientations, scales);
+	}
+}
 
-	// Rendered depth from lights perspective
-	glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+// Alignment of vertex data in the streaming buffer
+constexpr GLsizeiptr STREAMING_VERTEX_ALIGNMENT = 16;
 
-	glm::mat4 lightProjection = glm::mat4(1.0f);
-    glm::mat4 lightView = glm::mat4(1.0f);
-	glm::mat4 lightSpaceMatrix = glm::mat4(1.0f);
-	float near_plane = -10.0f, far_plane = 100.0f;
-	const float lightProjectionSize = 20.0f;
-	lightProjection = glm::ortho(-lightProjectionSize, lightProjectionSize, -lightProjectionSize, lightProjectionSize, near_plane, far_plane);
-	const glm::vec3 lightPos = (direction * -1.0f) + camera_.position;
-	const glm::vec3 lightLookAt = camera_.position;
-	//lightView = glm::lookAt(lightPos, glm::vec3(9.0f, 0.0f, -2.8f), glm::vec3(0.0, 1.0, 0.0));
-	lightView = glm::lookAt(lightPos, lightLookAt, glm::vec3(0.0, 1.0, 0.0));
-	lightSpaceMatrix = lightProjection * lightView;
+// The per-instance model matrix occupies four consecutive attribute locations, the normal matrix three
+constexpr GLuint MODEL_MATRIX_ATTRIBUTE_LOCATION = 6;
+constexpr GLuint NORMAL_MATRIX_ATTRIBUTE_LOCATION = 10;
+constexpr GLuint BONE_PALETTE_ATTRIBUTE_LOCATION = 13;
+constexpr GLuint BONE_ATTACHMENT_IDS_ATTRIBUTE_LOCATION = 14;
+constexpr GLuint BONE_ATTACHMENT_WEIGHTS_ATTRIBUTE_LOCATION = 15;
 
-	// render scene from light's point of view
-	auto& shadowMappingShaderProgram = shaderPrograms_[shadowMappingShaderProgramHandle_];
-	shadowMappingShaderProgram.use();
-	glUniformMatrix4fv(glGetUniformLocation(shadowMappingShaderProgram, "lightSpaceMatrix"), 1, GL_FALSE, &lightSpaceMatrix[0][0]);
+/**
+ * Returns true if the two renderables can be drawn with the same instanced draw call.
+ *
+ * Bone palettes and bone attachments are per instance, so skinned renderables are instanced like any other.
+ */
+bool canShareInstanceBatch(const Renderable& a, const Renderable& b)
+{
+	return a.meshHandle == b.meshHandle
+		&& a.textureHandle == b.textureHandle
+		&& a.materialHandle == b.materialHandle;
+}
 
-	glViewport(0, 0, depthBufferWidth, depthBufferHeight);
+/**
+ * Points the instance attributes of the currently bound vertex array object at the instance data starting at
+ * the given offset in the given buffer.
+ */
+void setInstanceAttributes(const GLuint buffer, const GLintptr offset)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
 
-	shadowMappingFrameBuffer_.bind();
-	Texture2d::activate(0);
+	for (GLuint i = 0; i < 4; ++i)
+	{
+		const GLuint location = MODEL_MATRIX_ATTRIBUTE_LOCATION + i;
+		const GLintptr columnOffset = offset + offsetof(InstanceData, modelMatrix) + i * sizeof(glm::vec4);
+
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (GLvoid*)(columnOffset));
+		glVertexAttribDivisor(location, 1);
+	}
 
+	for (GLuint i = 0; i < 3; ++i)
 	{
-		modelMatrixLocation = glGetUniformLocation(shadowMappingShaderProgram, "modelMatrix");
+		const GLuint location = NORMAL_MATRIX_ATTRIBUTE_LOCATION + i;
+		const GLintptr columnOffset = offset + offsetof(InstanceData, normalMatrix) + i * sizeof(glm::vec3);
 
-		ASSERT_GL_ERROR();
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (GLvoid*)(columnOffset));
+		glVertexAttribDivisor(location, 1);
+	}
 
-		glClear(GL_DEPTH_BUFFER_BIT);
+	glEnableVertexAttribArray(BONE_PALETTE_ATTRIBUTE_LOCATION);
+	glVertexAttribIPointer(BONE_PALETTE_ATTRIBUTE_LOCATION, 1, GL_INT, sizeof(InstanceData), (GLvoid*)(offset + offsetof(InstanceData, bonePalette)));
+	glVertexAttribDivisor(BONE_PALETTE_ATTRIBUTE_LOCATION, 1);
 
-		for (const auto& r : renderScene.renderables)
-		{
-			glm::mat4 newModel = glm::translate(model_, r.graphicsData.position);
-			newModel = newModel * glm::mat4_cast( r.graphicsData.orientation );
-			newModel = glm::scale(newModel, r.graphicsData.scale);
+	glEnableVertexAttribArray(BONE_ATTACHMENT_IDS_ATTRIBUTE_LOCATION);
+	glVertexAttribIPointer(BONE_ATTACHMENT_IDS_ATTRIBUTE_LOCATION, 4, GL_INT, sizeof(InstanceData), (GLvoid*)(offset + offsetof(InstanceData, boneAttachmentIds)));
+	glVertexAttribDivisor(BONE_ATTACHMENT_IDS_ATTRIBUTE_LOCATION, 1);
 
-			// Send uniform variable values to the shader
-			glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, &newModel[0][0]);
+	glEnableVertexAttribArray(BONE_ATTACHMENT_WEIGHTS_ATTRIBUTE_LOCATION);
+	glVertexAttribPointer(BONE_ATTACHMENT_WEIGHTS_ATTRIBUTE_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (GLvoid*)(offset + offsetof(InstanceData, boneAttachmentWeights)));
+	glVertexAttribDivisor(BONE_ATTACHMENT_WEIGHTS_ATTRIBUTE_LOCATION, 1);
+}
 
-			if (r.ubo.id > 0)
-			{
-//				const int bonesLocation = glGetUniformLocation(shadowMappingShaderProgram, "bones");
-//				assert( bonesLocation >= 0);
-//				glBindBufferBase(GL_UNIFORM_BUFFER, bonesLocation, r.ubo.id);
-//				glBindBufferBase(GL_UNIFORM_BUFFER, 0, r.ubo.id);
+/**
+ * Draws instances of a mesh. The vertex array of the mesh's arena must be bound.
+ */
+void drawElementsInstanced(const MeshArena& meshArena, const Vao& vao, const GLsizei instanceCount, const GLint baseVertex)
+{
+	const auto& allocation = meshArena.allocation(vao.allocation);
 
-				ASSERT_GL_ERROR();
-			}
+	glDrawElementsInstancedBaseVertex(
+		vao.mode,
+		static_cast<GLsizei>(allocation.indexCount),
+		allocation.indexType,
+		(GLvoid*)(allocation.indexOffset()),
+		instanceCount,
+		baseVertex
+	);
+}
 
-			auto& texture = texture2ds_[r.textureHandle];
-			texture.bind();
+void drawElementsInstanced(const MeshArena& meshArena, const Vao& vao, const GLsizei instanceCount)
+{
+	drawElementsInstanced(meshArena, vao, instanceCount, static_cast<GLint>(meshArena.allocation(vao.allocation).baseVertex));
+}
 
-			glBindVertexArray(r.vao.id);
-			glDrawElements(r.vao.ebo.mode, r.vao.ebo.count, r.vao.ebo.type, 0);
-			glBindVertexArray(0);
+/**
+ * Returns the base vertex to draw an instance batch with, in its arena or in the frame's posed vertices.
+ */
+GLint baseVertex(const InstanceBatch& instanceBatch, const MeshArena& meshArena)
+{
+	if (instanceBatch.posedBaseVertex >= 0) return instanceBatch.posedBaseVertex;
 
-			ASSERT_GL_ERROR();
-		}
-		//glActiveTexture(GL_TEXTURE0);
-		//glBindTexture(GL_TEXTURE_2D, woodTexture);
-		//renderScene(simpleDepthShader);
-	}
-	FrameBuffer::unbind();
+	return static_cast<GLint>(meshArena.allocation(instanceBatch.vao->allocation).baseVertex);
+}
 
-	// reset viewport
-	glViewport(0, 0, width_, height_);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+/**
+ * Draws the instances of an instance batch. The vertex array returned by OpenGlRenderer::vertexArray() must be bound.
+ */
+void drawElementsInstanced(const MeshArena& meshArena, const InstanceBatch& instanceBatch)
+{
+	drawElementsInstanced(meshArena, *instanceBatch.vao, static_cast<GLsizei>(instanceBatch.instanceCount), baseVertex(instanceBatch, meshArena));
+}
 
-	ASSERT_GL_ERROR();
+/**
+ * Sets the uniforms the vertex shader of the given program needs to decode the vertex format of the given vertex
+ * array object.
+ */
+void setVertexFormatUniforms(const ShaderProgram& shaderProgram, const Vao& vao)
+{
+	glUniform1i(shaderProgram.uniformLocation(COMPACT_VERTEX_FORMAT_UNIFORM), vao.vertexFormat == VertexFormat::COMPACT);
+	glUniform3fv(shaderProgram.uniformLocation(POSITION_SCALE_UNIFORM), 1, &vao.positionScale[0]);
+	glUniform3fv(shaderProgram.uniformLocation(POSITION_BIAS_UNIFORM), 1, &vao.positionBias[0]);
+}
 
-	// Geometry pass
-	frameBuffer_.bind();
+/**
+ * Sets the vertex format uniforms for the vertices an instance batch is drawn from. Posed vertices are always FLOAT.
+ */
+void setVertexFormatUniforms(const ShaderProgram& shaderProgram, const InstanceBatch& instanceBatch)
+{
+	static const Vao posedVertices;
 
-	Texture2d::activate(0);
+	setVertexFormatUniforms(shaderProgram, instanceBatch.posedBaseVertex >= 0 ? posedVertices : *instanceBatch.vao);
+}
 
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+// Textures and materials share the material field of the sort key, materials have the top bit set
+constexpr uint32 MATERIAL_SORT_KEY_FLAG = 1u << 15;
+constexpr uint32 MATERIAL_SORT_KEY_MASK = MATERIAL_SORT_KEY_FLAG - 1u;
 
-	//const auto& renderScene = renderSceneHandles_[renderSceneHandle];
+// Distance from the camera that maps to the largest depth value in the sort key
+constexpr float32 SORT_KEY_MAX_DEPTH = 500.0f;
 
-	//auto& shaderProgram = shaderPrograms_[renderScene.shaderProgramHandle];
-	auto& deferredLightingGeometryPassShaderProgram = shaderPrograms_[deferredLightingGeometryPassProgramHandle_];
-	deferredLightingGeometryPassShaderProgram.use();
-	modelMatrixLocation = glGetUniformLocation(deferredLightingGeometryPassShaderProgram, "modelMatrix");
-	pvmMatrixLocation = glGetUniformLocation(deferredLightingGeometryPassShaderProgram, "pvmMatrix");
-	normalMatrixLocation = glGetUniformLocation(deferredLightingGeometryPassShaderProgram, "normalMatrix");
-	auto hasBonesLocation = glGetUniformLocation(deferredLightingGeometryPassShaderProgram, "hasBones");
-	auto hasBoneAttachmentLocation = glGetUniformLocation(deferredLightingGeometryPassShaderProgram, "hasBoneAttachment");
-	auto boneAttachmentIdsLocation = glGetUniformLocation(deferredLightingGeometryPassShaderProgram, "boneAttachmentIds");
-	auto boneAttachmentWeightsLocation = glGetUniformLocation(deferredLightingGeometryPassShaderProgram, "boneAttachmentWeights");
-
-	glUniform1i(glGetUniformLocation(deferredLightingGeometryPassShaderProgram, "texture_diffuse1"), 0);
-	//glUniform1i(glGetUniformLocation(deferredLightingGeometryPassShaderProgram, "albedoTextures"), 1);
-	glUniform1i(glGetUniformLocation(deferredLightingGeometryPassShaderProgram, "normalTextures"), 1);
-	glUniform1i(glGetUniformLocation(deferredLightingGeometryPassShaderProgram, "metallicRoughnessAmbientOcclusionTextures"), 2);
+// The mesh field of the sort key holds the arena in its top bits, so meshes sharing a vertex array end up together
+constexpr uint32 MESH_SORT_KEY_ARENA_SHIFT = 14;
+constexpr uint32 MESH_SORT_KEY_MASK = (1u << MESH_SORT_KEY_ARENA_SHIFT) - 1u;
 
-	ASSERT_GL_ERROR();
+void OpenGlRenderer::buildInstanceBatches(RenderScene& renderScene)
+{
+	queuedRenderables_.clear();
+	renderableBounds_.clear();
+	renderQueue_.clear();
+	instanceData_.clear();
+	bonePaletteData_.clear();
+	++bonePaletteFrame_;
+	skinningJobs_.clear();
+	skinningJobIndices_.clear();
+	skinnedVertexCount_ = 0;
+	shadowInstanceBatches_.clear();
+	instanceBatches_.clear();
+
+	const uint32 shadowProgram = shadowMappingShaderProgramHandle_.index();
+	const uint32 geometryProgram = deferredLightingGeometryPassProgramHandle_.index();
+
+	auto& transforms = renderScene.transforms;
+	transforms.update();
 
 	for (const auto& r : renderScene.renderables)
 	{
-		glm::mat4 newModel = glm::translate(model_, r.graphicsData.position);
-		newModel = newModel * glm::mat4_cast( r.graphicsData.orientation );
-		newModel = glm::scale(newModel, r.graphicsData.scale);
+		queuedRenderables_.push_back(&r);
+		renderableBounds_.push(transformBoundingSphere(meshes_[r.meshHandle].boundingSphere, transforms.modelMatrix(r.transformIndex)));
+	}
 
-		// Send uniform variable values to the shader
-		const glm::mat4 pvmMatrix(projection_ * view_ * newModel);
-		glUniformMatrix4fv(pvmMatrixLocation, 1, GL_FALSE, &pvmMatrix[0][0]);
+	renderableBounds_.cull(cameraFrustum_, visibleToCamera_);
+	renderableBounds_.cull(lightFrustum_, visibleToLight_);
 
-		glm::mat3 normalMatrix = glm::inverse(glm::transpose(glm::mat3(view_ * newModel)));
-		glUniformMatrix3fv(normalMatrixLocation, 1, GL_FALSE, &normalMatrix[0][0]);
+	for (uint32 index = 0; index < queuedRenderables_.size(); ++index)
+	{
+		const auto& r = *queuedRenderables_[index];
 
-		glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, &newModel[0][0]);
+		const uint32 material = (r.textureHandle ? r.textureHandle.index() & MATERIAL_SORT_KEY_MASK : MATERIAL_SORT_KEY_FLAG | (r.materialHandle.index() & MATERIAL_SORT_KEY_MASK));
+		const uint32 mesh = (meshes_[r.meshHandle].arena << MESH_SORT_KEY_ARENA_SHIFT) | (r.meshHandle.index() & MESH_SORT_KEY_MASK);
+		const float32 depth = glm::length(transforms.position(r.transformIndex) - camera_.position) / SORT_KEY_MAX_DEPTH;
 
-		if (r.ubo.id == 0)
+		// Depth only rendering ignores materials, so leave them out of the shadow key. Bone palettes are per instance, so
+		// skinned instances batch like any other
+		if (visibleToLight_[index])
 		{
-			glUniform1i(hasBonesLocation, 0);
-			glUniform1i(hasBoneAttachmentLocation, 0);
+			renderQueue_.push(RenderQueue::key(RenderPass::SHADOW, shadowProgram, false, 0, mesh, depth), index);
 		}
-		else
-		{
-			glUniform1i(hasBonesLocation, r.hasBones);
-			glUniform1i(hasBoneAttachmentLocation, r.hasBoneAttachment);
-
-			const int bonesLocation = glGetUniformBlockIndex(deferredLightingGeometryPassShaderProgram, "Bones");
-			ICE_ENGINE_ASSERT(bonesLocation >= 0);
-			glBindBufferBase(GL_UNIFORM_BUFFER, bonesLocation, r.ubo.id);
-//			glBindBufferBase(GL_UNIFORM_BUFFER, 0, r.ubo.id);
-
-			ASSERT_GL_ERROR();
 
-			if (r.hasBoneAttachment)
-			{
-				glUniform4iv(boneAttachmentIdsLocation, 1, &r.boneIds[0]);
-				glUniform4fv(boneAttachmentWeightsLocation, 1, &r.boneWeights[0]);
-			}
+		// Props attached to bones count as well, or bones only they follow would freeze
+		if (r.bonesHandle && (r.hasBones || r.hasBoneAttachment) && (visibleToCamera_[index] || visibleToLight_[index]))
+		{
+			updateAnimationLod(r, renderableBounds_.sphere(index));
 		}
 
-		if (r.textureHandle)
+		if (visibleToCamera_[index])
 		{
-			Texture2d::activate(0);
-			auto& texture = texture2ds_[r.textureHandle];
-			texture.bind();
+			renderQueue_.push(RenderQueue::key(RenderPass::GEOMETRY, geometryProgram, r.hasBones, material, mesh, depth), index);
 		}
-		else if (r.materialHandle)
+		else
 		{
-			auto& material = materials_[r.materialHandle];
-			Texture2d::activate(0);
-			material.albedo.bind();
-			Texture2d::activate(1);
-			material.normal.bind();
-			Texture2d::activate(2);
-			material.metallicRoughnessAmbientOcclusion.bind();
+			++renderStatistics_.culled;
 		}
-
-
-		glBindVertexArray(r.vao.id);
-		glDrawElements(r.vao.ebo.mode, r.vao.ebo.count, r.vao.ebo.type, 0);
-		glBindVertexArray(0);
-
-		ASSERT_GL_ERROR();
 	}
 
-	// Terrain
-	auto& deferredLightingTerrainGeometryPassShaderProgram = shaderPrograms_[deferredLightingTerrainGeometryPassProgramHandle_];
-	deferredLightingTerrainGeometryPassShaderProgram.use();
+	renderQueue_.sort();
 
-	ICE_ENGINE_ASSERT(glGetUniformLocation(deferredLightingTerrainGeometryPassShaderProgram, "heightMapTexture") >= 0);
-	ICE_ENGINE_ASSERT(glGetUniformLocation(deferredLightingTerrainGeometryPassShaderProgram, "terrainMapTexture") >= 0);
-	ICE_ENGINE_ASSERT(glGetUniformLocation(deferredLightingTerrainGeometryPassShaderProgram, "splatMapAlbedoTextures") >= 0);
+	for (const auto& item : renderQueue_.items())
+	{
+		const auto r = queuedRenderables_[item.index];
+		const bool shadowPass = (RenderQueue::pass(item.key) == RenderPass::SHADOW);
+		auto& instanceBatches = (shadowPass ? shadowInstanceBatches_ : instanceBatches_);
+
+		// Both passes draw skinned meshes from the same posed vertices
+		const bool posed = transformFeedbackSkinning_ && r->bonesHandle && r->hasBones;
+		const int32 firstPosedVertex = (posed ? posedBaseVertex(*r) : -1);
+
+		// Keys may collide when fields are truncated, so compare the real state of neighbouring items
+		const bool sharesInstanceBatch = !instanceBatches.empty()
+			&& instanceBatches.back().posedBaseVertex == firstPosedVertex
+			&& (shadowPass
+				? instanceBatches.back().renderable->meshHandle == r->meshHandle
+				: canShareInstanceBatch(*instanceBatches.back().renderable, *r));
+
+		if (!sharesInstanceBatch)
+		{
+			InstanceBatch instanceBatch;
+			instanceBatch.renderable = r;
+			instanceBatch.vao = &meshes_[r->meshHandle];
+			instanceBatch.firstInstance = static_cast<uint32>(instanceData_.size());
+			instanceBatch.posedBaseVertex = firstPosedVertex;
 
-	glUniform1i(glGetUniformLocation(deferredLightingTerrainGeometryPassShaderProgram, "heightMapTexture"), 0);
-	glUniform1i(glGetUniformLocation(deferredLightingTerrainGeometryPassShaderProgram, "terrainMapTexture"), 1);
-	glUniform1i(glGetUniformLocation(deferredLightingTerrainGeometryPassShaderProgram, "splatMapAlbedoTextures"), 2);
-	glUniform1i(glGetUniformLocation(deferredLightingTerrainGeometryPassShaderProgram, "splatMapNormalTextures"), 3);
-	glUniform1i(glGetUniformLocation(deferredLightingTerrainGeometryPassShaderProgram, "splatMapMetallicRoughnessAmbientOcclusionTextures"), 4);
+			instanceBatches.push_back(instanceBatch);
+		}
 
-	modelMatrixLocation = glGetUniformLocation(deferredLightingTerrainGeometryPassShaderProgram, "modelMatrix");
-	pvmMatrixLocation = glGetUniformLocation(deferredLightingTerrainGeometryPassShaderProgram, "pvmMatrix");
-	//normalMatrixLocation = glGetUniformLocation(deferredLightingTerrainGeometryPassShaderProgram, "normalMatrix");
+		++instanceBatches.back().instanceCount;
 
-	ICE_ENGINE_ASSERT(modelMatrixLocation >= 0);
-	ICE_ENGINE_ASSERT(pvmMatrixLocation >= 0);
-	//ASSERT(normalMatrixLocation >= 0);
+		InstanceData instanceData;
+		instanceData.modelMatrix = transforms.modelMatrix(r->transformIndex);
+		instanceData.normalMatrix = transforms.normalMatrix(r->transformIndex);
 
-	ASSERT_GL_ERROR();
+		if (r->bonesHandle && (r->hasBones || r->hasBoneAttachment) && !posed)
+		{
+			instanceData.bonePalette = bonePaletteOffset(r->bonesHandle);
+
+			if (r->hasBoneAttachment)
+			{
+				instanceData.boneAttachmentIds = r->boneIds;
+				instanceData.boneAttachmentWeights = r->boneWeights;
+			}
+		}
+
+		instanceData_.push_back(instanceData);
+	}
+
+	if (!bonePaletteData_.empty())
+	{
+		if (bonePaletteData_.size() > static_cast<size_t>(maxTextureBufferSize_))
+		{
+			throw GraphicsException("Bone palettes of " + std::to_string(bonePaletteData_.size()) + " texels exceed the texture buffer size limit of " + std::to_string(maxTextureBufferSize_) + " texels.");
+		}
+
+		const GLsizeiptr size = static_cast<GLsizeiptr>(bonePaletteData_.size() * sizeof(glm::vec4));
+
+		if (textureBufferRange_)
+		{
+			const auto allocation = streamingBuffer_.upload(&bonePaletteData_[0], size, textureBufferOffsetAlignment_);
+
+			bonePaletteTexture_.buffer(GL_RGBA32F, allocation.buffer, allocation.offset, allocation.size);
+			bonePaletteBase_ = 0;
+		}
+		else
+		{
+			// The texture buffer spans the whole palette buffer, the shader adds the base texel of this frame's palettes
+			const auto allocation = bonePaletteBuffer_.upload(&bonePaletteData_[0], size, sizeof(glm::vec4));
+
+			bonePaletteTexture_.buffer(GL_RGBA32F, allocation.buffer);
+			bonePaletteBase_ = static_cast<GLint>(allocation.offset / static_cast<GLintptr>(sizeof(glm::vec4)));
+		}
+	}
+
+	if (!instanceData_.empty())
+	{
+		instanceDataAllocation_ = streamingBuffer_.upload(&instanceData_[0], instanceData_.size() * sizeof(InstanceData), STREAMING_VERTEX_ALIGNMENT);
+	}
+
+	buildMultiDrawBatches();
+}
+
+/**
+ * Returns true if the two instance batches can be submitted with the same multi draw call, i.e. they only differ in
+ * mesh and instances.
+ */
+bool canShareMultiDrawBatch(const InstanceBatch& a, const InstanceBatch& b, const MeshArena& meshArena)
+{
+	const bool posed = (a.posedBaseVertex >= 0);
+
+	// Posed vertices of the same arena share a vertex array and are all FLOAT
+	return posed == (b.posedBaseVertex >= 0)
+		&& a.vao->arena == b.vao->arena
+		&& a.vao->mode == b.vao->mode
+		&& meshArena.allocation(a.vao->allocation).indexType == meshArena.allocation(b.vao->allocation).indexType
+		&& (posed || (a.vao->positionScale == b.vao->positionScale && a.vao->positionBias == b.vao->positionBias))
+		&& a.renderable->textureHandle == b.renderable->textureHandle
+		&& a.renderable->materialHandle == b.renderable->materialHandle;
+}
+
+int32 OpenGlRenderer::bonePaletteOffset(const BonesHandle& bonesHandle)
+{
+	auto& bonePalette = bones_[bonesHandle];
+
+	// Renderables sharing bones share the packed palette
+	if (bonePalette.frame != bonePaletteFrame_)
+	{
+		bonePalette.frame = bonePaletteFrame_;
+		bonePalette.offset = static_cast<uint32>(bonePaletteData_.size());
+
+		const auto& transformations = bonePalette.transformations;
+		const uint32 elapsedFrames = animationLodFrame_ - bonePalette.sampleFrame;
+		const AnimationLodLevel animationLodLevel = this->animationLodLevel(bonePalette);
+
+		if (animationLodLevel == AnimationLodLevel::REDUCED
+			&& elapsedFrames < bonePalette.reducedUpdateInterval
+			&& bonePalette.previousPoses.size() == transformations.size()
+			&& bonePalette.poses.size() == transformations.size()
+			&& !transformations.empty())
+		{
+			// Reduced rate bones trail their last sample by one interval, so the pose keeps moving between samples.
+			// Rotations are slerped, blending the matrices would scale and shear the bones in between.
+			const float32 t = static_cast<float32>(elapsedFrames) / static_cast<float32>(bonePalette.reducedUpdateInterval);
+
+			interpolateBones(bonePalette.previousPoses, bonePalette.poses, t, interpolatedTransformations_);
+
+			packBones(&interpolatedTransformations_[0], interpolatedTransformations_.size(), boneFormat_, bonePaletteData_);
+		}
+		else
+		{
+			// Bones that did not change since they were last packed are not packed again, and frozen ones keep the
+			// palette they were last packed with
+			const bool frozen = (animationLodLevel == AnimationLodLevel::FROZEN && !bonePalette.packedTransformations.empty());
+
+			if (!bonePalette.packed && !frozen)
+			{
+				bonePalette.packedTransformations.clear();
+
+				if (!transformations.empty())
+				{
+					packBones(&transformations[0], transformations.size(), boneFormat_, bonePalette.packedTransformations);
+				}
+
+				bonePalette.packed = true;
+			}
+
+			bonePaletteData_.insert(bonePaletteData_.end(), bonePalette.packedTransformations.begin(), bonePalette.packedTransformations.end());
+		}
+	}
+
+	return static_cast<int32>(bonePalette.offset);
+}
+
+void OpenGlRenderer::updateAnimationLod(const Renderable& renderable, const BoundingSphere& boundingSphere)
+{
+	const auto& animationLod = renderable.animationLod;
+	auto& bonePalette = bones_[renderable.bonesHandle];
+
+	// Projected height of the bounds, in pixels
+	const float32 distance = glm::max(glm::length(boundingSphere.center - camera_.position), boundingSphere.radius);
+	const float32 height = (distance > 0.0f ? boundingSphere.radius * projection_[1][1] / distance * static_cast<float32>(height_) : 0.0f);
+
+	AnimationLodLevel animationLodLevel = AnimationLodLevel::FULL;
+
+	if (height < static_cast<float32>(animationLod.frozenHeight))
+	{
+		animationLodLevel = AnimationLodLevel::FROZEN;
+	}
+	else if (height < static_cast<float32>(animationLod.reducedHeight))
+	{
+		animationLodLevel = AnimationLodLevel::REDUCED;
+	}
+
+	const uint32 reducedUpdateInterval = std::max(animationLod.reducedUpdateInterval, 1u);
+
+	if (bonePalette.animationLodFrame != animationLodFrame_)
+	{
+		bonePalette.animationLodFrame = animationLodFrame_;
+		bonePalette.animationLodLevel = animationLodLevel;
+		bonePalette.reducedUpdateInterval = reducedUpdateInterval;
+	}
+	else
+	{
+		bonePalette.animationLodLevel = std::min(bonePalette.animationLodLevel, animationLodLevel);
+		bonePalette.reducedUpdateInterval = std::min(bonePalette.reducedUpdateInterval, reducedUpdateInterval);
+	}
+}
+
+AnimationLodLevel OpenGlRenderer::animationLodLevel(const BonePalette& bonePalette) const
+{
+	return (bonePalette.animationLodFrame == animationLodFrame_ ? bonePalette.animationLodLevel : AnimationLodLevel::FROZEN);
+}
+
+int32 OpenGlRenderer::posedBaseVertex(const Renderable& renderable)
+{
+	const uint64 key = (static_cast<uint64>(renderable.meshHandle.index()) << 32) | renderable.bonesHandle.index();
+	const auto it = skinningJobIndices_.find(key);
+
+	if (it != skinningJobIndices_.end())
+	{
+		return static_cast<int32>(skinningJobs_[it->second].firstVertex);
+	}
+
+	const auto& vao = meshes_[renderable.meshHandle];
+
+	SkinningJob skinningJob;
+	skinningJob.vao = &vao;
+	skinningJob.bonePalette = bonePaletteOffset(renderable.bonesHandle);
+	skinningJob.firstVertex = skinnedVertexCount_;
+
+	skinnedVertexCount_ += meshArenas_[vao.arena].allocation(vao.allocation).vertexCount;
+
+	skinningJobIndices_.emplace(key, static_cast<uint32>(skinningJobs_.size()));
+	skinningJobs_.push_back(skinningJob);
+
+	return static_cast<int32>(skinningJob.firstVertex);
+}
+
+void OpenGlRenderer::skinVertices()
+{
+	if (skinningJobs_.empty()) return;
+
+	skinnedVertexAllocation_ = streamingBuffer_.allocate(static_cast<GLsizeiptr>(skinnedVertexCount_) * sizeof(FloatVertex), STREAMING_VERTEX_ALIGNMENT);
+
+	auto& skinningShaderProgram = shaderPrograms_[skinningShaderProgramHandle_];
+	skinningShaderProgram.use();
+
+	glUniform1i(skinningShaderProgram.uniformLocation(BONE_PALETTES_UNIFORM), BONE_PALETTES_TEXTURE_UNIT);
+	glUniform1i(skinningShaderProgram.uniformLocation(BONE_PALETTE_BASE_UNIFORM), bonePaletteBase_);
+	glUniform1i(skinningShaderProgram.uniformLocation(BONE_FORMAT_UNIFORM), static_cast<GLint>(boneFormat_));
+	TextureBuffer::activate(BONE_PALETTES_TEXTURE_UNIT);
+	bonePaletteTexture_.bind();
+
+	// Every vertex is posed exactly once, in the order of the jobs, so each job's vertices start at its firstVertex
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, skinnedVertexAllocation_.buffer, skinnedVertexAllocation_.offset, skinnedVertexAllocation_.size);
+	glBeginTransformFeedback(GL_POINTS);
+
+	GLuint boundVertexArray = 0;
+
+	for (const auto& skinningJob : skinningJobs_)
+	{
+		const auto& vao = *skinningJob.vao;
+		const auto& meshArena = meshArenas_[vao.arena];
+		const auto& allocation = meshArena.allocation(vao.allocation);
+
+		if (meshArena.id() != boundVertexArray)
+		{
+			glBindVertexArray(meshArena.id());
+			boundVertexArray = meshArena.id();
+		}
+
+		setVertexFormatUniforms(skinningShaderProgram, vao);
+		glUniform1i(skinningShaderProgram.uniformLocation(BONE_PALETTE_UNIFORM), skinningJob.bonePalette);
+
+		glDrawArrays(GL_POINTS, static_cast<GLint>(allocation.baseVertex), static_cast<GLsizei>(allocation.vertexCount));
+
+		renderStatistics_.skinnedVertices += allocation.vertexCount;
+	}
+
+	glEndTransformFeedback();
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glDisable(GL_RASTERIZER_DISCARD);
+
+	// The posed vertices move every frame and the arenas' index buffers change when they grow
+	for (uint32 i = 0; i < 4; ++i)
+	{
+		if (!meshArenas_[i].valid() || !meshArenas_[i].skinned()) continue;
+
+		if (posedVertexArrays_[i] == 0)
+		{
+			glGenVertexArrays(1, &posedVertexArrays_[i]);
+
+			if (posedVertexArrays_[i] == 0) throw GraphicsException("Could not create posed vertex array.");
+		}
+
+		glBindVertexArray(posedVertexArrays_[i]);
+		glBindBuffer(GL_ARRAY_BUFFER, skinnedVertexAllocation_.buffer);
+
+		constexpr GLsizei stride = sizeof(FloatVertex);
+		const GLintptr offset = skinnedVertexAllocation_.offset;
+
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(offset + offsetof(FloatVertex, position)));
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(offset + offsetof(FloatVertex, color)));
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(offset + offsetof(FloatVertex, normal)));
+		glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(offset + offsetof(FloatVertex, textureCoordinate)));
+
+		for (GLuint location = 0; location < 4; ++location)
+		{
+			glEnableVertexAttribArray(location);
+		}
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshArenas_[i].indexBuffer());
+	}
+
+	glBindVertexArray(0);
+
+	ASSERT_GL_ERROR();
+}
+
+GLuint OpenGlRenderer::vertexArray(const InstanceBatch& instanceBatch) const
+{
+	if (instanceBatch.posedBaseVertex >= 0) return posedVertexArrays_[instanceBatch.vao->arena];
+
+	return meshArenas_[instanceBatch.vao->arena].id();
+}
+
+void OpenGlRenderer::buildMultiDrawBatches()
+{
+	drawCommands_.clear();
+	multiDrawBatches_.clear();
+
+	for (uint32 i = 0; i < instanceBatches_.size(); ++i)
+	{
+		const auto& instanceBatch = instanceBatches_[i];
+		const auto& meshArena = meshArenas_[instanceBatch.vao->arena];
+		const auto& allocation = meshArena.allocation(instanceBatch.vao->allocation);
+
+		const bool sharesMultiDrawBatch = multiDrawIndirect_
+			&& !multiDrawBatches_.empty()
+			&& canShareMultiDrawBatch(instanceBatches_[multiDrawBatches_.back().firstInstanceBatch], instanceBatch, meshArena);
+
+		if (!sharesMultiDrawBatch)
+		{
+			MultiDrawBatch multiDrawBatch;
+			multiDrawBatch.firstInstanceBatch = i;
+			multiDrawBatch.firstCommand = static_cast<uint32>(drawCommands_.size());
+			multiDrawBatch.indexType = allocation.indexType;
+
+			multiDrawBatches_.push_back(multiDrawBatch);
+		}
+
+		++multiDrawBatches_.back().instanceBatchCount;
+		multiDrawBatches_.back().instanceCount += instanceBatch.instanceCount;
+
+		if (multiDrawIndirect_)
+		{
+			DrawElementsIndirectCommand command;
+			command.count = allocation.indexCount;
+			command.instanceCount = instanceBatch.instanceCount;
+			command.firstIndex = allocation.firstIndex();
+			command.baseVertex = baseVertex(instanceBatch, meshArena);
+			command.baseInstance = instanceBatch.firstInstance;
+
+			drawCommands_.push_back(command);
+		}
+	}
+
+	if (!drawCommands_.empty())
+	{
+		drawCommandAllocation_ = streamingBuffer_.upload(&drawCommands_[0], drawCommands_.size() * sizeof(DrawElementsIndirectCommand), sizeof(GLuint));
+	}
+}
+
+glm::vec3 direction = glm::vec3(-0.2f, -1.0f, -0.3f);
+//glm::vec3 lPos = glm::vec3(1.0f, 4.0f, 1.0f);
+glm::vec3 ambient = glm::vec3(0.2f, 0.2f, 0.2f);
+glm::vec3 diffuse = glm::vec3(0.2f, 0.2f, 0.2f);
+glm::vec3 specular = glm::vec3(1.0f, 1.0f, 1.0f);
+void OpenGlRenderer::beginRender()
+{
+	++animationLodFrame_;
+
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	glEnable(GL_DEPTH_TEST);
+
+	// Setup camera
+	const glm::quat temp = glm::conjugate(camera_.orientation);
+
+	view_ = glm::mat4_cast(temp);
+	view_ = glm::translate(view_, glm::vec3(-camera_.position.x, -camera_.position.y, -camera_.position.z));
+
+	// Setup light space
+	const float near_plane = -10.0f, far_plane = 100.0f;
+	const float lightProjectionSize = 20.0f;
+	const glm::mat4 lightProjection = glm::ortho(-lightProjectionSize, lightProjectionSize, -lightProjectionSize, lightProjectionSize, near_plane, far_plane);
+	const glm::vec3 lightPos = (direction * -1.0f) + camera_.position;
+	const glm::vec3 lightLookAt = camera_.position;
+	//lightView = glm::lookAt(lightPos, glm::vec3(9.0f, 0.0f, -2.8f), glm::vec3(0.0, 1.0, 0.0));
+	const glm::mat4 lightView = glm::lookAt(lightPos, lightLookAt, glm::vec3(0.0, 1.0, 0.0));
+
+	// Upload the per-frame data once, every shader program reads it from the same binding point
+	frameData_.view = view_;
+	frameData_.projection = projection_;
+	frameData_.viewProjection = projection_ * view_;
+	frameData_.lightSpaceMatrix = lightProjection * lightView;
+	frameData_.cameraPosition = glm::vec4(camera_.position, 1.0f);
+	frameData_.viewport = glm::vec2(width_, height_);
+	frameData_.time = std::chrono::duration<float32>(std::chrono::steady_clock::now() - startTime_).count();
+
+	const auto frameDataAllocation = streamingBuffer_.upload(&frameData_, sizeof(FrameData), uniformBufferOffsetAlignment_);
+	glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_DATA_UNIFORM_BLOCK_BINDING, frameDataAllocation.buffer, frameDataAllocation.offset, frameDataAllocation.size);
+
+	cameraFrustum_ = frustum(frameData_.viewProjection);
+	lightFrustum_ = frustum(frameData_.lightSpaceMatrix);
+
+	renderStatistics_ = RenderStatistics();
+
+	// Textures created since the last frame, transferred before anything samples them
+	renderStatistics_.textureBytesUploaded = static_cast<uint32>(textureUploadQueue_.process(textureUploadBudget_));
+
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+unsigned int quadVAO = 0;
+unsigned int quadVBO;
+void renderQuad()
+{
+    if (quadVAO == 0)
+    {
+        float quadVertices[] = {
+            // positions        // texture Coords
+            -1.0f,  1.0f, 0.0f, 0.0f, 1.0f,
+            -1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
+             1.0f,  1.0f, 0.0f, 1.0f, 1.0f,
+             1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+        };
+        // setup plane VAO
+        glGenVertexArrays(1, &quadVAO);
+        glGenBuffers(1, &quadVBO);
+        glBindVertexArray(quadVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+    }
+    glBindVertexArray(quadVAO);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+
+    ASSERT_GL_ERROR();
+}
+
+void OpenGlRenderer::render(const RenderSceneHandle& renderSceneHandle)
+{
+	int modelMatrixLocation = 0;
+
+	//assert( modelMatrixLocation >= 0);
+
+	auto& renderScene = renderSceneHandles_[renderSceneHandle];
+
+	buildInstanceBatches(renderScene);
+
+	// Pose skinned meshes once for both the shadow and the geometry pass
+	skinVertices();
+
+	// Rendered depth from lights perspective
+	glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// render scene from light's point of view
+	auto& shadowMappingShaderProgram = shaderPrograms_[shadowMappingShaderProgramHandle_];
+	shadowMappingShaderProgram.use();
+
+	// Instances that are not posed beforehand are skinned in the shadow pass too
+	glUniform1i(shadowMappingShaderProgram.uniformLocation(BONE_PALETTES_UNIFORM), BONE_PALETTES_TEXTURE_UNIT);
+	glUniform1i(shadowMappingShaderProgram.uniformLocation(BONE_PALETTE_BASE_UNIFORM), bonePaletteBase_);
+	glUniform1i(shadowMappingShaderProgram.uniformLocation(BONE_FORMAT_UNIFORM), static_cast<GLint>(boneFormat_));
+	TextureBuffer::activate(BONE_PALETTES_TEXTURE_UNIT);
+	bonePaletteTexture_.bind();
+
+	glViewport(0, 0, depthBufferWidth, depthBufferHeight);
+
+	shadowMappingFrameBuffer_.bind();
+	Texture2d::activate(0);
+
+	{
+		ASSERT_GL_ERROR();
+
+		glClear(GL_DEPTH_BUFFER_BIT);
+
+		GLuint boundVertexArray = 0;
+
+		for (const auto& instanceBatch : shadowInstanceBatches_)
+		{
+			auto& meshArena = meshArenas_[instanceBatch.vao->arena];
+			const GLuint batchVertexArray = vertexArray(instanceBatch);
+
+			if (batchVertexArray != boundVertexArray)
+			{
+				glBindVertexArray(batchVertexArray);
+				boundVertexArray = batchVertexArray;
+
+				++renderStatistics_.vertexArrayBinds;
+			}
+			else
+			{
+				++renderStatistics_.bindsAvoided;
+			}
+
+			setVertexFormatUniforms(shadowMappingShaderProgram, instanceBatch);
+			setInstanceAttributes(instanceDataAllocation_.buffer, instanceDataAllocation_.offset + instanceBatch.firstInstance * sizeof(InstanceData));
+			drawElementsInstanced(meshArena, instanceBatch);
+
+			++renderStatistics_.drawCalls;
+			renderStatistics_.instances += instanceBatch.instanceCount;
+
+			ASSERT_GL_ERROR();
+		}
+
+		glBindVertexArray(0);
+		//glActiveTexture(GL_TEXTURE0);
+		//glBindTexture(GL_TEXTURE_2D, woodTexture);
+		//renderScene(simpleDepthShader);
+	}
+	FrameBuffer::unbind();
+
+	// reset viewport
+	glViewport(0, 0, width_, height_);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	ASSERT_GL_ERROR();
+
+	// Geometry pass
+	frameBuffer_.bind();
+
+	Texture2d::activate(0);
+
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	//const auto& renderScene = renderSceneHandles_[renderSceneHandle];
+
+	//auto& shaderProgram = shaderPrograms_[renderScene.shaderProgramHandle];
+	auto& deferredLightingGeometryPassShaderProgram = shaderPrograms_[deferredLightingGeometryPassProgramHandle_];
+	deferredLightingGeometryPassShaderProgram.use();
+
+	glUniform1i(deferredLightingGeometryPassShaderProgram.uniformLocation(TEXTURE_DIFFUSE1_UNIFORM), 0);
+	//glUniform1i(glGetUniformLocation(deferredLightingGeometryPassShaderProgram, "albedoTextures"), 1);
+	glUniform1i(deferredLightingGeometryPassShaderProgram.uniformLocation(NORMAL_TEXTURES_UNIFORM), 1);
+	glUniform1i(deferredLightingGeometryPassShaderProgram.uniformLocation(METALLIC_ROUGHNESS_AMBIENT_OCCLUSION_TEXTURES_UNIFORM), 2);
+
+	// All bone palettes of the frame are bound once
+	glUniform1i(deferredLightingGeometryPassShaderProgram.uniformLocation(BONE_PALETTES_UNIFORM), BONE_PALETTES_TEXTURE_UNIT);
+	glUniform1i(deferredLightingGeometryPassShaderProgram.uniformLocation(BONE_PALETTE_BASE_UNIFORM), bonePaletteBase_);
+	glUniform1i(deferredLightingGeometryPassShaderProgram.uniformLocation(BONE_FORMAT_UNIFORM), static_cast<GLint>(boneFormat_));
+	TextureBuffer::activate(BONE_PALETTES_TEXTURE_UNIT);
+	bonePaletteTexture_.bind();
+
+	ASSERT_GL_ERROR();
+
+	// Track what is bound so batches that share state with the previous batch skip the redundant binds
+	GLuint boundVertexArray = 0;
+	GLuint boundTextures[3] = {0, 0, 0};
+
+	auto bindTexture = [&](const GLuint unit, Texture2d& texture) {
+		if (boundTextures[unit] == texture.id())
+		{
+			++renderStatistics_.bindsAvoided;
+			return;
+		}
+
+		Texture2d::activate(unit);
+		texture.bind();
+		boundTextures[unit] = texture.id();
+
+		++renderStatistics_.textureBinds;
+	};
+
+	if (multiDrawIndirect_)
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawCommandAllocation_.buffer);
+	}
+
+	for (const auto& multiDrawBatch : multiDrawBatches_)
+	{
+		const auto& instanceBatch = instanceBatches_[multiDrawBatch.firstInstanceBatch];
+		const auto& r = *instanceBatch.renderable;
+
+		if (r.textureHandle)
+		{
+			bindTexture(0, texture2ds_[r.textureHandle]);
+		}
+		else if (r.materialHandle)
+		{
+			auto& material = materials_[r.materialHandle];
+			bindTexture(0, material.albedo);
+			bindTexture(1, material.normal);
+			bindTexture(2, material.metallicRoughnessAmbientOcclusion);
+		}
+
+		const auto& vao = *instanceBatch.vao;
+		auto& meshArena = meshArenas_[vao.arena];
+		const GLuint batchVertexArray = vertexArray(instanceBatch);
+
+		if (batchVertexArray != boundVertexArray)
+		{
+			glBindVertexArray(batchVertexArray);
+			boundVertexArray = batchVertexArray;
+
+			// The shadow pass leaves the instance attributes pointing at its last batch
+			if (multiDrawIndirect_) setInstanceAttributes(instanceDataAllocation_.buffer, instanceDataAllocation_.offset);
+
+			++renderStatistics_.vertexArrayBinds;
+		}
+		else
+		{
+			++renderStatistics_.bindsAvoided;
+		}
+
+		setVertexFormatUniforms(deferredLightingGeometryPassShaderProgram, instanceBatch);
+
+		if (multiDrawIndirect_)
+		{
+			glMultiDrawElementsIndirect(
+				vao.mode,
+				multiDrawBatch.indexType,
+				(GLvoid*)(drawCommandAllocation_.offset + multiDrawBatch.firstCommand * sizeof(DrawElementsIndirectCommand)),
+				static_cast<GLsizei>(multiDrawBatch.instanceBatchCount),
+				sizeof(DrawElementsIndirectCommand)
+			);
+		}
+		else
+		{
+			setInstanceAttributes(instanceDataAllocation_.buffer, instanceDataAllocation_.offset + instanceBatch.firstInstance * sizeof(InstanceData));
+			drawElementsInstanced(meshArena, instanceBatch);
+		}
+
+		++renderStatistics_.drawCalls;
+		renderStatistics_.instances += multiDrawBatch.instanceCount;
+
+		ASSERT_GL_ERROR();
+	}
+
+	glBindVertexArray(0);
+
+	if (multiDrawIndirect_)
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	// Terrain
+	auto& deferredLightingTerrainGeometryPassShaderProgram = shaderPrograms_[terrainTessellation_ ? deferredLightingTerrainTessellationPassProgramHandle_ : deferredLightingTerrainGeometryPassProgramHandle_];
+	deferredLightingTerrainGeometryPassShaderProgram.use();
+
+	ICE_ENGINE_ASSERT(deferredLightingTerrainGeometryPassShaderProgram.uniformLocation(HEIGHT_MAP_TEXTURE_UNIFORM) >= 0);
+	ICE_ENGINE_ASSERT(deferredLightingTerrainGeometryPassShaderProgram.uniformLocation(TERRAIN_MAP_TEXTURE_UNIFORM) >= 0);
+	ICE_ENGINE_ASSERT(deferredLightingTerrainGeometryPassShaderProgram.uniformLocation(SPLAT_MAP_ALBEDO_TEXTURES_UNIFORM) >= 0);
+
+	glUniform1i(deferredLightingTerrainGeometryPassShaderProgram.uniformLocation(HEIGHT_MAP_TEXTURE_UNIFORM), 0);
+	glUniform1i(deferredLightingTerrainGeometryPassShaderProgram.uniformLocation(TERRAIN_MAP_TEXTURE_UNIFORM), 1);
+	glUniform1i(deferredLightingTerrainGeometryPassShaderProgram.uniformLocation(SPLAT_MAP_ALBEDO_TEXTURES_UNIFORM), 2);
+	glUniform1i(deferredLightingTerrainGeometryPassShaderProgram.uniformLocation(SPLAT_MAP_NORMAL_TEXTURES_UNIFORM), 3);
+	glUniform1i(deferredLightingTerrainGeometryPassShaderProgram.uniformLocation(SPLAT_MAP_METALLIC_ROUGHNESS_AMBIENT_OCCLUSION_TEXTURES_UNIFORM), 4);
+	glUniform1i(deferredLightingTerrainGeometryPassShaderProgram.uniformLocation(DISPLACEMENT_MAP_TEXTURE_UNIFORM), 5);
+	glUniform1f(deferredLightingTerrainGeometryPassShaderProgram.uniformLocation(TRIANGLE_SIZE_UNIFORM), static_cast<float32>(terrainTessellationTriangleSize_));
+
+	modelMatrixLocation = deferredLightingTerrainGeometryPassShaderProgram.uniformLocation(MODEL_MATRIX_UNIFORM);
+
+	ICE_ENGINE_ASSERT(modelMatrixLocation >= 0);
+
+	ASSERT_GL_ERROR();
 
 	for (auto& t : renderScene.terrain)
 	{
+		auto& terrain = terrains_[t.terrainHandle];
+
+		// Drawn below, with their own shader program
+		if (terrain.streamed) continue;
+
 		glm::mat4 newModel = glm::translate(model_, t.graphicsData.position);
 		newModel = newModel * glm::mat4_cast( t.graphicsData.orientation );
 		newModel = glm::scale(newModel, t.graphicsData.scale);
 
-		// Send uniform variable values to the shader
-		const glm::mat4 pvmMatrix(projection_ * view_ * newModel);
-		glUniformMatrix4fv(pvmMatrixLocation, 1, GL_FALSE, &pvmMatrix[0][0]);
+		if (!intersects(cameraFrustum_, transformBoundingSphere(t.vao.boundingSphere, newModel)))
+		{
+			++renderStatistics_.culled;
+			continue;
+		}
 
-		//glm::mat3 normalMatrix = glm::inverse(glm::transpose(glm::mat3(view_ * newModel)));
-		//glUniformMatrix3fv(normalMatrixLocation, 1, GL_FALSE, &normalMatrix[0][0]);
+		// Levels of detail are selected in terrain space
+		const glm::vec3 terrainCameraPosition = glm::vec3(glm::inverse(newModel) * glm::vec4(camera_.position, 1.0f));
+
+		terrainChunks_.clear();
+
+		// Tessellated tiles pick their level of detail on the GPU
+		if (terrainTessellation_)
+		{
+			renderStatistics_.culled += terrain.quadtree.tile(TERRAIN_TESSELLATION_TILE_SIZE, cameraFrustum_, newModel, terrainChunks_);
+		}
+		else
+		{
+			renderStatistics_.culled += terrain.quadtree.select(terrainCameraPosition, cameraFrustum_, newModel, terrainChunks_);
+		}
+
+		if (terrainChunks_.empty()) continue;
 
+		const auto terrainChunkAllocation = streamingBuffer_.upload(&terrainChunks_[0], terrainChunks_.size() * sizeof(TerrainChunk), STREAMING_VERTEX_ALIGNMENT);
+		const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(newModel)));
+		auto& terrainPatch = (terrainTessellation_ ? terrainTessellationPatch_ : terrainPatch_);
+
+		// Send uniform variable values to the shader
 		glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, &newModel[0][0]);
+		glUniform2f(deferredLightingTerrainGeometryPassShaderProgram.uniformLocation(TERRAIN_SIZE_UNIFORM), static_cast<float32>(terrain.width), static_cast<float32>(terrain.height));
+		glUniform3fv(deferredLightingTerrainGeometryPassShaderProgram.uniformLocation(TERRAIN_CAMERA_POSITION_UNIFORM), 1, &terrainCameraPosition[0]);
+		glUniform1f(deferredLightingTerrainGeometryPassShaderProgram.uniformLocation(CHUNK_RESOLUTION_UNIFORM), static_cast<float32>(terrainPatch.resolution()));
+		glUniform1f(deferredLightingTerrainGeometryPassShaderProgram.uniformLocation(DISPLACEMENT_SCALE_UNIFORM), terrain.displacementScale);
+		glUniform1f(deferredLightingTerrainGeometryPassShaderProgram.uniformLocation(HEIGHT_SCALE_UNIFORM), terrain.heightScale);
+		glUniformMatrix3fv(deferredLightingTerrainGeometryPassShaderProgram.uniformLocation(NORMAL_MATRIX_UNIFORM), 1, GL_FALSE, &normalMatrix[0][0]);
 
 		if (t.ubo.id > 0)
 		{
-			//const int bonesLocation = glGetUniformLocation(deferredLightingGeometryPassShaderProgram, "bones");
-			//assert( bonesLocation >= 0);
-			//glBindBufferBase(GL_UNIFORM_BUFFER, bonesLocation, r.ubo.id);
-			glBindBufferBase(GL_UNIFORM_BUFFER, 0, t.ubo.id);
+			glBindBufferBase(GL_UNIFORM_BUFFER, BONES_UNIFORM_BLOCK_BINDING, t.ubo.id);
 		}
 
-		auto& terrain = terrains_[t.terrainHandle];
-
 		Texture2d::activate(0);
 		auto& texture = texture2ds_[terrain.textureHandle];
 		texture.bind();
@@ -978,9 +1927,95 @@ void OpenGlRenderer::render(const RenderSceneHandle& renderSceneHandle)
 		Texture2dArray::activate(4);
 		terrain.splatMapTexture2dArrays[2].bind();
 
-		glBindVertexArray(t.vao.id);
-		glDrawElements(t.vao.ebo.mode, t.vao.ebo.count, t.vao.ebo.type, 0);
-		glBindVertexArray(0);
+		if (terrain.displacementScale > 0.0f)
+		{
+			Texture2d::activate(5);
+			texture2ds_[terrain.displacementMapTextureHandle].bind();
+		}
+
+		// Every chunk is an instance of the same patch
+		terrainPatch.draw(terrainChunkAllocation, static_cast<uint32>(terrainChunks_.size()));
+
+		++renderStatistics_.drawCalls;
+		renderStatistics_.instances += static_cast<uint32>(terrainChunks_.size());
+
+		ASSERT_GL_ERROR();
+	}
+
+	// Streamed terrain
+	auto& deferredLightingStreamedTerrainGeometryPassShaderProgram = shaderPrograms_[deferredLightingStreamedTerrainGeometryPassProgramHandle_];
+	deferredLightingStreamedTerrainGeometryPassShaderProgram.use();
+
+	glUniform1i(deferredLightingStreamedTerrainGeometryPassShaderProgram.uniformLocation(HEIGHT_MAP_TILES_UNIFORM), 0);
+	glUniform1i(deferredLightingStreamedTerrainGeometryPassShaderProgram.uniformLocation(TERRAIN_MAP_TILES_UNIFORM), 1);
+	glUniform1i(deferredLightingStreamedTerrainGeometryPassShaderProgram.uniformLocation(SPLAT_MAP_ALBEDO_TEXTURES_UNIFORM), 2);
+	glUniform1i(deferredLightingStreamedTerrainGeometryPassShaderProgram.uniformLocation(SPLAT_MAP_NORMAL_TEXTURES_UNIFORM), 3);
+	glUniform1i(deferredLightingStreamedTerrainGeometryPassShaderProgram.uniformLocation(SPLAT_MAP_METALLIC_ROUGHNESS_AMBIENT_OCCLUSION_TEXTURES_UNIFORM), 4);
+	glUniform1i(deferredLightingStreamedTerrainGeometryPassShaderProgram.uniformLocation(TILE_SLOTS_UNIFORM), 5);
+	glUniform1i(deferredLightingStreamedTerrainGeometryPassShaderProgram.uniformLocation(HEIGHT_MAP_OVERVIEW_UNIFORM), 6);
+	glUniform1i(deferredLightingStreamedTerrainGeometryPassShaderProgram.uniformLocation(TERRAIN_MAP_OVERVIEW_UNIFORM), 7);
+
+	modelMatrixLocation = deferredLightingStreamedTerrainGeometryPassShaderProgram.uniformLocation(MODEL_MATRIX_UNIFORM);
+
+	// Shared by every streamed terrain of the frame
+	GLsizeiptr terrainUploadBudget = terrainStreamingUploadBudget_;
+
+	for (auto& t : renderScene.terrain)
+	{
+		auto& terrain = terrains_[t.terrainHandle];
+
+		if (!terrain.streamed) continue;
+
+		glm::mat4 newModel = glm::translate(model_, t.graphicsData.position);
+		newModel = newModel * glm::mat4_cast( t.graphicsData.orientation );
+		newModel = glm::scale(newModel, t.graphicsData.scale);
+
+		const glm::vec3 terrainCameraPosition = glm::vec3(glm::inverse(newModel) * glm::vec4(camera_.position, 1.0f));
+
+		// Tiles stream in whether or not the terrain is in view, so they are ready when the camera turns around
+		const GLsizeiptr uploaded = terrain.streamed->update(terrainCameraPosition, terrainStreamingDistance_, terrainUploadBudget);
+
+		terrainUploadBudget -= uploaded;
+		renderStatistics_.terrainTileBytesUploaded += static_cast<uint32>(uploaded);
+
+		if (!intersects(cameraFrustum_, transformBoundingSphere(t.vao.boundingSphere, newModel)))
+		{
+			++renderStatistics_.culled;
+			continue;
+		}
+
+		terrainChunks_.clear();
+		renderStatistics_.culled += terrain.quadtree.select(terrainCameraPosition, cameraFrustum_, newModel, terrainChunks_);
+
+		if (terrainChunks_.empty()) continue;
+
+		const auto terrainChunkAllocation = streamingBuffer_.upload(&terrainChunks_[0], terrainChunks_.size() * sizeof(TerrainChunk), STREAMING_VERTEX_ALIGNMENT);
+		const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(newModel)));
+
+		glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, &newModel[0][0]);
+		glUniform2f(deferredLightingStreamedTerrainGeometryPassShaderProgram.uniformLocation(TERRAIN_SIZE_UNIFORM), static_cast<float32>(terrain.width), static_cast<float32>(terrain.height));
+		glUniform3fv(deferredLightingStreamedTerrainGeometryPassShaderProgram.uniformLocation(TERRAIN_CAMERA_POSITION_UNIFORM), 1, &terrainCameraPosition[0]);
+		glUniform1f(deferredLightingStreamedTerrainGeometryPassShaderProgram.uniformLocation(CHUNK_RESOLUTION_UNIFORM), static_cast<float32>(terrainPatch_.resolution()));
+		glUniform1f(deferredLightingStreamedTerrainGeometryPassShaderProgram.uniformLocation(TILE_SIZE_UNIFORM), static_cast<float32>(terrain.streamed->tileSize()));
+		glUniform1f(deferredLightingStreamedTerrainGeometryPassShaderProgram.uniformLocation(OVERVIEW_STEP_UNIFORM), static_cast<float32>(terrain.streamed->overviewStep()));
+		glUniform1f(deferredLightingStreamedTerrainGeometryPassShaderProgram.uniformLocation(HEIGHT_SCALE_UNIFORM), terrain.heightScale);
+		glUniformMatrix3fv(deferredLightingStreamedTerrainGeometryPassShaderProgram.uniformLocation(NORMAL_MATRIX_UNIFORM), 1, GL_FALSE, &normalMatrix[0][0]);
+
+		terrain.streamed->bind(0, 1, 5, 6, 7);
+
+		Texture2dArray::activate(2);
+		terrain.splatMapTexture2dArrays[0].bind();
+
+		Texture2dArray::activate(3);
+		terrain.splatMapTexture2dArrays[1].bind();
+
+		Texture2dArray::activate(4);
+		terrain.splatMapTexture2dArrays[2].bind();
+
+		terrainPatch_.draw(terrainChunkAllocation, static_cast<uint32>(terrainChunks_.size()));
+
+		++renderStatistics_.drawCalls;
+		renderStatistics_.instances += static_cast<uint32>(terrainChunks_.size());
 
 		ASSERT_GL_ERROR();
 	}
@@ -995,14 +2030,11 @@ void OpenGlRenderer::render(const RenderSceneHandle& renderSceneHandle)
 	auto& lightingShaderProgram = shaderPrograms_[lightingShaderProgramHandle_];
 	lightingShaderProgram.use();
 
-	glUniform1i(glGetUniformLocation(lightingShaderProgram, "gPosition"), 0);
-	glUniform1i(glGetUniformLocation(lightingShaderProgram, "gNormal"), 1);
-	glUniform1i(glGetUniformLocation(lightingShaderProgram, "gAlbedoSpec"), 2);
-	glUniform1i(glGetUniformLocation(lightingShaderProgram, "gMetallicRoughnessAmbientOcclusion"), 3);
-	glUniform1i(glGetUniformLocation(lightingShaderProgram, "shadowMap"), 4);
-	glUniform3fv(glGetUniformLocation(lightingShaderProgram, "viewPos"), 1, &camera_.position[0]);
-	glUniform3fv(glGetUniformLocation(lightingShaderProgram, "lightPos"), 1, &lightPos[0]);
-	glUniformMatrix4fv(glGetUniformLocation(lightingShaderProgram, "lightSpaceMatrix"), 1, GL_FALSE, &lightSpaceMatrix[0][0]);
+	glUniform1i(lightingShaderProgram.uniformLocation(G_POSITION_UNIFORM), 0);
+	glUniform1i(lightingShaderProgram.uniformLocation(G_NORMAL_UNIFORM), 1);
+	glUniform1i(lightingShaderProgram.uniformLocation(G_ALBEDO_SPEC_UNIFORM), 2);
+	glUniform1i(lightingShaderProgram.uniformLocation(G_METALLIC_ROUGHNESS_AMBIENT_OCCLUSION_UNIFORM), 3);
+	glUniform1i(lightingShaderProgram.uniformLocation(SHADOW_MAP_UNIFORM), 4);
 
 	Texture2d::activate(0);
 	positionTexture_.bind();
@@ -1021,26 +2053,26 @@ void OpenGlRenderer::render(const RenderSceneHandle& renderSceneHandle)
 	{
 		//glm::vec4 newPos = model_ * glm::vec4(lightPositions_[i], 1.0);
 
-		glUniform3fv(glGetUniformLocation(lightingShaderProgram, ("lights[" + std::to_string(0) + "].Position").c_str()), 1, &light.position.x);
-		glUniform3fv(glGetUniformLocation(lightingShaderProgram, ("lights[" + std::to_string(0) + "].Color").c_str()), 1, &lightColors_[0].x);
+		glUniform3fv(lightingShaderProgram.uniformLocation(LIGHTS_0_POSITION_UNIFORM), 1, &light.position.x);
+		glUniform3fv(lightingShaderProgram.uniformLocation(LIGHTS_0_COLOR_UNIFORM), 1, &lightColors_[0].x);
 		// update attenuation parameters and calculate radius
 		const float constant = 1.0f; // note that we don't send this to the shader, we assume it is always 1.0 (in our case)
 		//const float linear = 0.7f;
 		//const float quadratic = 1.8f;
 		const float linear = 0.05f;
 		const float quadratic = 0.05f;
-		glUniform1f(glGetUniformLocation(lightingShaderProgram, ("lights[" + std::to_string(0) + "].Linear").c_str()), linear);
-		glUniform1f(glGetUniformLocation(lightingShaderProgram, ("lights[" + std::to_string(0) + "].Quadratic").c_str()), quadratic);
+		glUniform1f(lightingShaderProgram.uniformLocation(LIGHTS_0_LINEAR_UNIFORM), linear);
+		glUniform1f(lightingShaderProgram.uniformLocation(LIGHTS_0_QUADRATIC_UNIFORM), quadratic);
 
         ASSERT_GL_ERROR();
 	}
 
 	//glm::vec4 newPos = model_ * glm::vec4(lightPositions_[i], 1.0);
 
-	glUniform3fv(glGetUniformLocation(lightingShaderProgram, ("directionalLights[" + std::to_string(0) + "].direction").c_str()), 1, &direction.x);
-	glUniform3fv(glGetUniformLocation(lightingShaderProgram, ("directionalLights[" + std::to_string(0) + "].ambient").c_str()), 1, &ambient.x);
-	glUniform3fv(glGetUniformLocation(lightingShaderProgram, ("directionalLights[" + std::to_string(0) + "].diffuse").c_str()), 1, &diffuse.x);
-	glUniform3fv(glGetUniformLocation(lightingShaderProgram, ("directionalLights[" + std::to_string(0) + "].specular").c_str()), 1, &specular.x);
+	glUniform3fv(lightingShaderProgram.uniformLocation(DIRECTIONAL_LIGHTS_0_DIRECTION_UNIFORM), 1, &direction.x);
+	glUniform3fv(lightingShaderProgram.uniformLocation(DIRECTIONAL_LIGHTS_0_AMBIENT_UNIFORM), 1, &ambient.x);
+	glUniform3fv(lightingShaderProgram.uniformLocation(DIRECTIONAL_LIGHTS_0_DIFFUSE_UNIFORM), 1, &diffuse.x);
+	glUniform3fv(lightingShaderProgram.uniformLocation(DIRECTIONAL_LIGHTS_0_SPECULAR_UNIFORM), 1, &specular.x);
 
     ASSERT_GL_ERROR();
 
@@ -1062,12 +2094,6 @@ void OpenGlRenderer::render(const RenderSceneHandle& renderSceneHandle)
 	auto& skyboxShaderProgram = shaderPrograms_[skyboxShaderProgramHandle_];
 	skyboxShaderProgram.use();
 
-	auto projectionMatrixLocation = glGetUniformLocation(skyboxShaderProgram, "projectionMatrix");
-	auto viewMatrixLocation = glGetUniformLocation(skyboxShaderProgram, "viewMatrix");
-
-	ICE_ENGINE_ASSERT(projectionMatrixLocation >= 0);
-	ICE_ENGINE_ASSERT(viewMatrixLocation >= 0);
-
 	ASSERT_GL_ERROR();
 
 	for (auto& s : renderScene.skyboxes)
@@ -1083,11 +2109,6 @@ void OpenGlRenderer::render(const RenderSceneHandle& renderSceneHandle)
 		//glm::mat3 normalMatrix = glm::inverse(glm::transpose(glm::mat3(view_ * newModel)));
 		//glUniformMatrix3fv(normalMatrixLocation, 1, GL_FALSE, &normalMatrix[0][0]);
 
-		// original source: https://learnopengl.com/Advanced-OpenGL/Cubemaps
-		const glm::mat4 newView = glm::mat4(glm::mat3(view_));
-		glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, &projection_[0][0]);
-		glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, &newView[0][0]);
-
 		// if (s.ubo.id > 0)
 		// {
 		// 	//const int bonesLocation = glGetUniformLocation(deferredLightingGeometryPassShaderProgram, "bones");
@@ -1101,10 +2122,15 @@ void OpenGlRenderer::render(const RenderSceneHandle& renderSceneHandle)
 		TextureCubeMap::activate(0);
 		skybox.textureCubeMap.bind();
 
-		glBindVertexArray(s.vao.id);
-		glDrawElements(s.vao.ebo.mode, s.vao.ebo.count, s.vao.ebo.type, 0);
+		auto& meshArena = meshArenas_[s.vao.arena];
+
+		glBindVertexArray(meshArena.id());
+		drawElementsInstanced(meshArena, s.vao, 1);
 		glBindVertexArray(0);
 
+		++renderStatistics_.drawCalls;
+		++renderStatistics_.instances;
+
 		ASSERT_GL_ERROR();
 	}
 
@@ -1133,104 +2159,67 @@ void OpenGlRenderer::render(const RenderSceneHandle& renderSceneHandle)
 	ASSERT_GL_ERROR();
 }
 
-GLuint VBO, VAO;
-size_t lastSize = 0;
 void OpenGlRenderer::renderLine(const glm::vec3& from, const glm::vec3& to, const glm::vec3& color)
 {
-	glDeleteBuffers(1, &VBO);
-	glDeleteVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glGenVertexArrays(1, &VAO);
-
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, 4 * sizeof(glm::vec3), nullptr, GL_DYNAMIC_DRAW);
-
-	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::vec3), &from.x);
-	glBufferSubData(GL_ARRAY_BUFFER, sizeof(glm::vec3), sizeof(glm::vec3), &to.x);
-	glBufferSubData(GL_ARRAY_BUFFER, 2 * sizeof(glm::vec3), sizeof(glm::vec3), &color.x);
-	glBufferSubData(GL_ARRAY_BUFFER, 3 * sizeof(glm::vec3), sizeof(glm::vec3), &color.x);
-
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (GLvoid*)(2 * sizeof(glm::vec3)));
-	glEnableVertexAttribArray(1);
-	glBindVertexArray(0);
-
-	auto& lineShaderProgram = shaderPrograms_[lineShaderProgramHandle_];
-	auto projectionMatrixLocation = glGetUniformLocation(lineShaderProgram, "projectionMatrix");
-	auto viewMatrixLocation = glGetUniformLocation(lineShaderProgram, "viewMatrix");
-
-	lineShaderProgram.use();
-
-	glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, &projection_[0][0]);
-	glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, &view_[0][0]);
-
-	glBindVertexArray(VAO);
-	glDrawArrays(GL_LINES, 0, 2);
-	glBindVertexArray(0);
+	lineBatcher_.line(from, to, color);
 }
 
 void OpenGlRenderer::renderLines(const std::vector<std::tuple<glm::vec3, glm::vec3, glm::vec3>>& lineData)
 {
-	std::vector<std::tuple<glm::vec3, glm::vec3, glm::vec3, glm::vec3>> lineData2;
-
 	for (const auto& line : lineData)
 	{
-		lineData2.push_back( std::tuple<glm::vec3, glm::vec3, glm::vec3, glm::vec3>(std::get<0>(line), std::get<1>(line), std::get<2>(line), std::get<2>(line)) );
+		lineBatcher_.line(std::get<0>(line), std::get<1>(line), std::get<2>(line));
 	}
+}
 
-	auto size = lineData2.size() * (4 * sizeof(glm::vec3));
-	if (!VBO || size > lastSize)
-    {
-        glDeleteBuffers(1, &VBO);
-        glDeleteVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenVertexArrays(1, &VAO);
-    }
-
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-    if (size > lastSize)
-    {
-        glBufferData(GL_ARRAY_BUFFER, size, &lineData2[0], GL_DYNAMIC_DRAW);
+void OpenGlRenderer::renderLines(const LineVertex* vertices, const size_t vertexCount, const LineStyle& lineStyle)
+{
+	lineBatcher_.lines(vertices, vertexCount, lineStyle, streamingBuffer_);
+}
 
-        lastSize = size;
-    }
-    else
-    {
-        glBufferSubData(GL_ARRAY_BUFFER, 0, lineData2.size() * (4 * sizeof(glm::vec3)), &lineData2[0]);
-    }
+LineVertex* OpenGlRenderer::reserveLines(const size_t vertexCount, const LineStyle& lineStyle)
+{
+	return lineBatcher_.reserveLines(vertexCount, lineStyle, streamingBuffer_);
+}
 
-//	glBindVertexArray(VAO);
-//	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-//	glBufferData(GL_ARRAY_BUFFER, size, &lineData2[0], GL_DYNAMIC_DRAW);
+void OpenGlRenderer::commitLines(const size_t vertexCount)
+{
+	lineBatcher_.commitLines(vertexCount, streamingBuffer_);
+}
 
-//	glBufferSubData(GL_ARRAY_BUFFER, 0, lineData2.size() * 4 * sizeof(glm::vec3), &lineData2[0]);
+void OpenGlRenderer::renderBox(const glm::vec3& minimum, const glm::vec3& maximum, const glm::vec3& color)
+{
+	lineBatcher_.box(minimum, maximum, color);
+}
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (GLvoid*)(2 * sizeof(glm::vec3)));
-	glEnableVertexAttribArray(1);
-//	glBindVertexArray(0);
+void OpenGlRenderer::renderSphere(const glm::vec3& center, const float32 radius, const glm::vec3& color)
+{
+	lineBatcher_.sphere(center, radius, color);
+}
 
-	auto& lineShaderProgram = shaderPrograms_[lineShaderProgramHandle_];
-	auto projectionMatrixLocation = glGetUniformLocation(lineShaderProgram, "projectionMatrix");
-	auto viewMatrixLocation = glGetUniformLocation(lineShaderProgram, "viewMatrix");
+void OpenGlRenderer::renderFrustum(const glm::mat4& viewProjection, const glm::vec3& color)
+{
+	lineBatcher_.frustum(viewProjection, color);
+}
 
-	lineShaderProgram.use();
+void OpenGlRenderer::endRender()
+{
+	// All debug lines of the frame go out in a single draw
+	if (!lineBatcher_.empty())
+	{
+		auto& lineShaderProgram = shaderPrograms_[lineShaderProgramHandle_];
+		lineShaderProgram.use();
 
-	glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, &projection_[0][0]);
-	glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, &view_[0][0]);
+		renderStatistics_.drawCalls += lineBatcher_.flush(streamingBuffer_);
+	}
 
-//	glBindVertexArray(VAO);
-	glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(4 * lineData2.size()));
-	glBindVertexArray(0);
-}
+	streamingBuffer_.endFrame();
+
+	if (bonePaletteBuffer_.valid())
+	{
+		bonePaletteBuffer_.endFrame();
+	}
 
-void OpenGlRenderer::endRender()
-{
 	SDL_GL_SwapWindow(sdlWindow_);
 }
 
@@ -1296,12 +2285,28 @@ void OpenGlRenderer::destroy(const RenderSceneHandle& renderSceneHandle, const P
 	renderScene.pointLights.destroy(pointLightHandle);
 }
 
+uint32 OpenGlRenderer::meshArena(const VertexFormat vertexFormat, const bool skinned)
+{
+	const uint32 index = static_cast<uint32>(vertexFormat) * 2 + (skinned ? 1 : 0);
+	auto& arena = meshArenas_[index];
+
+	if (!arena.valid())
+	{
+		LOG_DEBUG(logger_, "Creating mesh arena for vertex format %s (skinned = %s).", static_cast<uint32>(vertexFormat), skinned);
+
+		arena.generate(vertexFormat, skinned, meshArenaVertexCapacity_, meshArenaIndexCapacity_);
+	}
+
+	return index;
+}
+
 MeshHandle OpenGlRenderer::createStaticMesh(
 	const std::vector<glm::vec3>& vertices,
 	const std::vector<uint32>& indices,
 	const std::vector<glm::vec4>& colors,
 	const std::vector<glm::vec3>& normals,
-	const std::vector<glm::vec2>& textureCoordinates
+	const std::vector<glm::vec2>& textureCoordinates,
+	const VertexFormat vertexFormat
 )
 {
     LOG_DEBUG(logger_, "Creating static mesh.");
@@ -1309,54 +2314,108 @@ MeshHandle OpenGlRenderer::createStaticMesh(
 	auto handle = meshes_.create();
 	auto& vao = meshes_[handle];
 
-	glGenVertexArrays(1, &vao.id);
-	glGenBuffers(1, &vao.vbo[0].id);
-	glGenBuffers(1, &vao.ebo.id);
-
-	auto size = vertices.size() * sizeof(glm::vec3);
-	size += colors.size() * sizeof(glm::vec4);
-	size += normals.size() * sizeof(glm::vec3);
-	size += textureCoordinates.size() * sizeof(glm::vec2);
-
-	glBindVertexArray(vao.id);
-	glBindBuffer(GL_ARRAY_BUFFER, vao.vbo[0].id);
-	glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STATIC_DRAW);
+	vao.vertexFormat = vertexFormat;
+	vao.boundingSphere = boundingSphere(vertices);
 
-    GLintptr offset = 0;
-	glBufferSubData(GL_ARRAY_BUFFER, offset, vertices.size() * sizeof(glm::vec3), &vertices[0]);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-	glEnableVertexAttribArray(0);
+	// Indices are relative to the base vertex, so 16 bits are enough whenever the mesh itself is small enough
+	const bool shortIndices = (vertices.size() <= std::numeric_limits<uint16>::max() + static_cast<size_t>(1));
 
-	offset += static_cast<GLintptr>(vertices.size() * sizeof(glm::vec3));
-	glBufferSubData(GL_ARRAY_BUFFER, offset, colors.size() * sizeof(glm::vec4), &colors[0]);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (GLvoid*)(offset));
-	glEnableVertexAttribArray(1);
+	vao.arena = meshArena(vertexFormat, false);
+	auto& arena = meshArenas_[vao.arena];
 
-	offset += static_cast<GLintptr>(colors.size() * sizeof(glm::vec4));
-	glBufferSubData(GL_ARRAY_BUFFER, offset, normals.size() * sizeof(glm::vec3), &normals[0]);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (GLvoid*)(offset));
-	glEnableVertexAttribArray(2);
+	vao.allocation = arena.allocate(
+		static_cast<uint32>(vertices.size()),
+		static_cast<uint32>(indices.size()),
+		shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT
+	);
 
-	offset += static_cast<GLintptr>(normals.size() * sizeof(glm::vec3));
-	glBufferSubData(GL_ARRAY_BUFFER, offset, textureCoordinates.size() * sizeof(glm::vec2), &textureCoordinates[0]);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 0, (GLvoid*)(offset));
-	glEnableVertexAttribArray(3);
+	if (vertexFormat == VertexFormat::COMPACT)
+	{
+		const auto compact = compactVertices(vertices, colors, normals, textureCoordinates);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vao.ebo.id);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32), &indices[0], GL_STATIC_DRAW);
+		vao.positionScale = compact.positionScale;
+		vao.positionBias = compact.positionBias;
 
-	glBindVertexArray(0);
+		arena.vertices(vao.allocation, compact.vertices.data());
+	}
+	else
+	{
+		arena.vertices(vao.allocation, floatVertices(vertices, colors, normals, textureCoordinates).data());
+	}
 
-	vao.ebo.count = static_cast<GLsizei>(indices.size());
-	vao.ebo.mode = GL_TRIANGLES;
-	vao.ebo.type =  GL_UNSIGNED_INT;
+	if (shortIndices)
+	{
+		const std::vector<uint16> indices16(indices.begin(), indices.end());
+		arena.indices(vao.allocation, indices16.data());
+	}
+	else
+	{
+		arena.indices(vao.allocation, indices.data());
+	}
 
 	return handle;
 }
 
 MeshHandle OpenGlRenderer::createStaticMesh(const IMesh& mesh)
 {
-	return createStaticMesh(mesh.vertices(), mesh.indices(), mesh.colors(), mesh.normals(), mesh.textureCoordinates());
+	if (optimizeMeshes_)
+	{
+		auto vertices = mesh.vertices();
+		auto indices = mesh.indices();
+		auto colors = mesh.colors();
+		auto normals = mesh.normals();
+		auto textureCoordinates = mesh.textureCoordinates();
+		std::vector<uint32> vertexRemap;
+
+		optimizeStaticMesh(vertices, indices, colors, normals, textureCoordinates, vertexRemap);
+
+		const auto handle = createStaticMesh(
+			vertices,
+			indices,
+			colors,
+			normals,
+			textureCoordinates,
+			compactVertexFormat_ ? VertexFormat::COMPACT : VertexFormat::FLOAT
+		);
+
+		meshVertexRemaps_[handle.index()] = std::move(vertexRemap);
+
+		return handle;
+	}
+
+	return createStaticMesh(
+		mesh.vertices(),
+		mesh.indices(),
+		mesh.colors(),
+		mesh.normals(),
+		mesh.textureCoordinates(),
+		compactVertexFormat_ ? VertexFormat::COMPACT : VertexFormat::FLOAT
+	);
+}
+
+void OpenGlRenderer::optimizeStaticMesh(
+	std::vector<glm::vec3>& vertices,
+	std::vector<uint32>& indices,
+	std::vector<glm::vec4>& colors,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& textureCoordinates,
+	std::vector<uint32>& vertexRemap
+)
+{
+	auto optimization = optimizeMesh(vertices, indices, colors, normals, textureCoordinates, weldVertices_);
+
+	LOG_DEBUG(
+		logger_,
+		"Optimized mesh: vertices %s -> %s, ACMR %s -> %s, ATVR %s -> %s.",
+		optimization.originalVertexCount,
+		optimization.vertexCount,
+		optimization.before.acmr,
+		optimization.after.acmr,
+		optimization.before.atvr,
+		optimization.after.atvr
+	);
+
+	vertexRemap = std::move(optimization.vertexRemap);
 }
 
 MeshHandle OpenGlRenderer::createDynamicMesh(const IMesh& mesh)
@@ -1430,28 +2489,76 @@ SkeletonHandle OpenGlRenderer::createSkeleton(const MeshHandle& meshHandle, cons
 
 	auto& vao = meshes_[meshHandle];
 
-	if (vao.vbo[1].id != 0) throw InvalidArgumentException("Skeleton already exists");
+	if (meshArenas_[vao.arena].skinned()) throw InvalidArgumentException("Skeleton already exists");
 
-	glBindVertexArray(vao.id);
-	glGenBuffers(1, &vao.vbo[1].id);
+	// The mesh was optimized, so bring the per vertex bone data into the optimized vertex order
+	std::vector<glm::ivec4> remappedBoneIds;
+	std::vector<glm::vec4> remappedBoneWeights;
+
+	const auto remap = meshVertexRemaps_.find(meshHandle.index());
+	if (remap != meshVertexRemaps_.end())
+	{
+		if (skeleton.boneIds().size() != remap->second.size() || skeleton.boneWeights().size() != remap->second.size())
+		{
+			throw InvalidArgumentException(
+				"Skeleton has " + std::to_string(skeleton.boneIds().size()) + " bone ids and " + std::to_string(skeleton.boneWeights().size())
+				+ " bone weights, but its optimized mesh was created with " + std::to_string(remap->second.size()) + " vertices."
+			);
+		}
 
-	auto size = skeleton.boneIds().size() * sizeof(glm::ivec4);
-	size += skeleton.boneWeights().size() * sizeof(glm::vec4);
+		const auto vertexCount = static_cast<size_t>(remap->second.size() - std::count(remap->second.begin(), remap->second.end(), REMOVED_VERTEX));
 
-	glBindBuffer(GL_ARRAY_BUFFER, vao.vbo[1].id);
-	glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STATIC_DRAW);
+		// Welded vertices share one set of bone data, which is only correct if they had the same to begin with
+		std::vector<uint32> firstVertices(vertexCount, REMOVED_VERTEX);
+		for (size_t i = 0; i < remap->second.size(); ++i)
+		{
+			const uint32 vertex = remap->second[i];
+
+			if (vertex == REMOVED_VERTEX) continue;
+
+			if (firstVertices[vertex] == REMOVED_VERTEX)
+			{
+				firstVertices[vertex] = static_cast<uint32>(i);
+			}
+			else if (skeleton.boneIds()[firstVertices[vertex]] != skeleton.boneIds()[i] || skeleton.boneWeights()[firstVertices[vertex]] != skeleton.boneWeights()[i])
+			{
+				throw InvalidArgumentException("Skeleton has different bone data for vertices that were welded, disable graphics.optimizeMeshes.weldVertices for skinned meshes.");
+			}
+		}
 
-    GLintptr offset = 0;
-	glBufferSubData(GL_ARRAY_BUFFER, offset, skeleton.boneIds().size() * sizeof(glm::ivec4), &skeleton.boneIds()[0]);
-	glVertexAttribIPointer(4, 4, GL_INT, 0, 0);
-	glEnableVertexAttribArray(4);
+		remappedBoneIds = skeleton.boneIds();
+		remappedBoneWeights = skeleton.boneWeights();
 
-	offset += static_cast<GLintptr>(skeleton.boneIds().size() * sizeof(glm::vec4));
-	glBufferSubData(GL_ARRAY_BUFFER, offset, skeleton.boneWeights().size() * sizeof(glm::vec4), &skeleton.boneWeights()[0]);
-	glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, 0, (GLvoid*)(offset));
-	glEnableVertexAttribArray(5);
+		remapVertices(remappedBoneIds, remap->second, vertexCount);
+		remapVertices(remappedBoneWeights, remap->second, vertexCount);
 
-	glBindVertexArray(0);
+		meshVertexRemaps_.erase(remap);
+	}
+
+	const auto& boneIds = (remappedBoneIds.empty() ? skeleton.boneIds() : remappedBoneIds);
+	const auto& boneWeights = (remappedBoneWeights.empty() ? skeleton.boneWeights() : remappedBoneWeights);
+
+	// Skinned meshes live in their own arena, whose vertex array also sources the bone ids and weights
+	auto& source = meshArenas_[vao.arena];
+	const auto& allocation = source.allocation(vao.allocation);
+
+	const uint32 arena = meshArena(vao.vertexFormat, true);
+	auto& destination = meshArenas_[arena];
+	const uint32 skinnedAllocation = destination.allocate(allocation.vertexCount, allocation.indexCount, allocation.indexType);
+
+	std::vector<SkinVertex> skinVertices(allocation.vertexCount, SkinVertex{glm::ivec4(0), glm::vec4(0.0f)});
+	for (size_t i = 0; i < skinVertices.size(); ++i)
+	{
+		if (i < boneIds.size()) skinVertices[i].boneIds = boneIds[i];
+		if (i < boneWeights.size()) skinVertices[i].boneWeights = boneWeights[i];
+	}
+
+	source.copy(vao.allocation, destination, skinnedAllocation);
+	destination.skinVertices(skinnedAllocation, skinVertices.data());
+	source.free(vao.allocation);
+
+	vao.arena = arena;
+	vao.allocation = skinnedAllocation;
 
 //	return handle;
 
@@ -1483,18 +2590,13 @@ BonesHandle OpenGlRenderer::createBones(const uint32 maxNumberOfBones)
 
     LOG_DEBUG(logger_, "Creating bones with maxNumberOfBones = %s.", maxNumberOfBones);
 
-	if (maxNumberOfBones > 100) throw InvalidArgumentException("cannot have more than 100 bones");
-
 	auto handle = bones_.create();
-	auto& ubo = bones_[handle];
-
-	glGenBuffers(1, &ubo.id);
+	auto& bonePalette = bones_[handle];
 
-	auto size = maxNumberOfBones * sizeof(glm::mat4);
-	static auto transformations = std::vector<glm::mat4>(maxNumberOfBones, glm::mat4(1.0f));
+	bonePalette.transformations = std::vector<glm::mat4>(maxNumberOfBones, glm::mat4(1.0f));
 
-	glBindBuffer(GL_UNIFORM_BUFFER, ubo.id);
-	glBufferData(GL_UNIFORM_BUFFER, size, &transformations[0], GL_STREAM_DRAW);
+	// Due until the bones are first drawn
+	bonePalette.animationLodFrame = animationLodFrame_;
 
 	return handle;
 }
@@ -1532,9 +2634,8 @@ void OpenGlRenderer::attach(const RenderSceneHandle& renderSceneHandle, const Re
     ice_engine::detail::checkHandleValidity(renderScene.renderables, renderableHandle);
 
 	auto& renderable = renderScene.renderables[renderableHandle];
-	auto& bones = bones_[bonesHandle];
 
-	renderable.ubo = bones;
+	renderable.bonesHandle = bonesHandle;
 	renderable.hasBones = true;
 }
 
@@ -1551,7 +2652,7 @@ void OpenGlRenderer::detach(const RenderSceneHandle& renderSceneHandle, const Re
 
 	auto& renderable = renderScene.renderables[renderableHandle];
 
-	renderable.ubo.id = 0;
+	renderable.bonesHandle = BonesHandle();
 	renderable.hasBones = false;
 	renderable.hasBoneAttachment = false;
 }
@@ -1586,9 +2687,8 @@ void OpenGlRenderer::attachBoneAttachment(
     ice_engine::detail::checkHandleValidity(renderScene.renderables, renderableHandle);
 
 	auto& renderable = renderScene.renderables[renderableHandle];
-	auto& bones = bones_[bonesHandle];
 
-	renderable.ubo = bones;
+	renderable.bonesHandle = bonesHandle;
 
 	renderable.boneIds = boneIds;
 	renderable.boneWeights = boneWeights;
@@ -1607,7 +2707,7 @@ void OpenGlRenderer::detachBoneAttachment(const RenderSceneHandle& renderSceneHa
 
 	auto& renderable = renderScene.renderables[renderableHandle];
 
-	if (!renderable.hasBones) renderable.ubo.id = 0;
+	if (!renderable.hasBones) renderable.bonesHandle = BonesHandle();
 
 	renderable.hasBoneAttachment = false;
 }
@@ -1621,7 +2721,7 @@ TextureHandle OpenGlRenderer::createTexture2d(const ITexture& texture)
 
 	auto format = getOpenGlImageFormat(texture.image()->format());
 
-	texture2d.generate(format, texture.image()->width(), texture.image()->height(), format, GL_UNSIGNED_BYTE, &texture.image()->data()[0], true);
+	generateTexture2d(texture2d, format, texture.image()->width(), texture.image()->height(), &texture.image()->data()[0], texture.image()->data().size(), true, TEXTURE_PLACEHOLDER);
 	//glGenTextures(1, &texture.id);
 	//glBindTexture(GL_TEXTURE_2D, texture.id);
 	//glTexImage2D(GL_TEXTURE_2D, 0, format, image->width(), image->height(), 0, format, GL_UNSIGNED_BYTE, &image->data()[0]);
@@ -1639,9 +2739,9 @@ MaterialHandle OpenGlRenderer::createMaterial(const IPbrMaterial& pbrMaterial)
 	auto& material = materials_[handle];
 
 	material.albedo = Texture2d();
-	material.albedo.generate(GL_RGBA, pbrMaterial.albedo()->width(), pbrMaterial.albedo()->height(), GL_RGBA, GL_UNSIGNED_BYTE, &pbrMaterial.albedo()->data()[0], true);
+	generateTexture2d(material.albedo, GL_RGBA, pbrMaterial.albedo()->width(), pbrMaterial.albedo()->height(), &pbrMaterial.albedo()->data()[0], pbrMaterial.albedo()->data().size(), true, TEXTURE_PLACEHOLDER);
 	material.normal = Texture2d();
-	material.normal.generate(GL_RGBA, pbrMaterial.normal()->width(), pbrMaterial.normal()->height(), GL_RGBA, GL_UNSIGNED_BYTE, &pbrMaterial.normal()->data()[0], true);
+	generateTexture2d(material.normal, GL_RGBA, pbrMaterial.normal()->width(), pbrMaterial.normal()->height(), &pbrMaterial.normal()->data()[0], pbrMaterial.normal()->data().size(), false, NORMAL_TEXTURE_PLACEHOLDER);
 
 	std::vector<byte> metalnessRoughnessAmbientOcclusionData;
 	metalnessRoughnessAmbientOcclusionData.resize(pbrMaterial.albedo()->width()*pbrMaterial.albedo()->height()*4);
@@ -1650,20 +2750,130 @@ MaterialHandle OpenGlRenderer::createMaterial(const IPbrMaterial& pbrMaterial)
 	const auto roughness = pbrMaterial.roughness();
 	const auto ambientOcclusion = pbrMaterial.ambientOcclusion();
 
-	for (int j=0; j < metalnessRoughnessAmbientOcclusionData.size(); j+=4)
-	{
-		metalnessRoughnessAmbientOcclusionData[j] = (metalness ? (metalness->data()[j] + metalness->data()[j+1] + metalness->data()[j+2]) / 3 : 127);
-		metalnessRoughnessAmbientOcclusionData[j+1] = (roughness ? (roughness->data()[j] + roughness->data()[j+1] + roughness->data()[j+2]) / 3 : 127);
-		metalnessRoughnessAmbientOcclusionData[j+2] = (ambientOcclusion ? (ambientOcclusion->data()[j] + ambientOcclusion->data()[j+1] + ambientOcclusion->data()[j+2]) / 3 : 127);
-		metalnessRoughnessAmbientOcclusionData[j+3] = 0;
-	}
+	packMetalnessRoughnessAmbientOcclusion(
+		(metalness ? &metalness->data()[0] : nullptr),
+		(roughness ? &roughness->data()[0] : nullptr),
+		(ambientOcclusion ? &ambientOcclusion->data()[0] : nullptr),
+		pbrMaterial.albedo()->width(),
+		pbrMaterial.albedo()->height(),
+		&metalnessRoughnessAmbientOcclusionData[0],
+		workerPool_
+	);
 
 	material.metallicRoughnessAmbientOcclusion = Texture2d();
-	material.metallicRoughnessAmbientOcclusion.generate(GL_RGBA, pbrMaterial.albedo()->width(), pbrMaterial.albedo()->height(), GL_RGBA, GL_UNSIGNED_BYTE, &metalnessRoughnessAmbientOcclusionData[0], true);
+	generateTexture2d(
+		material.metallicRoughnessAmbientOcclusion,
+		GL_RGBA,
+		pbrMaterial.albedo()->width(),
+		pbrMaterial.albedo()->height(),
+		&metalnessRoughnessAmbientOcclusionData[0],
+		metalnessRoughnessAmbientOcclusionData.size(),
+		false,
+		METALNESS_ROUGHNESS_AMBIENT_OCCLUSION_TEXTURE_PLACEHOLDER
+	);
 
 	return handle;
 }
 
+void OpenGlRenderer::generateTexture2d(
+	Texture2d& texture,
+	const GLint format,
+	const GLsizei width,
+	const GLsizei height,
+	const byte* data,
+	const size_t size,
+	const bool gammaCorrect,
+	const glm::vec4& placeholder
+)
+{
+	const uint32 channels = (format == GL_RGB ? 3 : 4);
+	const byte* levelData = data;
+
+	if (size != mipChainLayout(width, height, channels, mipLevels_))
+	{
+		if (cpuMipmaps_)
+		{
+			generateMipChain(data, width, height, channels, gammaCorrect, mipChain_, mipLevels_, workerPool_);
+			levelData = &mipChain_[0];
+		}
+		else
+		{
+			mipLevels_.resize(1);
+		}
+	}
+
+	if (asynchronousTextureUpload_)
+	{
+		textureUploadQueue_.enqueue(texture, format, format, GL_UNSIGNED_BYTE, levelData, mipLevels_, true, placeholder);
+	}
+	else if (mipLevels_.size() == 1)
+	{
+		texture.generate(format, width, height, format, GL_UNSIGNED_BYTE, levelData, true);
+	}
+	else
+	{
+		texture.generate(format, width, height, format, GL_UNSIGNED_BYTE, levelData, false);
+		texture.bind();
+
+		// Levels are tightly packed, rows of the small ones are not 4 byte aligned
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+		for (size_t i = 1; i < mipLevels_.size(); ++i)
+		{
+			const auto& level = mipLevels_[i];
+
+			Texture2d::texImage2D(static_cast<GLint>(i), format, level.width, level.height, format, GL_UNSIGNED_BYTE, levelData + level.offset);
+		}
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+}
+
+void OpenGlRenderer::allocateTexture2dArrayMipLevels(const GLsizei width, const GLsizei height, const GLsizei depth)
+{
+	if (!cpuMipmaps_) return;
+
+	mipChainLayout(width, height, 4, mipLevels_);
+
+	for (size_t i = 1; i < mipLevels_.size(); ++i)
+	{
+		Texture2dArray::texImage3D(static_cast<GLint>(i), GL_RGBA, mipLevels_[i].width, mipLevels_[i].height, depth, GL_RGBA, GL_UNSIGNED_BYTE);
+	}
+}
+
+void OpenGlRenderer::uploadTexture2dArrayLayer(const GLsizei width, const GLsizei height, const GLsizei layer, const byte* data, const size_t size, const bool gammaCorrect)
+{
+	if (!cpuMipmaps_)
+	{
+		Texture2dArray::texSubImage3D(width, height, layer, GL_RGBA, GL_UNSIGNED_BYTE, data);
+		return;
+	}
+
+	const byte* levelData = data;
+
+	if (size != mipChainLayout(width, height, 4, mipLevels_))
+	{
+		generateMipChain(data, width, height, 4, gammaCorrect, mipChain_, mipLevels_, workerPool_);
+		levelData = &mipChain_[0];
+	}
+
+	for (size_t i = 0; i < mipLevels_.size(); ++i)
+	{
+		const auto& level = mipLevels_[i];
+
+		Texture2dArray::texSubImage3D(static_cast<GLint>(i), level.width, level.height, layer, GL_RGBA, GL_UNSIGNED_BYTE, levelData + level.offset);
+	}
+}
+
+void OpenGlRenderer::finishTexture2dArrayMipLevels()
+{
+	if (!cpuMipmaps_)
+	{
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	}
+}
+
 TerrainHandle OpenGlRenderer::createStaticTerrain(
         const IHeightMap& heightMap,
         const ISplatMap& splatMap,
@@ -1680,13 +2890,18 @@ TerrainHandle OpenGlRenderer::createStaticTerrain(
 
 	terrain.width = heightMap.image()->width();
 	terrain.height = heightMap.image()->height();
+	terrain.heightScale = TERRAIN_MAX_HEIGHT;
 
 	{
 //		terrain.textureHandle = createTexture2d(heightMap.image());
 		terrain.textureHandle = texture2ds_.create();
 		auto& texture = texture2ds_[terrain.textureHandle];
 
-		texture.generate(GL_RGBA,  heightMap.image()->width(),  heightMap.image()->height(), GL_RGBA, GL_UNSIGNED_BYTE, &heightMap.image()->data()[0], true);
+		// Height and normal in one texel, so the shaders fetch once per vertex
+		std::vector<uint16> heightNormals;
+		packHeightNormals(&heightMap.image()->data()[0], terrain.width, terrain.height, terrain.heightScale, heightNormals);
+
+		texture.generate(GL_RGBA16, terrain.width, terrain.height, GL_RGBA, GL_UNSIGNED_SHORT, &heightNormals[0], true);
 	}
 
 	//terrain.terrainMapTextureHandle = createTexture2d(*splatMap.terrainMap());
@@ -1698,23 +2913,101 @@ TerrainHandle OpenGlRenderer::createStaticTerrain(
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
+	createSplatMapTextures(terrain, splatMap);
+
+	// Only the tessellation evaluation shader displaces the terrain
+	if (terrainTessellation_ && displacementMap.image() != nullptr)
+	{
+		terrain.displacementMapTextureHandle = texture2ds_.create();
+		auto& displacementMapTexture = texture2ds_[terrain.displacementMapTextureHandle];
+
+		displacementMapTexture.generate(GL_RGBA, displacementMap.image()->width(), displacementMap.image()->height(), GL_RGBA, GL_UNSIGNED_BYTE, &displacementMap.image()->data()[0], true);
+
+		terrain.displacementScale = TERRAIN_DISPLACEMENT_SCALE;
+	}
+
+	//terrain.splatMapTextureHandles[0] = createTexture2d(*splatMap.materialMap()[0]->albedo());
+	//terrain.splatMapTextureHandles[1] = createTexture2d(*splatMap.materialMap()[1]->albedo());
+	//terrain.splatMapTextureHandles[2] = createTexture2d(*splatMap.materialMap()[2]->albedo());
+
+	// Heights are only applied in the vertex shader, so the bounds cover the full height range
+	const float32 halfWidth = static_cast<float32>(terrain.width - 1) * 0.5f;
+	const float32 halfHeight = static_cast<float32>(terrain.height - 1) * 0.5f;
+	const float32 halfMaxHeight = (terrain.heightScale + terrain.displacementScale) * 0.5f;
+
+	auto& bounds = terrain.vao.boundingSphere;
+	bounds.center = glm::vec3(halfWidth, 0.0f, halfHeight);
+	bounds.radius = glm::length(glm::vec3(halfWidth, halfMaxHeight, halfHeight));
+
+	terrain.quadtree = TerrainQuadtree(terrain.width, terrain.height, terrainChunkResolution_, terrainLodCount_, terrainDetailDistance_, -halfMaxHeight, halfMaxHeight);
+
+	return handle;
+}
+
+TerrainHandle OpenGlRenderer::createStreamedTerrain(const std::string& filename, const ISplatMap& splatMap)
+{
+	LOG_DEBUG(logger_, "Creating streamed terrain from '%s'.", filename);
+
+	if (!fileSystem_->exists(filename)) throw FileNotFoundException("Terrain tile file '" + filename + "' does not exist.");
+
+	auto handle = terrains_.create();
+	auto& terrain = terrains_[handle];
+
+	try
+	{
+		terrain.streamed = std::make_unique<StreamedTerrain>(filename, terrainStreamingSlotCount_);
+	}
+	catch (const std::runtime_error& e)
+	{
+		terrains_.destroy(handle);
+
+		throw InvalidArgumentException(e.what());
+	}
+
+	terrain.width = terrain.streamed->width();
+	terrain.height = terrain.streamed->height();
+	terrain.heightScale = TERRAIN_MAX_HEIGHT;
+
+	LOG_DEBUG(logger_, "Streamed terrain is %sx%s samples in tiles of %s.", terrain.width, terrain.height, terrain.streamed->tileSize());
+
+	createSplatMapTextures(terrain, splatMap);
+
+	const float32 halfWidth = static_cast<float32>(terrain.width - 1) * 0.5f;
+	const float32 halfHeight = static_cast<float32>(terrain.height - 1) * 0.5f;
+	const float32 halfMaxHeight = terrain.heightScale * 0.5f;
+
+	auto& bounds = terrain.vao.boundingSphere;
+	bounds.center = glm::vec3(halfWidth, 0.0f, halfHeight);
+	bounds.radius = glm::length(glm::vec3(halfWidth, halfMaxHeight, halfHeight));
+
+	terrain.quadtree = TerrainQuadtree(terrain.width, terrain.height, terrainChunkResolution_, terrainLodCount_, terrainDetailDistance_, -halfMaxHeight, halfMaxHeight);
+
+	return handle;
+}
+
+void OpenGlRenderer::createSplatMapTextures(Terrain& terrain, const ISplatMap& splatMap)
+{
 	terrain.splatMapTexture2dArrays[0] = Texture2dArray();
 	terrain.splatMapTexture2dArrays[0].generate(GL_RGBA, splatMap.materialMap()[0]->albedo()->width(), splatMap.materialMap()[0]->albedo()->height(), 256, GL_RGBA, GL_UNSIGNED_BYTE);
 	terrain.splatMapTexture2dArrays[0].bind();
+	allocateTexture2dArrayMipLevels(splatMap.materialMap()[0]->albedo()->width(), splatMap.materialMap()[0]->albedo()->height(), 256);
 	for (int i=0; i < splatMap.materialMap().size(); ++i)
 	{
-		terrain.splatMapTexture2dArrays[0].texSubImage3D(splatMap.materialMap()[i]->albedo()->width(), splatMap.materialMap()[i]->albedo()->height(), i, GL_RGBA, GL_UNSIGNED_BYTE, &splatMap.materialMap()[i]->albedo()->data()[0]);
+		const auto albedo = splatMap.materialMap()[i]->albedo();
+		uploadTexture2dArrayLayer(albedo->width(), albedo->height(), i, &albedo->data()[0], albedo->data().size(), true);
 	}
-	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	finishTexture2dArrayMipLevels();
 
 	terrain.splatMapTexture2dArrays[1] = Texture2dArray();
 	terrain.splatMapTexture2dArrays[1].generate(GL_RGBA, splatMap.materialMap()[0]->normal()->width(), splatMap.materialMap()[0]->normal()->height(), 256, GL_RGBA, GL_UNSIGNED_BYTE);
 	terrain.splatMapTexture2dArrays[1].bind();
+	allocateTexture2dArrayMipLevels(splatMap.materialMap()[0]->normal()->width(), splatMap.materialMap()[0]->normal()->height(), 256);
 	for (int i=0; i < splatMap.materialMap().size(); ++i)
 	{
-		terrain.splatMapTexture2dArrays[1].texSubImage3D(splatMap.materialMap()[i]->normal()->width(), splatMap.materialMap()[i]->normal()->height(), i, GL_RGBA, GL_UNSIGNED_BYTE, &splatMap.materialMap()[i]->normal()->data()[0]);
+		const auto normal = splatMap.materialMap()[i]->normal();
+		uploadTexture2dArrayLayer(normal->width(), normal->height(), i, &normal->data()[0], normal->data().size(), false);
 	}
-	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	finishTexture2dArrayMipLevels();
 
 	const uint32 width = splatMap.materialMap()[0]->albedo()->width();
 	const uint32 height = splatMap.materialMap()[0]->albedo()->height();
@@ -1725,36 +3018,28 @@ TerrainHandle OpenGlRenderer::createStaticTerrain(
 	terrain.splatMapTexture2dArrays[2] = Texture2dArray();
 	terrain.splatMapTexture2dArrays[2].generate(GL_RGBA, width, height, 256, GL_RGBA, GL_UNSIGNED_BYTE);
 	terrain.splatMapTexture2dArrays[2].bind();
+	allocateTexture2dArrayMipLevels(width, height, 256);
 	for (int i=0; i < splatMap.materialMap().size(); ++i)
 	{
 		const auto metalness = splatMap.materialMap()[i]->metalness();
 		const auto roughness = splatMap.materialMap()[i]->roughness();
 		const auto ambientOcclusion = splatMap.materialMap()[i]->ambientOcclusion();
 
-		for (int j=0; j < metalnessRoughnessAmbientOcclusionData.size(); j+=4)
-		{
-			metalnessRoughnessAmbientOcclusionData[j] = (metalness ? (metalness->data()[j] + metalness->data()[j+1] + metalness->data()[j+2]) / 3 : 127);
-			metalnessRoughnessAmbientOcclusionData[j+1] = (roughness ? (roughness->data()[j] + roughness->data()[j+1] + roughness->data()[j+2]) / 3 : 127);
-			metalnessRoughnessAmbientOcclusionData[j+2] = (ambientOcclusion ? (ambientOcclusion->data()[j] + ambientOcclusion->data()[j+1] + ambientOcclusion->data()[j+2]) / 3 : 127);
-			metalnessRoughnessAmbientOcclusionData[j+3] = 0;
-		}
-		terrain.splatMapTexture2dArrays[2].texSubImage3D(width, height, i, GL_RGBA, GL_UNSIGNED_BYTE, &metalnessRoughnessAmbientOcclusionData[0]);
+		packMetalnessRoughnessAmbientOcclusion(
+			(metalness ? &metalness->data()[0] : nullptr),
+			(roughness ? &roughness->data()[0] : nullptr),
+			(ambientOcclusion ? &ambientOcclusion->data()[0] : nullptr),
+			width,
+			height,
+			&metalnessRoughnessAmbientOcclusionData[0],
+			workerPool_
+		);
+
+		uploadTexture2dArrayLayer(width, height, i, &metalnessRoughnessAmbientOcclusionData[0], metalnessRoughnessAmbientOcclusionData.size(), false);
 	}
-	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
-
-	//terrain.splatMapTextureHandles[0] = createTexture2d(*splatMap.materialMap()[0]->albedo());
-	//terrain.splatMapTextureHandles[1] = createTexture2d(*splatMap.materialMap()[1]->albedo());
-	//terrain.splatMapTextureHandles[2] = createTexture2d(*splatMap.materialMap()[2]->albedo());
-
-	std::vector<glm::vec3> vertices;
-	std::vector<uint32> indices;
-	std::tie(vertices, indices) = detail::generateGrid(terrain.width - 1, terrain.height - 1);
-
-	auto meshHandle = createStaticMesh(vertices, indices, {}, {}, {});
-	terrain.vao = meshes_[meshHandle];
-
-	return handle;
+	finishTexture2dArrayMipLevels();
 }
+
 void OpenGlRenderer::destroy(const TerrainHandle& terrainHandle)
 {
     LOG_DEBUG(logger_, "Destroying terrain = %s.", terrainHandle);
@@ -1816,6 +3101,38 @@ std::string OpenGlRenderer::loadShaderContents(const std::string& filename) cons
 	return file->readAll();
 }
 
+std::string OpenGlRenderer::loadShaderContents(const std::string& filename, const std::vector<std::string>& preludeFilenames) const
+{
+	auto contents = loadShaderContents(filename);
+
+	std::string prelude;
+	for (const auto& preludeFilename : preludeFilenames)
+	{
+		prelude += loadShaderContents(preludeFilename) + "\n";
+	}
+
+	// #version has to come before anything else in the shader, and #extension before any declaration
+	const auto version = contents.find("#version");
+
+	if (version == std::string::npos) throw GraphicsException("Shader with filename '" + filename + "' has no #version directive.");
+
+	auto insertAt = contents.find('\n', version);
+
+	while (insertAt != std::string::npos && contents.compare(insertAt + 1, 10, "#extension") == 0)
+	{
+		insertAt = contents.find('\n', insertAt + 1);
+	}
+
+	if (insertAt == std::string::npos) throw GraphicsException("Shader with filename '" + filename + "' has nothing after its directives.");
+
+	// Lines are numbered from 1, the line after the directives is one more than the number of newlines before it
+	const auto nextLine = std::count(contents.begin(), contents.begin() + insertAt + 1, '\n') + 1;
+
+	contents.insert(insertAt + 1, prelude + "#line " + std::to_string(nextLine) + "\n");
+
+	return contents;
+}
+
 VertexShaderHandle OpenGlRenderer::createVertexShader(const std::string& data)
 {
 	LOG_DEBUG(logger_, "Creating vertex shader from data: %s", data);
@@ -1906,7 +3223,11 @@ ShaderProgramHandle OpenGlRenderer::createShaderProgram(const VertexShaderHandle
 	const auto& vertexShader = vertexShaders_[vertexShaderHandle];
 	const auto& fragmentShader = fragmentShaders_[fragmentShaderHandle];
 
-	return shaderPrograms_.create( ShaderProgram(vertexShader, fragmentShader) );
+	auto shaderProgram = ShaderProgram(vertexShader, fragmentShader);
+	shaderProgram.uniformBlockBinding(FRAME_DATA_UNIFORM_BLOCK, FRAME_DATA_UNIFORM_BLOCK_BINDING);
+	shaderProgram.uniformBlockBinding(BONES_UNIFORM_BLOCK, BONES_UNIFORM_BLOCK_BINDING);
+
+	return shaderPrograms_.create( std::move(shaderProgram) );
 }
 
 ShaderProgramHandle OpenGlRenderer::createShaderProgram(
@@ -1928,7 +3249,11 @@ ShaderProgramHandle OpenGlRenderer::createShaderProgram(
 	const auto& tessellationEvaluationShader = tessellationEvaluationShaders_[tessellationEvaluationShaderHandle];
 	const auto& fragmentShader = fragmentShaders_[fragmentShaderHandle];
 
-	return shaderPrograms_.create( ShaderProgram(vertexShader, tessellationControlShader, tessellationEvaluationShader, fragmentShader) );
+	auto shaderProgram = ShaderProgram(vertexShader, tessellationControlShader, tessellationEvaluationShader, fragmentShader);
+	shaderProgram.uniformBlockBinding(FRAME_DATA_UNIFORM_BLOCK, FRAME_DATA_UNIFORM_BLOCK_BINDING);
+	shaderProgram.uniformBlockBinding(BONES_UNIFORM_BLOCK, BONES_UNIFORM_BLOCK_BINDING);
+
+	return shaderPrograms_.create( std::move(shaderProgram) );
 }
 
 bool OpenGlRenderer::valid(const ShaderProgramHandle& shaderProgramHandle) const
@@ -1962,12 +3287,11 @@ RenderableHandle OpenGlRenderer::createRenderable(
 
 	renderScene.shaderProgramHandle = shaderProgramHandle;
 
-	renderable.vao = meshes_[meshHandle];
+	renderable.meshHandle = meshHandle;
 	renderable.textureHandle = textureHandle;
 
-	renderable.graphicsData.position = position;
-	renderable.graphicsData.scale = scale;
-	renderable.graphicsData.orientation = orientation;
+	renderable.transformIndex = renderScene.transforms.create(position, orientation, scale);
+	renderable.animationLod = animationLod_;
 
 	return handle;
 }
@@ -1987,13 +3311,12 @@ RenderableHandle OpenGlRenderer::createRenderable(
 
 	//renderScene.shaderProgramHandle = shaderProgramHandle;
 
-	renderable.vao = meshes_[meshHandle];
+	renderable.meshHandle = meshHandle;
 	//renderable.textureHandle = textureHandle;
 	renderable.materialHandle = materialHandle;
 
-	renderable.graphicsData.position = position;
-	renderable.graphicsData.scale = scale;
-	renderable.graphicsData.orientation = orientation;
+	renderable.transformIndex = renderScene.transforms.create(position, orientation, scale);
+	renderable.animationLod = animationLod_;
 
 	return handle;
 }
@@ -2001,6 +3324,7 @@ RenderableHandle OpenGlRenderer::createRenderable(
 void OpenGlRenderer::destroy(const RenderSceneHandle& renderSceneHandle, const RenderableHandle& renderableHandle)
 {
 	auto& renderScene = renderSceneHandles_[renderSceneHandle];
+	renderScene.transforms.destroy(renderScene.renderables[renderableHandle].transformIndex);
 	renderScene.renderables.destroy(renderableHandle);
 }
 
@@ -2075,16 +3399,17 @@ void OpenGlRenderer::rotate(const CameraHandle& cameraHandle, const glm::quat& q
 
 void OpenGlRenderer::rotate(const RenderSceneHandle& renderSceneHandle, const RenderableHandle& renderableHandle, const glm::quat& quaternion, const TransformSpace& relativeTo)
 {
-	auto& renderable = renderSceneHandles_[renderSceneHandle].renderables[renderableHandle];
+	auto& renderScene = renderSceneHandles_[renderSceneHandle];
+	const auto transformIndex = renderScene.renderables[renderableHandle].transformIndex;
 
 	switch( relativeTo )
 	{
 		case TransformSpace::TS_LOCAL:
-			renderable.graphicsData.orientation = renderable.graphicsData.orientation * glm::normalize( quaternion );
+			renderScene.transforms.orientation(transformIndex, renderScene.transforms.orientation(transformIndex) * glm::normalize( quaternion ));
 			break;
 
 		case TransformSpace::TS_WORLD:
-			renderable.graphicsData.orientation =  glm::normalize( quaternion ) * renderable.graphicsData.orientation;
+			renderScene.transforms.orientation(transformIndex, glm::normalize( quaternion ) * renderScene.transforms.orientation(transformIndex));
 			break;
 
 		default:
@@ -2111,16 +3436,17 @@ void OpenGlRenderer::rotate(const CameraHandle& cameraHandle, const float32 degr
 
 void OpenGlRenderer::rotate(const RenderSceneHandle& renderSceneHandle, const RenderableHandle& renderableHandle, const float32 degrees, const glm::vec3& axis, const TransformSpace& relativeTo)
 {
-	auto& renderable = renderSceneHandles_[renderSceneHandle].renderables[renderableHandle];
+	auto& renderScene = renderSceneHandles_[renderSceneHandle];
+	const auto transformIndex = renderScene.renderables[renderableHandle].transformIndex;
 
 	switch( relativeTo )
 	{
 		case TransformSpace::TS_LOCAL:
-			renderable.graphicsData.orientation = glm::normalize( glm::angleAxis(glm::radians(degrees), axis) ) * renderable.graphicsData.orientation;
+			renderScene.transforms.orientation(transformIndex, glm::normalize( glm::angleAxis(glm::radians(degrees), axis) ) * renderScene.transforms.orientation(transformIndex));
 			break;
 
 		case TransformSpace::TS_WORLD:
-			renderable.graphicsData.orientation =  renderable.graphicsData.orientation * glm::normalize( glm::angleAxis(glm::radians(degrees), axis) );
+			renderScene.transforms.orientation(transformIndex, renderScene.transforms.orientation(transformIndex) * glm::normalize( glm::angleAxis(glm::radians(degrees), axis) ));
 			break;
 
 		default:
@@ -2135,9 +3461,10 @@ void OpenGlRenderer::rotation(const CameraHandle& cameraHandle, const glm::quat&
 
 void OpenGlRenderer::rotation(const RenderSceneHandle& renderSceneHandle, const RenderableHandle& renderableHandle, const glm::quat& quaternion)
 {
-	auto& renderable = renderSceneHandles_[renderSceneHandle].renderables[renderableHandle];
+	auto& renderScene = renderSceneHandles_[renderSceneHandle];
+	const auto transformIndex = renderScene.renderables[renderableHandle].transformIndex;
 
-	renderable.graphicsData.orientation = glm::normalize( quaternion );
+	renderScene.transforms.orientation(transformIndex, glm::normalize( quaternion ));
 }
 
 void OpenGlRenderer::rotation(const CameraHandle& cameraHandle, const float32 degrees, const glm::vec3& axis)
@@ -2147,9 +3474,10 @@ void OpenGlRenderer::rotation(const CameraHandle& cameraHandle, const float32 de
 
 void OpenGlRenderer::rotation(const RenderSceneHandle& renderSceneHandle, const RenderableHandle& renderableHandle, const float32 degrees, const glm::vec3& axis)
 {
-	auto& renderable = renderSceneHandles_[renderSceneHandle].renderables[renderableHandle];
+	auto& renderScene = renderSceneHandles_[renderSceneHandle];
+	const auto transformIndex = renderScene.renderables[renderableHandle].transformIndex;
 
-	renderable.graphicsData.orientation = glm::normalize( glm::angleAxis(glm::radians(degrees), axis) );
+	renderScene.transforms.orientation(transformIndex, glm::normalize( glm::angleAxis(glm::radians(degrees), axis) ));
 }
 
 glm::quat OpenGlRenderer::rotation(const CameraHandle& cameraHandle) const
@@ -2159,7 +3487,9 @@ glm::quat OpenGlRenderer::rotation(const CameraHandle& cameraHandle) const
 
 glm::quat OpenGlRenderer::rotation(const RenderSceneHandle& renderSceneHandle, const RenderableHandle& renderableHandle) const
 {
-	return renderSceneHandles_[renderSceneHandle].renderables[renderableHandle].graphicsData.orientation;
+	const auto& renderScene = renderSceneHandles_[renderSceneHandle];
+
+	return renderScene.transforms.orientation(renderScene.renderables[renderableHandle].transformIndex);
 }
 
 void OpenGlRenderer::translate(const CameraHandle& cameraHandle, const float32 x, const float32 y, const float32 z)
@@ -2169,9 +3499,10 @@ void OpenGlRenderer::translate(const CameraHandle& cameraHandle, const float32 x
 
 void OpenGlRenderer::translate(const RenderSceneHandle& renderSceneHandle, const RenderableHandle& renderableHandle, const float32 x, const float32 y, const float32 z)
 {
-	auto& renderable = renderSceneHandles_[renderSceneHandle].renderables[renderableHandle];
+	auto& renderScene = renderSceneHandles_[renderSceneHandle];
+	const auto transformIndex = renderScene.renderables[renderableHandle].transformIndex;
 
-	renderable.graphicsData.position += glm::vec3(x, y, z);
+	renderScene.transforms.position(transformIndex, renderScene.transforms.position(transformIndex) + glm::vec3(x, y, z));
 }
 
 void OpenGlRenderer::translate(const RenderSceneHandle& renderSceneHandle, const PointLightHandle& pointLightHandle, const float32 x, const float32 y, const float32 z)
@@ -2188,9 +3519,10 @@ void OpenGlRenderer::translate(const CameraHandle& cameraHandle, const glm::vec3
 
 void OpenGlRenderer::translate(const RenderSceneHandle& renderSceneHandle, const RenderableHandle& renderableHandle, const glm::vec3& trans)
 {
-	auto& renderable = renderSceneHandles_[renderSceneHandle].renderables[renderableHandle];
+	auto& renderScene = renderSceneHandles_[renderSceneHandle];
+	const auto transformIndex = renderScene.renderables[renderableHandle].transformIndex;
 
-	renderable.graphicsData.position += trans;
+	renderScene.transforms.position(transformIndex, renderScene.transforms.position(transformIndex) + trans);
 }
 
 void OpenGlRenderer::translate(const RenderSceneHandle& renderSceneHandle, const PointLightHandle& pointLightHandle, const glm::vec3& trans)
@@ -2202,34 +3534,40 @@ void OpenGlRenderer::translate(const RenderSceneHandle& renderSceneHandle, const
 
 void OpenGlRenderer::scale(const RenderSceneHandle& renderSceneHandle, const RenderableHandle& renderableHandle, const float32 x, const float32 y, const float32 z)
 {
-	auto& renderable = renderSceneHandles_[renderSceneHandle].renderables[renderableHandle];
+	auto& renderScene = renderSceneHandles_[renderSceneHandle];
+	const auto transformIndex = renderScene.renderables[renderableHandle].transformIndex;
 
-	renderable.graphicsData.scale = glm::vec3(x, y, z);
+	renderScene.transforms.scale(transformIndex, glm::vec3(x, y, z));
 }
 
 void OpenGlRenderer::scale(const RenderSceneHandle& renderSceneHandle, const RenderableHandle& renderableHandle, const glm::vec3& scale)
 {
-	auto& renderable = renderSceneHandles_[renderSceneHandle].renderables[renderableHandle];
+	auto& renderScene = renderSceneHandles_[renderSceneHandle];
+	const auto transformIndex = renderScene.renderables[renderableHandle].transformIndex;
 
-	renderable.graphicsData.scale = scale;
+	renderScene.transforms.scale(transformIndex, scale);
 }
 
 void OpenGlRenderer::scale(const RenderSceneHandle& renderSceneHandle, const RenderableHandle& renderableHandle, const float32 scale)
 {
-	auto& renderable = renderSceneHandles_[renderSceneHandle].renderables[renderableHandle];
+	auto& renderScene = renderSceneHandles_[renderSceneHandle];
+	const auto transformIndex = renderScene.renderables[renderableHandle].transformIndex;
 
-	renderable.graphicsData.scale = glm::vec3(scale, scale, scale);
+	renderScene.transforms.scale(transformIndex, glm::vec3(scale, scale, scale));
 }
 
 glm::vec3 OpenGlRenderer::scale(const RenderSceneHandle& renderSceneHandle, const RenderableHandle& renderableHandle) const
 {
-	return renderSceneHandles_[renderSceneHandle].renderables[renderableHandle].graphicsData.scale;
+	const auto& renderScene = renderSceneHandles_[renderSceneHandle];
+
+	return renderScene.transforms.scale(renderScene.renderables[renderableHandle].transformIndex);
 }
 
 void OpenGlRenderer::position(const RenderSceneHandle& renderSceneHandle, const RenderableHandle& renderableHandle, const float32 x, const float32 y, const float32 z)
 {
-	auto& renderable = renderSceneHandles_[renderSceneHandle].renderables[renderableHandle];
-	renderable.graphicsData.position = glm::vec3(x, y, z);
+	auto& renderScene = renderSceneHandles_[renderSceneHandle];
+	const auto transformIndex = renderScene.renderables[renderableHandle].transformIndex;
+	renderScene.transforms.position(transformIndex, glm::vec3(x, y, z));
 }
 
 void OpenGlRenderer::position(const RenderSceneHandle& renderSceneHandle, const PointLightHandle& pointLightHandle, const float32 x, const float32 y, const float32 z)
@@ -2246,9 +3584,10 @@ void OpenGlRenderer::position(const CameraHandle& cameraHandle, const float32 x,
 
 void OpenGlRenderer::position(const RenderSceneHandle& renderSceneHandle, const RenderableHandle& renderableHandle, const glm::vec3& position)
 {
-	auto& renderable = renderSceneHandles_[renderSceneHandle].renderables[renderableHandle];
+	auto& renderScene = renderSceneHandles_[renderSceneHandle];
+	const auto transformIndex = renderScene.renderables[renderableHandle].transformIndex;
 
-	renderable.graphicsData.position = position;
+	renderScene.transforms.position(transformIndex, position);
 }
 
 void OpenGlRenderer::position(const RenderSceneHandle& renderSceneHandle, const PointLightHandle& pointLightHandle, const glm::vec3& position)
@@ -2265,7 +3604,9 @@ void OpenGlRenderer::position(const CameraHandle& cameraHandle, const glm::vec3&
 
 glm::vec3 OpenGlRenderer::position(const RenderSceneHandle& renderSceneHandle, const RenderableHandle& renderableHandle) const
 {
-	return renderSceneHandles_[renderSceneHandle].renderables[renderableHandle].graphicsData.position;
+	const auto& renderScene = renderSceneHandles_[renderSceneHandle];
+
+	return renderScene.transforms.position(renderScene.renderables[renderableHandle].transformIndex);
 }
 
 glm::vec3 OpenGlRenderer::position(const RenderSceneHandle& renderSceneHandle, const PointLightHandle& pointLightHandle) const
@@ -2280,12 +3621,13 @@ glm::vec3 OpenGlRenderer::position(const CameraHandle& cameraHandle) const
 
 void OpenGlRenderer::lookAt(const RenderSceneHandle& renderSceneHandle, const RenderableHandle& renderableHandle, const glm::vec3& lookAt)
 {
-	auto& renderable = renderSceneHandles_[renderSceneHandle].renderables[renderableHandle];
+	auto& renderScene = renderSceneHandles_[renderSceneHandle];
+	const auto transformIndex = renderScene.renderables[renderableHandle].transformIndex;
 
-	assert(lookAt != renderable.graphicsData.position);
+	assert(lookAt != renderScene.transforms.position(transformIndex));
 
-	const glm::mat4 lookAtMatrix = glm::lookAt(renderable.graphicsData.position, lookAt, glm::vec3(0.0f, 1.0f, 0.0f));
-	renderable.graphicsData.orientation =  glm::normalize( renderable.graphicsData.orientation * glm::quat_cast( lookAtMatrix ) );
+	const glm::mat4 lookAtMatrix = glm::lookAt(renderScene.transforms.position(transformIndex), lookAt, glm::vec3(0.0f, 1.0f, 0.0f));
+	renderScene.transforms.orientation(transformIndex, glm::normalize( renderScene.transforms.orientation(transformIndex) * glm::quat_cast( lookAtMatrix ) ));
 }
 
 void OpenGlRenderer::lookAt(const CameraHandle& cameraHandle, const glm::vec3& lookAt)
@@ -2302,9 +3644,7 @@ void OpenGlRenderer::lookAt(const CameraHandle& cameraHandle, const glm::vec3& l
 
 void OpenGlRenderer::assign(const RenderSceneHandle& renderSceneHandle, const RenderableHandle& renderableHandle, const SkeletonHandle& skeletonHandle)
 {
-	auto& renderable = renderSceneHandles_[renderSceneHandle].renderables[renderableHandle];
-
-	renderable.ubo = skeletons_[skeletonHandle];
+	// Bone ids and weights are part of the mesh since createSkeleton, so there is nothing to assign
 }
 
 void OpenGlRenderer::update(
@@ -2323,20 +3663,82 @@ void OpenGlRenderer::update(
 	//memcpy( d, data, size );
 	//glUnmapBuffer(GL_UNIFORM_BUFFER);
 
-	auto& renderScene = renderSceneHandles_[renderSceneHandle];
-	auto& renderable = renderScene.renderables[renderableHandle];
+	ice_engine::detail::checkHandleValidity(bones_, bonesHandle);
+
+	auto& bonePalette = bones_[bonesHandle];
+
+	// Only kept on the CPU here, the palettes of the drawn renderables are streamed to the GPU once per frame. Updates
+	// that are not due are stored too, they are just not packed, so the bones are current when they come into view
+	const bool due = animationUpdateDue(bonesHandle);
+	const bool reduced = (animationLodLevel(bonePalette) == AnimationLodLevel::REDUCED);
+
+	if (due && reduced)
+	{
+		// Decomposed once per sample, not every interpolated frame
+		if (bonePalette.poses.size() == bonePalette.transformations.size())
+		{
+			bonePalette.previousPoses.swap(bonePalette.poses);
+		}
+		else
+		{
+			decomposeBones(bonePalette.transformations.data(), bonePalette.transformations.size(), bonePalette.previousPoses);
+		}
+	}
+	else if (due)
+	{
+		bonePalette.previousPoses.clear();
+		bonePalette.poses.clear();
+	}
 
-	auto size = transformations.size() * sizeof(glm::mat4);
+	bonePalette.transformations.assign(transformations.begin(), transformations.end());
+	bonePalette.packed = false;
 
-	glBindBuffer(GL_UNIFORM_BUFFER, renderable.ubo.id);
+	if (due && reduced)
+	{
+		decomposeBones(bonePalette.transformations.data(), bonePalette.transformations.size(), bonePalette.poses);
+	}
 
-	void* d = glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
-	memcpy( d, &transformations[0], size );
-	glUnmapBuffer(GL_UNIFORM_BUFFER);
+	if (due)
+	{
+		bonePalette.sampleFrame = animationLodFrame_;
+	}
 
 //	glBufferData(GL_UNIFORM_BUFFER, size, &transformations[0], GL_STREAM_DRAW);
 }
 
+void OpenGlRenderer::animationLod(const RenderSceneHandle& renderSceneHandle, const RenderableHandle& renderableHandle, const AnimationLod& animationLod)
+{
+	ice_engine::detail::checkHandleValidity(renderSceneHandles_, renderSceneHandle);
+
+	auto& renderScene = renderSceneHandles_[renderSceneHandle];
+
+	ice_engine::detail::checkHandleValidity(renderScene.renderables, renderableHandle);
+
+	renderScene.renderables[renderableHandle].animationLod = animationLod;
+}
+
+AnimationLodLevel OpenGlRenderer::animationLodLevel(const BonesHandle& bonesHandle) const
+{
+	return animationLodLevel(bones_[bonesHandle]);
+}
+
+bool OpenGlRenderer::animationUpdateDue(const BonesHandle& bonesHandle) const
+{
+	const auto& bonePalette = bones_[bonesHandle];
+
+	switch (animationLodLevel(bonePalette))
+	{
+		case AnimationLodLevel::FROZEN:
+			return false;
+
+		case AnimationLodLevel::REDUCED:
+			return (animationLodFrame_ - bonePalette.sampleFrame >= bonePalette.reducedUpdateInterval);
+
+		default:
+			return true;
+	}
+}
+
 void OpenGlRenderer::setMouseRelativeMode(const bool enabled)
 {
     LOG_DEBUG(logger_, "Setting mouse relative mode enabled = %s.", enabled);
@@ -3592,7 +4994,21 @@ void OpenGlRenderer::destroy(const MeshHandle& meshHandle)
 
     ice_engine::detail::checkHandleValidity(meshes_, meshHandle);
 
-    // TODO
+    meshVertexRemaps_.erase(meshHandle.index());
+
+	const auto& vao = meshes_[meshHandle];
+	auto& arena = meshArenas_[vao.arena];
+
+	arena.free(vao.allocation);
+	meshes_.destroy(meshHandle);
+
+	// Streaming levels in and out leaves holes behind, compact once most of the free space is unusable
+	if (arena.fragmentation() > MESH_ARENA_DEFRAGMENTATION_THRESHOLD)
+	{
+		LOG_DEBUG(logger_, "Defragmenting mesh arena (fragmentation = %s).", arena.fragmentation());
+
+		arena.defragment();
+	}
 }
 
 bool OpenGlRenderer::valid(const SkeletonHandle& skeletonHandle) const
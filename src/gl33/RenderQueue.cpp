@@ -0,0 +1,117 @@
+#include <algorithm>
+
+#include "gl33/RenderQueue.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+namespace
+{
+
+constexpr uint32 PASS_BITS = 4;
+constexpr uint32 PROGRAM_BITS = 8;
+constexpr uint32 SKINNED_BITS = 1;
+constexpr uint32 MATERIAL_BITS = 16;
+constexpr uint32 MESH_BITS = 16;
+constexpr uint32 DEPTH_BITS = 19;
+
+static_assert(PASS_BITS + PROGRAM_BITS + SKINNED_BITS + MATERIAL_BITS + MESH_BITS + DEPTH_BITS == 64, "Sort key fields must fill 64 bits");
+
+constexpr uint32 MESH_SHIFT = DEPTH_BITS;
+constexpr uint32 MATERIAL_SHIFT = MESH_SHIFT + MESH_BITS;
+constexpr uint32 SKINNED_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+constexpr uint32 PROGRAM_SHIFT = SKINNED_SHIFT + SKINNED_BITS;
+constexpr uint32 PASS_SHIFT = PROGRAM_SHIFT + PROGRAM_BITS;
+
+constexpr uint64 mask(const uint32 bits)
+{
+	return (1ull << bits) - 1ull;
+}
+
+}
+
+uint64 RenderQueue::key(
+	const RenderPass pass,
+	const uint32 program,
+	const bool skinned,
+	const uint32 material,
+	const uint32 mesh,
+	const float32 depth
+)
+{
+	const float32 clampedDepth = std::min(std::max(depth, 0.0f), 1.0f);
+	const uint64 quantizedDepth = static_cast<uint64>(clampedDepth * static_cast<float32>(mask(DEPTH_BITS)));
+
+	return ((static_cast<uint64>(pass) & mask(PASS_BITS)) << PASS_SHIFT)
+		| ((static_cast<uint64>(program) & mask(PROGRAM_BITS)) << PROGRAM_SHIFT)
+		| ((static_cast<uint64>(skinned) & mask(SKINNED_BITS)) << SKINNED_SHIFT)
+		| ((static_cast<uint64>(material) & mask(MATERIAL_BITS)) << MATERIAL_SHIFT)
+		| ((static_cast<uint64>(mesh) & mask(MESH_BITS)) << MESH_SHIFT)
+		| (quantizedDepth & mask(DEPTH_BITS));
+}
+
+RenderPass RenderQueue::pass(const uint64 key)
+{
+	return static_cast<RenderPass>((key >> PASS_SHIFT) & mask(PASS_BITS));
+}
+
+void RenderQueue::clear()
+{
+	items_.clear();
+}
+
+void RenderQueue::push(const uint64 key, const uint32 index)
+{
+	items_.push_back({key, index});
+}
+
+void RenderQueue::sort()
+{
+	if (items_.size() < 2) return;
+
+	scratch_.resize(items_.size());
+
+	for (uint32 shift = 0; shift < 64; shift += 8)
+	{
+		uint32 counts[256] = {};
+
+		for (const auto& item : items_)
+		{
+			++counts[(item.key >> shift) & 0xFF];
+		}
+
+		// Every key has the same byte here, so this pass would not change the order
+		if (counts[(items_[0].key >> shift) & 0xFF] == items_.size()) continue;
+
+		uint32 offset = 0;
+		for (auto& count : counts)
+		{
+			const uint32 c = count;
+			count = offset;
+			offset += c;
+		}
+
+		for (const auto& item : items_)
+		{
+			scratch_[counts[(item.key >> shift) & 0xFF]++] = item;
+		}
+
+		items_.swap(scratch_);
+	}
+}
+
+const std::vector<RenderQueueItem>& RenderQueue::items() const
+{
+	return items_;
+}
+
+}
+}
+}
+}
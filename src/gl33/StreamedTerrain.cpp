@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "gl33/StreamedTerrain.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+namespace
+{
+
+// Tiles requested from the loader but not uploaded yet, so the nearest missing tiles are always the next to be read
+constexpr uint32 MAX_LOADING_TILES = 8;
+
+}
+
+StreamedTerrain::StreamedTerrain(const std::string& filename, const uint32 slotCount) : loader_(filename)
+{
+	if (slotCount == 0) throw std::runtime_error("Streamed terrain must have at least one tile slot.");
+
+	const auto& header = loader_.header();
+	const GLsizei samples = static_cast<GLsizei>(loader_.tileSamples());
+	const uint32 tileCount = header.tileCountX * header.tileCountZ;
+
+	slots_.resize(slotCount);
+	tileSlotIndices_.resize(tileCount, -1);
+	residentTileSlotIndices_.resize(tileCount, -1);
+	failedTiles_.resize(tileCount, false);
+	wantedFrames_.resize(tileCount, 0);
+
+	heightNormalTiles_.generate(GL_RGBA16, samples, samples, static_cast<GLsizei>(slotCount), GL_RGBA, GL_UNSIGNED_SHORT);
+	heightNormalTiles_.bind();
+	gl::Texture2dArray::texParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	gl::Texture2dArray::texParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	gl::Texture2dArray::texParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	gl::Texture2dArray::texParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	terrainMapTiles_.generate(GL_RGBA8UI, samples, samples, static_cast<GLsizei>(slotCount), GL_RGBA_INTEGER, GL_UNSIGNED_BYTE);
+	terrainMapTiles_.bind();
+	gl::Texture2dArray::texParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	gl::Texture2dArray::texParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	gl::Texture2dArray::texParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	gl::Texture2dArray::texParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	tileSlots_.generate(GL_R32I, static_cast<GLsizei>(header.tileCountX), static_cast<GLsizei>(header.tileCountZ), GL_RED_INTEGER, GL_INT, &residentTileSlotIndices_[0]);
+	tileSlots_.bind();
+	gl::Texture2d::texParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	gl::Texture2d::texParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	const GLsizei overviewWidth = static_cast<GLsizei>(loader_.overviewWidth());
+	const GLsizei overviewHeight = static_cast<GLsizei>(loader_.overviewHeight());
+
+	heightNormalOverview_.generate(GL_RGBA16, overviewWidth, overviewHeight, GL_RGBA, GL_UNSIGNED_SHORT, loader_.overviewHeightNormal());
+	heightNormalOverview_.bind();
+	gl::Texture2d::texParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	gl::Texture2d::texParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	gl::Texture2d::texParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	gl::Texture2d::texParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	terrainMapOverview_.generate(GL_RGBA8UI, overviewWidth, overviewHeight, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, loader_.overviewTerrainMap());
+	terrainMapOverview_.bind();
+	gl::Texture2d::texParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	gl::Texture2d::texParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	gl::Texture2d::texParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	gl::Texture2d::texParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+StreamedTerrain::~StreamedTerrain()
+{
+	if (valid())
+	{
+		destroy();
+	}
+}
+
+void StreamedTerrain::destroy()
+{
+	if (!valid()) throw std::runtime_error("Cannot destroy streamed terrain - streamed terrain was not created.");
+
+	heightNormalTiles_.destroy();
+	terrainMapTiles_.destroy();
+	tileSlots_.destroy();
+	heightNormalOverview_.destroy();
+	terrainMapOverview_.destroy();
+}
+
+GLsizeiptr StreamedTerrain::update(const glm::vec3& cameraPosition, const float32 distance, const GLsizeiptr uploadBudget)
+{
+	if (!valid()) throw std::runtime_error("Cannot update streamed terrain - streamed terrain was not created.");
+
+	++frame_;
+
+	// Upload what the loader has finished
+	const GLsizeiptr tileBytes = static_cast<GLsizeiptr>(loader_.tileHeightNormalSize() + loader_.tileTerrainMapSize());
+	GLsizeiptr uploaded = 0;
+	TerrainTile tile;
+
+	// The first tile may go over the budget, so tiles larger than the budget still make progress
+	while ((uploaded == 0 ? uploadBudget > 0 : uploaded + tileBytes <= uploadBudget) && loader_.pop(tile))
+	{
+		--loadingCount_;
+
+		if (tile.heightNormal.empty())
+		{
+			// Unreadable, free the slot and never ask for the tile again
+			slots_[tileSlotIndices_[tile.index]].state = SlotState::FREE;
+			tileSlotIndices_[tile.index] = -1;
+			failedTiles_[tile.index] = true;
+
+			continue;
+		}
+
+		upload(tile);
+		uploaded += tileBytes;
+	}
+
+	// Tiles within the streaming distance, nearest first
+	const auto& header = loader_.header();
+	const float32 tileSize = static_cast<float32>(header.tileSize);
+	const float32 distanceSquaredLimit = distance * distance;
+
+	const int32 firstX = std::max(static_cast<int32>(std::floor((cameraPosition.x - distance) / tileSize)), 0);
+	const int32 firstZ = std::max(static_cast<int32>(std::floor((cameraPosition.z - distance) / tileSize)), 0);
+	const int32 lastX = std::min(static_cast<int32>(std::floor((cameraPosition.x + distance) / tileSize)), static_cast<int32>(header.tileCountX) - 1);
+	const int32 lastZ = std::min(static_cast<int32>(std::floor((cameraPosition.z + distance) / tileSize)), static_cast<int32>(header.tileCountZ) - 1);
+
+	wantedTiles_.clear();
+
+	for (int32 z = firstZ; z <= lastZ; ++z)
+	{
+		for (int32 x = firstX; x <= lastX; ++x)
+		{
+			const uint32 index = static_cast<uint32>(z) * header.tileCountX + static_cast<uint32>(x);
+			const float32 tileDistanceSquared = distanceSquared(index, cameraPosition);
+
+			if (tileDistanceSquared > distanceSquaredLimit) continue;
+
+			wantedFrames_[index] = frame_;
+			wantedTiles_.push_back({tileDistanceSquared, index});
+		}
+	}
+
+	std::sort(wantedTiles_.begin(), wantedTiles_.end(), [](const TileDistance& a, const TileDistance& b) {
+		return a.distanceSquared < b.distanceSquared;
+	});
+
+	for (const auto& wantedTile : wantedTiles_)
+	{
+		if (loadingCount_ >= MAX_LOADING_TILES) break;
+
+		if (tileSlotIndices_[wantedTile.tile] >= 0 || failedTiles_[wantedTile.tile]) continue;
+
+		const int32 slot = acquireSlot(cameraPosition);
+
+		// Every slot holds a tile that is wanted as well
+		if (slot < 0) break;
+
+		slots_[slot].tile = wantedTile.tile;
+		slots_[slot].state = SlotState::LOADING;
+		tileSlotIndices_[wantedTile.tile] = slot;
+
+		loader_.request(wantedTile.tile);
+		++loadingCount_;
+	}
+
+	if (tileSlotsDirty_)
+	{
+		tileSlots_.bind();
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, static_cast<GLsizei>(header.tileCountX), static_cast<GLsizei>(header.tileCountZ), GL_RED_INTEGER, GL_INT, &residentTileSlotIndices_[0]);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		tileSlotsDirty_ = false;
+	}
+
+	return uploaded;
+}
+
+void StreamedTerrain::bind(
+	const GLuint heightNormalUnit,
+	const GLuint terrainMapUnit,
+	const GLuint tileSlotsUnit,
+	const GLuint heightNormalOverviewUnit,
+	const GLuint terrainMapOverviewUnit
+)
+{
+	gl::Texture2dArray::activate(heightNormalUnit);
+	heightNormalTiles_.bind();
+
+	gl::Texture2dArray::activate(terrainMapUnit);
+	terrainMapTiles_.bind();
+
+	gl::Texture2d::activate(tileSlotsUnit);
+	tileSlots_.bind();
+
+	gl::Texture2d::activate(heightNormalOverviewUnit);
+	heightNormalOverview_.bind();
+
+	gl::Texture2d::activate(terrainMapOverviewUnit);
+	terrainMapOverview_.bind();
+}
+
+uint32 StreamedTerrain::width() const
+{
+	return loader_.header().width;
+}
+
+uint32 StreamedTerrain::height() const
+{
+	return loader_.header().height;
+}
+
+uint32 StreamedTerrain::tileSize() const
+{
+	return loader_.header().tileSize;
+}
+
+glm::ivec2 StreamedTerrain::tileCount() const
+{
+	return glm::ivec2(loader_.header().tileCountX, loader_.header().tileCountZ);
+}
+
+uint32 StreamedTerrain::overviewStep() const
+{
+	return loader_.header().overviewStep;
+}
+
+uint32 StreamedTerrain::residentTileCount() const
+{
+	return residentCount_;
+}
+
+bool StreamedTerrain::valid() const
+{
+	return heightNormalTiles_.valid();
+}
+
+void StreamedTerrain::upload(const TerrainTile& tile)
+{
+	const int32 slot = tileSlotIndices_[tile.index];
+	const GLsizei samples = static_cast<GLsizei>(loader_.tileSamples());
+
+	heightNormalTiles_.bind();
+	gl::Texture2dArray::texSubImage3D(samples, samples, slot, GL_RGBA, GL_UNSIGNED_SHORT, &tile.heightNormal[0]);
+
+	terrainMapTiles_.bind();
+	gl::Texture2dArray::texSubImage3D(samples, samples, slot, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, &tile.terrainMap[0]);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	slots_[slot].state = SlotState::RESIDENT;
+	residentTileSlotIndices_[tile.index] = slot;
+	tileSlotsDirty_ = true;
+	++residentCount_;
+}
+
+int32 StreamedTerrain::acquireSlot(const glm::vec3& cameraPosition)
+{
+	int32 evictedSlot = -1;
+	float32 evictedDistanceSquared = 0.0f;
+
+	for (uint32 i = 0; i < slots_.size(); ++i)
+	{
+		const auto& slot = slots_[i];
+
+		if (slot.state == SlotState::FREE) return static_cast<int32>(i);
+
+		// Loading slots are kept, their tile is about to arrive
+		if (slot.state != SlotState::RESIDENT || wantedFrames_[slot.tile] == frame_) continue;
+
+		const float32 slotDistanceSquared = distanceSquared(slot.tile, cameraPosition);
+
+		if (evictedSlot < 0 || slotDistanceSquared > evictedDistanceSquared)
+		{
+			evictedSlot = static_cast<int32>(i);
+			evictedDistanceSquared = slotDistanceSquared;
+		}
+	}
+
+	if (evictedSlot >= 0)
+	{
+		const uint32 evictedTile = slots_[evictedSlot].tile;
+
+		tileSlotIndices_[evictedTile] = -1;
+		residentTileSlotIndices_[evictedTile] = -1;
+		slots_[evictedSlot].state = SlotState::FREE;
+		tileSlotsDirty_ = true;
+		--residentCount_;
+	}
+
+	return evictedSlot;
+}
+
+float32 StreamedTerrain::distanceSquared(const uint32 tile, const glm::vec3& position) const
+{
+	const auto& header = loader_.header();
+	const glm::vec2 minimum = glm::vec2(tile % header.tileCountX, tile / header.tileCountX) * static_cast<float32>(header.tileSize);
+	const glm::vec2 maximum = minimum + static_cast<float32>(header.tileSize);
+
+	// Distance to the closest point of the tile, ignoring height
+	const glm::vec2 closest = glm::min(glm::max(glm::vec2(position.x, position.z), minimum), maximum);
+	const glm::vec2 delta = glm::vec2(position.x, position.z) - closest;
+
+	return glm::dot(delta, delta);
+}
+
+}
+}
+}
+}
@@ -0,0 +1,272 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "gl33/StreamingBuffer.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+namespace
+{
+
+constexpr GLbitfield PERSISTENT_MAP_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+// Upper bound for waiting on a single fence, in nanoseconds
+constexpr GLuint64 FENCE_TIMEOUT = 1000000000;
+
+GLintptr align(const GLintptr offset, const GLsizeiptr alignment)
+{
+	return (alignment > 1 ? ((offset + alignment - 1) / alignment) * alignment : offset);
+}
+
+void waitForFence(GLsync& fence)
+{
+	if (fence == nullptr) return;
+
+	GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+
+	while (result == GL_TIMEOUT_EXPIRED)
+	{
+		result = glClientWaitSync(fence, 0, FENCE_TIMEOUT);
+	}
+
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+}
+
+StreamingBuffer::~StreamingBuffer()
+{
+	if (valid())
+	{
+		destroy();
+	}
+}
+
+void StreamingBuffer::generate(const GLsizeiptr frameSize, const bool persistentMapping, const GLsizeiptr maxFrameSize)
+{
+	if (valid()) throw std::runtime_error("Cannot generate streaming buffer - streaming buffer was already created.");
+
+	persistentMapping_ = persistentMapping;
+	maxFrameSize_ = maxFrameSize;
+
+	create(frameSize);
+}
+
+void StreamingBuffer::destroy()
+{
+	if (!valid()) throw std::runtime_error("Cannot destroy streaming buffer - streaming buffer was not created.");
+
+	release();
+
+	for (auto& retiredBuffer : retiredBuffers_)
+	{
+		glDeleteBuffers(1, &retiredBuffer.first);
+	}
+
+	retiredBuffers_.clear();
+}
+
+StreamingAllocation StreamingBuffer::allocate(const GLsizeiptr size, const GLsizeiptr alignment)
+{
+	if (!valid()) throw std::runtime_error("Cannot allocate from streaming buffer - streaming buffer was not created.");
+	if (mapped_) throw std::runtime_error("Cannot allocate from streaming buffer - streaming buffer is mapped.");
+
+	GLintptr offset = align(head_, alignment);
+
+	if (offset + size > frameSize_)
+	{
+		GLsizeiptr frameSize = frameSize_ * 2;
+
+		while (frameSize < size + alignment)
+		{
+			frameSize *= 2;
+		}
+
+		if (maxFrameSize_ > 0)
+		{
+			if (size + alignment > maxFrameSize_) throw std::runtime_error("Cannot allocate from streaming buffer - allocation exceeds the maximum frame size.");
+
+			frameSize = std::min(frameSize, maxFrameSize_);
+		}
+
+		release();
+		create(frameSize);
+
+		offset = 0;
+	}
+
+	StreamingAllocation allocation;
+	allocation.buffer = buffer_;
+	allocation.offset = static_cast<GLintptr>(frame_) * frameSize_ + offset;
+	allocation.size = size;
+
+	head_ = offset + size;
+
+	return allocation;
+}
+
+StreamingAllocation StreamingBuffer::upload(const GLvoid* data, const GLsizeiptr size, const GLsizeiptr alignment)
+{
+	if (!valid()) throw std::runtime_error("Cannot upload to streaming buffer - streaming buffer was not created.");
+
+	GLvoid* mappedData = nullptr;
+	const StreamingAllocation allocation = map(size, alignment, mappedData);
+
+	std::memcpy(mappedData, data, static_cast<size_t>(size));
+	unmap();
+
+	return allocation;
+}
+
+StreamingAllocation StreamingBuffer::map(const GLsizeiptr size, const GLsizeiptr alignment, GLvoid*& data)
+{
+	if (!valid()) throw std::runtime_error("Cannot map streaming buffer - streaming buffer was not created.");
+
+	const StreamingAllocation allocation = allocate(size, alignment);
+
+	if (persistentMapping_)
+	{
+		data = mappedData_ + allocation.offset;
+	}
+	else
+	{
+		// The fence already guarantees the GPU is done with this range, so the driver must not synchronize
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+
+		data = glMapBufferRange(
+			GL_COPY_WRITE_BUFFER,
+			allocation.offset,
+			size,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT
+		);
+
+		if (data == nullptr) throw std::runtime_error("Could not map streaming buffer.");
+	}
+
+	mapped_ = true;
+
+	return allocation;
+}
+
+void StreamingBuffer::unmap()
+{
+	if (!mapped_) throw std::runtime_error("Cannot unmap streaming buffer - streaming buffer is not mapped.");
+
+	if (!persistentMapping_)
+	{
+		// Other code may have bound another buffer since the range was mapped
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	}
+
+	mapped_ = false;
+}
+
+void StreamingBuffer::endFrame()
+{
+	if (!valid()) throw std::runtime_error("Cannot end streaming buffer frame - streaming buffer was not created.");
+	if (mapped_) throw std::runtime_error("Cannot end streaming buffer frame - streaming buffer is mapped.");
+
+	fences_[frame_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	frame_ = (frame_ + 1) % FRAME_COUNT;
+	head_ = 0;
+
+	waitForFence(fences_[frame_]);
+
+	for (auto it = retiredBuffers_.begin(); it != retiredBuffers_.end(); )
+	{
+		if (--it->second == 0)
+		{
+			glDeleteBuffers(1, &it->first);
+			it = retiredBuffers_.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+GLsizeiptr StreamingBuffer::frameSize() const
+{
+	return frameSize_;
+}
+
+bool StreamingBuffer::persistentMapping() const
+{
+	return persistentMapping_;
+}
+
+bool StreamingBuffer::valid() const
+{
+	return (buffer_ != 0);
+}
+
+void StreamingBuffer::create(const GLsizeiptr frameSize)
+{
+	frameSize_ = frameSize;
+	frame_ = 0;
+	head_ = 0;
+
+	glGenBuffers(1, &buffer_);
+
+	if (buffer_ == 0)
+	{
+		throw std::runtime_error("Could not create streaming buffer.");
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+
+	const GLsizeiptr size = frameSize_ * FRAME_COUNT;
+
+	if (persistentMapping_)
+	{
+		glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, PERSISTENT_MAP_FLAGS);
+		mappedData_ = static_cast<uint8*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, PERSISTENT_MAP_FLAGS));
+
+		if (mappedData_ == nullptr) throw std::runtime_error("Could not map streaming buffer.");
+	}
+	else
+	{
+		glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	}
+}
+
+void StreamingBuffer::release()
+{
+	if (persistentMapping_ || mapped_)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		mappedData_ = nullptr;
+		mapped_ = false;
+	}
+
+	// Commands issued this frame may still read the buffer
+	retiredBuffers_.emplace_back(buffer_, FRAME_COUNT);
+	buffer_ = 0;
+
+	for (auto& fence : fences_)
+	{
+		if (fence != nullptr)
+		{
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+}
+
+}
+}
+}
+}
@@ -0,0 +1,71 @@
+#include <algorithm>
+#include <cmath>
+
+#include "gl33/TerrainHeightNormal.hpp"
+#include "gl33/VertexFormat.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+namespace
+{
+
+constexpr uint32 CHANNELS = 4;
+
+uint16 packUnorm16(const float32 value)
+{
+	return static_cast<uint16>(std::round(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f));
+}
+
+}
+
+void packHeightNormals(
+	const byte* heightMap,
+	const uint32 width,
+	const uint32 height,
+	const float32 heightScale,
+	std::vector<uint16>& texels
+)
+{
+	texels.resize(static_cast<size_t>(width) * height * CHANNELS);
+
+	const auto sample = [heightMap, width, height, heightScale](const int32 x, const int32 z) {
+		const int32 clampedX = std::min(std::max(x, 0), static_cast<int32>(width) - 1);
+		const int32 clampedZ = std::min(std::max(z, 0), static_cast<int32>(height) - 1);
+
+		return heightScale * (static_cast<float32>(heightMap[(clampedZ * width + clampedX) * CHANNELS + 3]) / 255.0f - 0.5f);
+	};
+
+	for (uint32 z = 0; z < height; ++z)
+	{
+		for (uint32 x = 0; x < width; ++x)
+		{
+			const int32 ix = static_cast<int32>(x);
+			const int32 iz = static_cast<int32>(z);
+
+			// Samples at the edges use a one sided difference, as the clamped neighbour is the sample itself
+			const float32 dx = (sample(ix + 1, iz) - sample(ix - 1, iz)) / static_cast<float32>(std::min(ix + 1, static_cast<int32>(width) - 1) - std::max(ix - 1, 0));
+			const float32 dz = (sample(ix, iz + 1) - sample(ix, iz - 1)) / static_cast<float32>(std::min(iz + 1, static_cast<int32>(height) - 1) - std::max(iz - 1, 0));
+
+			const glm::vec3 normal = glm::normalize(glm::vec3(-dx, 1.0f, -dz));
+			const glm::vec2 encoded = octahedralEncode(glm::vec3(normal.x, normal.z, normal.y)) * 0.5f + 0.5f;
+			const size_t i = (static_cast<size_t>(z) * width + x) * CHANNELS;
+
+			texels[i] = static_cast<uint16>(heightMap[i + 3] * 257);
+			texels[i + 1] = packUnorm16(encoded.x);
+			texels[i + 2] = packUnorm16(encoded.y);
+			texels[i + 3] = 0;
+		}
+	}
+}
+
+}
+}
+}
+}
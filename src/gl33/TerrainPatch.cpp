@@ -0,0 +1,176 @@
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "gl33/TerrainPatch.hpp"
+#include "gl33/TerrainQuadtree.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+namespace
+{
+
+// Must match the locations in deferred_lighting_terrain_geometry_pass.vert
+constexpr GLuint GRID_POSITION_ATTRIBUTE_LOCATION = 0;
+constexpr GLuint CHUNK_ATTRIBUTE_LOCATION = 4;
+constexpr GLuint MORPH_RANGE_ATTRIBUTE_LOCATION = 5;
+
+}
+
+TerrainPatch::~TerrainPatch()
+{
+	if (valid())
+	{
+		destroy();
+	}
+}
+
+void TerrainPatch::generate(const uint32 resolution, const bool patches)
+{
+	if (valid()) throw std::runtime_error("Cannot generate terrain patch - terrain patch was already created.");
+	if (resolution == 0 || resolution > 254) throw std::runtime_error("Terrain patch resolution must be between 1 and 254.");
+
+	resolution_ = resolution;
+	patches_ = patches;
+
+	const uint32 verticesPerSide = resolution + 1;
+
+	std::vector<glm::vec2> vertices;
+	vertices.reserve(verticesPerSide * verticesPerSide);
+
+	for (uint32 z = 0; z < verticesPerSide; ++z)
+	{
+		for (uint32 x = 0; x < verticesPerSide; ++x)
+		{
+			vertices.push_back(glm::vec2(x, z));
+		}
+	}
+
+	std::vector<uint16> indices;
+	indices.reserve(resolution * resolution * (patches ? 4 : 6));
+
+	for (uint32 z = 0; z < resolution; ++z)
+	{
+		for (uint32 x = 0; x < resolution; ++x)
+		{
+			const uint16 i = static_cast<uint16>(z * verticesPerSide + x);
+
+			if (patches)
+			{
+				// Corners at (0, 0), (1, 0), (0, 1) and (1, 1) of the tessellation domain
+				indices.push_back(i);
+				indices.push_back(static_cast<uint16>(i + 1));
+				indices.push_back(static_cast<uint16>(i + verticesPerSide));
+				indices.push_back(static_cast<uint16>(i + verticesPerSide + 1));
+
+				continue;
+			}
+
+			indices.push_back(i);
+			indices.push_back(static_cast<uint16>(i + verticesPerSide));
+			indices.push_back(static_cast<uint16>(i + 1));
+
+			indices.push_back(static_cast<uint16>(i + 1));
+			indices.push_back(static_cast<uint16>(i + verticesPerSide));
+			indices.push_back(static_cast<uint16>(i + verticesPerSide + 1));
+		}
+	}
+
+	indexCount_ = static_cast<GLsizei>(indices.size());
+
+	glGenVertexArrays(1, &vertexArray_);
+	glGenBuffers(1, &vertexBuffer_);
+	glGenBuffers(1, &indexBuffer_);
+
+	if (vertexArray_ == 0 || vertexBuffer_ == 0 || indexBuffer_ == 0)
+	{
+		throw std::runtime_error("Could not create terrain patch.");
+	}
+
+	glBindVertexArray(vertexArray_);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer_);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec2), &vertices[0], GL_STATIC_DRAW);
+	glVertexAttribPointer(GRID_POSITION_ATTRIBUTE_LOCATION, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (GLvoid*)0);
+	glEnableVertexAttribArray(GRID_POSITION_ATTRIBUTE_LOCATION);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer_);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16), &indices[0], GL_STATIC_DRAW);
+
+	glEnableVertexAttribArray(CHUNK_ATTRIBUTE_LOCATION);
+	glVertexAttribDivisor(CHUNK_ATTRIBUTE_LOCATION, 1);
+	glEnableVertexAttribArray(MORPH_RANGE_ATTRIBUTE_LOCATION);
+	glVertexAttribDivisor(MORPH_RANGE_ATTRIBUTE_LOCATION, 1);
+
+	glBindVertexArray(0);
+}
+
+void TerrainPatch::destroy()
+{
+	if (!valid()) throw std::runtime_error("Cannot destroy terrain patch - terrain patch was not created.");
+
+	glDeleteVertexArrays(1, &vertexArray_);
+	glDeleteBuffers(1, &vertexBuffer_);
+	glDeleteBuffers(1, &indexBuffer_);
+
+	vertexArray_ = 0;
+	vertexBuffer_ = 0;
+	indexBuffer_ = 0;
+	indexCount_ = 0;
+	resolution_ = 0;
+	patches_ = false;
+}
+
+void TerrainPatch::draw(const StreamingAllocation& chunks, const uint32 chunkCount)
+{
+	if (!valid()) throw std::runtime_error("Cannot draw terrain patch - terrain patch was not created.");
+
+	if (chunkCount == 0) return;
+
+	glBindVertexArray(vertexArray_);
+
+	glBindBuffer(GL_ARRAY_BUFFER, chunks.buffer);
+	glVertexAttribPointer(CHUNK_ATTRIBUTE_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(TerrainChunk), (GLvoid*)(chunks.offset + offsetof(TerrainChunk, offset)));
+	glVertexAttribPointer(MORPH_RANGE_ATTRIBUTE_LOCATION, 2, GL_FLOAT, GL_FALSE, sizeof(TerrainChunk), (GLvoid*)(chunks.offset + offsetof(TerrainChunk, morphRange)));
+
+	if (patches_)
+	{
+		glPatchParameteri(GL_PATCH_VERTICES, 4);
+		glDrawElementsInstanced(GL_PATCHES, indexCount_, GL_UNSIGNED_SHORT, (GLvoid*)0, static_cast<GLsizei>(chunkCount));
+	}
+	else
+	{
+		glDrawElementsInstanced(GL_TRIANGLES, indexCount_, GL_UNSIGNED_SHORT, (GLvoid*)0, static_cast<GLsizei>(chunkCount));
+	}
+
+	glBindVertexArray(0);
+}
+
+uint32 TerrainPatch::resolution() const
+{
+	return resolution_;
+}
+
+bool TerrainPatch::patches() const
+{
+	return patches_;
+}
+
+bool TerrainPatch::valid() const
+{
+	return (vertexArray_ != 0);
+}
+
+}
+}
+}
+}
@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "gl33/TerrainQuadtree.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+namespace
+{
+
+// Fraction of a level's range after which its vertices start morphing into the next level
+constexpr float32 MORPH_START = 0.7f;
+
+}
+
+TerrainQuadtree::TerrainQuadtree(
+	const uint32 width,
+	const uint32 height,
+	const uint32 chunkResolution,
+	const uint32 lodCount,
+	const float32 detailDistance,
+	const float32 minimumHeight,
+	const float32 maximumHeight
+)
+	:
+	width_(width),
+	height_(height),
+	chunkResolution_(chunkResolution),
+	minimumHeight_(minimumHeight),
+	maximumHeight_(maximumHeight)
+{
+	if (chunkResolution == 0 || chunkResolution % 2 != 0) throw std::runtime_error("Terrain chunk resolution must be even.");
+	if (lodCount == 0) throw std::runtime_error("Terrain must have at least one level of detail.");
+
+	if (!(detailDistance > 0.0f)) throw std::runtime_error("Terrain detail distance must be positive.");
+
+	lodRanges_.resize(lodCount);
+	lodRanges_[0] = detailDistance;
+
+	for (uint32 lod = 1; lod < lodCount; ++lod)
+	{
+		// A node of the finer level is selected while its box is within that level's range, so its farthest vertex can be
+		// up to the box diagonal beyond it. That vertex must still be outside of the range where this level starts
+		// morphing, or it would meet a neighbour of this level that is morphing already, and crack
+		const float32 size = static_cast<float32>((2 * chunkResolution_) << (lod - 1));
+		const float32 diagonal = glm::length(glm::vec3(size, maximumHeight_ - minimumHeight_, size));
+
+		lodRanges_[lod] = std::max(lodRanges_[lod - 1] * 2.0f, lodRanges_[lod - 1] + diagonal / MORPH_START);
+	}
+}
+
+uint32 TerrainQuadtree::select(const glm::vec3& cameraPosition, const Frustum& frustum, const glm::mat4& modelMatrix, std::vector<TerrainChunk>& chunks) const
+{
+	if (lodRanges_.empty()) return 0;
+
+	Selection selection;
+	selection.cameraPosition = cameraPosition;
+	selection.frustum = &frustum;
+	selection.modelMatrix = &modelMatrix;
+	selection.chunks = &chunks;
+	selection.culled = 0;
+
+	const uint32 rootLod = lodCount() - 1;
+	const uint32 rootSize = (2 * chunkResolution_) << rootLod;
+
+	// The quads of the grid end one sample before the edge of the height map
+	for (uint32 z = 0; z + 1 < height_; z += rootSize)
+	{
+		for (uint32 x = 0; x + 1 < width_; x += rootSize)
+		{
+			// Roots out of range of the coarsest level are still drawn at that level
+			if (!select(x, z, rootLod, selection))
+			{
+				addNode(x, z, rootLod, selection);
+			}
+		}
+	}
+
+	return selection.culled;
+}
+
+uint32 TerrainQuadtree::tile(const uint32 tileSize, const Frustum& frustum, const glm::mat4& modelMatrix, std::vector<TerrainChunk>& chunks) const
+{
+	if (tileSize == 0) throw std::runtime_error("Terrain tile size must not be zero.");
+
+	uint32 culled = 0;
+
+	for (uint32 z = 0; z + 1 < height_; z += tileSize)
+	{
+		for (uint32 x = 0; x + 1 < width_; x += tileSize)
+		{
+			if (!visible(x, z, tileSize, frustum, modelMatrix))
+			{
+				++culled;
+				continue;
+			}
+
+			TerrainChunk chunk;
+			chunk.offset = glm::vec2(x, z);
+			chunk.size = static_cast<float32>(tileSize);
+
+			chunks.push_back(chunk);
+		}
+	}
+
+	return culled;
+}
+
+float32 TerrainQuadtree::lodRange(const uint32 lod) const
+{
+	return lodRanges_[lod];
+}
+
+uint32 TerrainQuadtree::lodCount() const
+{
+	return static_cast<uint32>(lodRanges_.size());
+}
+
+uint32 TerrainQuadtree::chunkResolution() const
+{
+	return chunkResolution_;
+}
+
+bool TerrainQuadtree::select(const uint32 x, const uint32 z, const uint32 lod, Selection& selection) const
+{
+	// Nothing to draw beyond the edge of the height map
+	if (x + 1 >= width_ || z + 1 >= height_) return true;
+
+	const uint32 size = (2 * chunkResolution_) << lod;
+
+	// Out of range of this level, the parent draws the area at its own level
+	if (!inRange(x, z, size, selection.cameraPosition, lodRanges_[lod])) return false;
+
+	if (!visible(x, z, size, *selection.frustum, *selection.modelMatrix))
+	{
+		++selection.culled;
+
+		// Handled, there is nothing visible to draw
+		return true;
+	}
+
+	if (lod == 0 || !inRange(x, z, size, selection.cameraPosition, lodRanges_[lod - 1]))
+	{
+		addNode(x, z, lod, selection);
+
+		return true;
+	}
+
+	const uint32 childSize = size / 2;
+
+	for (uint32 i = 0; i < 4; ++i)
+	{
+		const uint32 childX = x + (i & 1) * childSize;
+		const uint32 childZ = z + (i >> 1) * childSize;
+
+		// Children out of range of the finer level are drawn as a quarter of this node, at this node's level
+		if (!select(childX, childZ, lod - 1, selection))
+		{
+			addChunk(childX, childZ, lod, selection);
+		}
+	}
+
+	return true;
+}
+
+void TerrainQuadtree::addChunk(const uint32 x, const uint32 z, const uint32 lod, Selection& selection) const
+{
+	if (x + 1 >= width_ || z + 1 >= height_) return;
+
+	const float32 previousRange = (lod > 0 ? lodRanges_[lod - 1] : 0.0f);
+
+	TerrainChunk chunk;
+	chunk.offset = glm::vec2(x, z);
+	chunk.size = static_cast<float32>(chunkResolution_ << lod);
+	chunk.lod = static_cast<float32>(lod);
+	chunk.morphRange = glm::vec2(previousRange + (lodRanges_[lod] - previousRange) * MORPH_START, lodRanges_[lod]);
+
+	selection.chunks->push_back(chunk);
+}
+
+void TerrainQuadtree::addNode(const uint32 x, const uint32 z, const uint32 lod, Selection& selection) const
+{
+	const uint32 chunkSize = chunkResolution_ << lod;
+
+	// A node is drawn as four chunks, so every chunk has the same number of quads
+	for (uint32 i = 0; i < 4; ++i)
+	{
+		addChunk(x + (i & 1) * chunkSize, z + (i >> 1) * chunkSize, lod, selection);
+	}
+}
+
+bool TerrainQuadtree::visible(const uint32 x, const uint32 z, const uint32 size, const Frustum& frustum, const glm::mat4& modelMatrix) const
+{
+	BoundingSphere bounds;
+	bounds.center = glm::vec3(x + size * 0.5f, (minimumHeight_ + maximumHeight_) * 0.5f, z + size * 0.5f);
+	bounds.radius = glm::length(glm::vec3(size * 0.5f, (maximumHeight_ - minimumHeight_) * 0.5f, size * 0.5f));
+
+	return intersects(frustum, transformBoundingSphere(bounds, modelMatrix));
+}
+
+bool TerrainQuadtree::inRange(const uint32 x, const uint32 z, const uint32 size, const glm::vec3& position, const float32 range) const
+{
+	// Distance from the position to the closest point of the node's box
+	const glm::vec3 minimum = glm::vec3(x, minimumHeight_, z);
+	const glm::vec3 maximum = glm::vec3(x + size, maximumHeight_, z + size);
+	const glm::vec3 closest = glm::min(glm::max(position, minimum), maximum);
+	const glm::vec3 delta = position - closest;
+
+	return glm::dot(delta, delta) <= range * range;
+}
+
+}
+}
+}
+}
@@ -0,0 +1,261 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <boost/interprocess/exceptions.hpp>
+
+#include "gl33/TerrainTileFile.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+namespace
+{
+
+constexpr char MAGIC[4] = {'I', 'T', 'T', 'F'};
+
+// Bytes per texel of the RGBA16 height and normal image and of the RGBA8 terrain map image
+constexpr uint32 HEIGHT_NORMAL_TEXEL_SIZE = 4 * sizeof(uint16);
+constexpr uint32 TERRAIN_MAP_TEXEL_SIZE = 4;
+
+/**
+ * Samples of the overview along a side of the terrain with size samples, enough for the last one to reach the edge.
+ */
+uint32 overviewSamples(const uint32 size, const uint32 step)
+{
+	return (size - 2) / step + 2;
+}
+
+/**
+ * Copies every step-th sample of the area of a whole terrain image starting at firstX, firstZ. Samples past the edge of
+ * the terrain repeat the last one.
+ */
+void copySamples(
+	const byte* image,
+	const uint32 texelSize,
+	const uint32 width,
+	const uint32 height,
+	const uint32 firstX,
+	const uint32 firstZ,
+	const uint32 samplesX,
+	const uint32 samplesZ,
+	const uint32 step,
+	std::vector<byte>& samples
+)
+{
+	samples.resize(samplesX * samplesZ * texelSize);
+
+	for (uint32 z = 0; z < samplesZ; ++z)
+	{
+		const uint32 sourceZ = std::min(firstZ + z * step, height - 1);
+
+		for (uint32 x = 0; x < samplesX; ++x)
+		{
+			const uint32 sourceX = std::min(firstX + x * step, width - 1);
+
+			std::memcpy(&samples[(z * samplesX + x) * texelSize], &image[(sourceZ * width + sourceX) * texelSize], texelSize);
+		}
+	}
+}
+
+}
+
+TerrainTileFile::TerrainTileFile(const std::string& filename)
+{
+	try
+	{
+		file_ = boost::interprocess::file_mapping(filename.c_str(), boost::interprocess::read_only);
+		region_ = boost::interprocess::mapped_region(file_, boost::interprocess::read_only);
+	}
+	catch (const boost::interprocess::interprocess_exception& e)
+	{
+		throw std::runtime_error("Could not open terrain tile file '" + filename + "': " + e.what());
+	}
+
+	const byte* data = static_cast<const byte*>(region_.get_address());
+	const size_t size = region_.get_size();
+
+	if (size < sizeof(header_)) throw std::runtime_error("'" + filename + "' is not a terrain tile file.");
+
+	std::memcpy(&header_, data, sizeof(header_));
+
+	if (std::memcmp(header_.magic, MAGIC, sizeof(MAGIC)) != 0)
+	{
+		throw std::runtime_error("'" + filename + "' is not a terrain tile file.");
+	}
+
+	if (header_.version != VERSION)
+	{
+		throw std::runtime_error("Terrain tile file '" + filename + "' has unsupported version " + std::to_string(header_.version) + ".");
+	}
+
+	if (header_.width < 2 || header_.height < 2 || header_.tileSize == 0 || header_.tileCountX == 0 || header_.tileCountZ == 0)
+	{
+		throw std::runtime_error("Terrain tile file '" + filename + "' has no tiles.");
+	}
+
+	if (header_.overviewStep == 0) throw std::runtime_error("Terrain tile file '" + filename + "' has no overview.");
+
+	const uint64 tileTableSize = static_cast<uint64>(tileCount()) * sizeof(uint64);
+	const uint64 overviewSize = static_cast<uint64>(overviewWidth()) * overviewHeight() * (HEIGHT_NORMAL_TEXEL_SIZE + TERRAIN_MAP_TEXEL_SIZE);
+
+	if (sizeof(header_) + tileTableSize + overviewSize > size)
+	{
+		throw std::runtime_error("Terrain tile file '" + filename + "' is truncated.");
+	}
+
+	// The header keeps the table 8 byte aligned, and the table the overview
+	tileOffsets_ = reinterpret_cast<const uint64*>(data + sizeof(header_));
+	overview_ = data + sizeof(header_) + tileTableSize;
+}
+
+void TerrainTileFile::read(const uint32 tile, std::vector<uint16>& heightNormal, std::vector<byte>& terrainMap) const
+{
+	if (tile >= tileCount()) throw std::runtime_error("Terrain tile " + std::to_string(tile) + " does not exist.");
+
+	const uint64 offset = tileOffsets_[tile];
+
+	if (offset > region_.get_size() || region_.get_size() - offset < tileHeightNormalSize() + tileTerrainMapSize())
+	{
+		throw std::runtime_error("Terrain tile " + std::to_string(tile) + " is outside of the file.");
+	}
+
+	// Pages the tile is on are faulted in here, on the thread doing the read
+	const byte* data = static_cast<const byte*>(region_.get_address()) + offset;
+
+	heightNormal.resize(tileHeightNormalSize() / sizeof(uint16));
+	std::memcpy(&heightNormal[0], data, tileHeightNormalSize());
+
+	data += tileHeightNormalSize();
+	terrainMap.assign(data, data + tileTerrainMapSize());
+}
+
+const TerrainTileFileHeader& TerrainTileFile::header() const
+{
+	return header_;
+}
+
+uint32 TerrainTileFile::tileCount() const
+{
+	return header_.tileCountX * header_.tileCountZ;
+}
+
+uint32 TerrainTileFile::tileSamples() const
+{
+	return header_.tileSize + 1;
+}
+
+size_t TerrainTileFile::tileHeightNormalSize() const
+{
+	return static_cast<size_t>(tileSamples()) * tileSamples() * HEIGHT_NORMAL_TEXEL_SIZE;
+}
+
+size_t TerrainTileFile::tileTerrainMapSize() const
+{
+	return static_cast<size_t>(tileSamples()) * tileSamples() * TERRAIN_MAP_TEXEL_SIZE;
+}
+
+uint32 TerrainTileFile::overviewWidth() const
+{
+	return overviewSamples(header_.width, header_.overviewStep);
+}
+
+uint32 TerrainTileFile::overviewHeight() const
+{
+	return overviewSamples(header_.height, header_.overviewStep);
+}
+
+const uint16* TerrainTileFile::overviewHeightNormal() const
+{
+	return reinterpret_cast<const uint16*>(overview_);
+}
+
+const byte* TerrainTileFile::overviewTerrainMap() const
+{
+	return overview_ + static_cast<size_t>(overviewWidth()) * overviewHeight() * HEIGHT_NORMAL_TEXEL_SIZE;
+}
+
+void TerrainTileFile::write(
+	const std::string& filename,
+	const uint32 width,
+	const uint32 height,
+	const uint32 tileSize,
+	const uint16* heightNormal,
+	const byte* terrainMap
+)
+{
+	if (width < 2 || height < 2) throw std::runtime_error("Terrain must have at least 2 x 2 samples.");
+	if (tileSize == 0) throw std::runtime_error("Terrain tile size must not be zero.");
+
+	std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+
+	if (!file) throw std::runtime_error("Could not create terrain tile file '" + filename + "'.");
+
+	TerrainTileFileHeader header;
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.width = width;
+	header.height = height;
+	header.tileSize = tileSize;
+	header.tileCountX = (width - 2) / tileSize + 1;
+	header.tileCountZ = (height - 2) / tileSize + 1;
+	header.overviewStep = 1;
+
+	while (overviewSamples(std::max(width, height), header.overviewStep) > OVERVIEW_MAX_SAMPLES)
+	{
+		header.overviewStep *= 2;
+	}
+
+	const uint32 tileCount = header.tileCountX * header.tileCountZ;
+	const uint32 samples = tileSize + 1;
+	const uint32 overviewWidth = overviewSamples(width, header.overviewStep);
+	const uint32 overviewHeight = overviewSamples(height, header.overviewStep);
+	const uint64 tileRecordSize = static_cast<uint64>(samples) * samples * (HEIGHT_NORMAL_TEXEL_SIZE + TERRAIN_MAP_TEXEL_SIZE);
+	const uint64 overviewSize = static_cast<uint64>(overviewWidth) * overviewHeight * (HEIGHT_NORMAL_TEXEL_SIZE + TERRAIN_MAP_TEXEL_SIZE);
+	const uint64 firstTileOffset = sizeof(header) + tileCount * sizeof(uint64) + overviewSize;
+
+	std::vector<uint64> tileOffsets(tileCount);
+
+	for (uint32 i = 0; i < tileCount; ++i)
+	{
+		tileOffsets[i] = firstTileOffset + i * tileRecordSize;
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(&tileOffsets[0]), tileOffsets.size() * sizeof(uint64));
+
+	const byte* heightNormalImage = reinterpret_cast<const byte*>(heightNormal);
+	std::vector<byte> image;
+
+	copySamples(heightNormalImage, HEIGHT_NORMAL_TEXEL_SIZE, width, height, 0, 0, overviewWidth, overviewHeight, header.overviewStep, image);
+	file.write(reinterpret_cast<const char*>(&image[0]), image.size());
+
+	copySamples(terrainMap, TERRAIN_MAP_TEXEL_SIZE, width, height, 0, 0, overviewWidth, overviewHeight, header.overviewStep, image);
+	file.write(reinterpret_cast<const char*>(&image[0]), image.size());
+
+	for (uint32 tileZ = 0; tileZ < header.tileCountZ; ++tileZ)
+	{
+		for (uint32 tileX = 0; tileX < header.tileCountX; ++tileX)
+		{
+			copySamples(heightNormalImage, HEIGHT_NORMAL_TEXEL_SIZE, width, height, tileX * tileSize, tileZ * tileSize, samples, samples, 1, image);
+			file.write(reinterpret_cast<const char*>(&image[0]), image.size());
+
+			copySamples(terrainMap, TERRAIN_MAP_TEXEL_SIZE, width, height, tileX * tileSize, tileZ * tileSize, samples, samples, 1, image);
+			file.write(reinterpret_cast<const char*>(&image[0]), image.size());
+		}
+	}
+
+	if (!file) throw std::runtime_error("Could not write terrain tile file '" + filename + "'.");
+}
+
+}
+}
+}
+}
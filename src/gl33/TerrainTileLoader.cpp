@@ -0,0 +1,131 @@
+#include <stdexcept>
+#include <utility>
+
+#include "gl33/TerrainTileLoader.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+TerrainTileLoader::TerrainTileLoader(const std::string& filename) : file_(filename), thread_(&TerrainTileLoader::run, this)
+{
+}
+
+TerrainTileLoader::~TerrainTileLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+
+	condition_.notify_one();
+	thread_.join();
+}
+
+void TerrainTileLoader::request(const uint32 tile)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		requests_.push_back(tile);
+	}
+
+	condition_.notify_one();
+}
+
+bool TerrainTileLoader::pop(TerrainTile& tile)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	if (loaded_.empty()) return false;
+
+	tile = std::move(loaded_.front());
+	loaded_.pop_front();
+
+	return true;
+}
+
+const TerrainTileFileHeader& TerrainTileLoader::header() const
+{
+	// Written once by the constructor, safe to read from any thread
+	return file_.header();
+}
+
+uint32 TerrainTileLoader::tileSamples() const
+{
+	return file_.tileSamples();
+}
+
+size_t TerrainTileLoader::tileHeightNormalSize() const
+{
+	return file_.tileHeightNormalSize();
+}
+
+size_t TerrainTileLoader::tileTerrainMapSize() const
+{
+	return file_.tileTerrainMapSize();
+}
+
+uint32 TerrainTileLoader::overviewWidth() const
+{
+	return file_.overviewWidth();
+}
+
+uint32 TerrainTileLoader::overviewHeight() const
+{
+	return file_.overviewHeight();
+}
+
+const uint16* TerrainTileLoader::overviewHeightNormal() const
+{
+	// The mapping is read only, safe to read from any thread
+	return file_.overviewHeightNormal();
+}
+
+const byte* TerrainTileLoader::overviewTerrainMap() const
+{
+	return file_.overviewTerrainMap();
+}
+
+void TerrainTileLoader::run()
+{
+	TerrainTile tile;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			condition_.wait(lock, [this]() { return stop_ || !requests_.empty(); });
+
+			if (stop_) return;
+
+			tile.index = requests_.front();
+			requests_.pop_front();
+		}
+
+		try
+		{
+			file_.read(tile.index, tile.heightNormal, tile.terrainMap);
+		}
+		catch (const std::runtime_error&)
+		{
+			// The render thread sees the empty tile and stops asking for it
+			tile.heightNormal.clear();
+			tile.terrainMap.clear();
+		}
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		loaded_.push_back(std::move(tile));
+
+		tile = TerrainTile();
+	}
+}
+
+}
+}
+}
+}
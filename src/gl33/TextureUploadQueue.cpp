@@ -0,0 +1,274 @@
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "gl33/TextureUploadQueue.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+namespace
+{
+
+// Staging buffers are at least this large and rounded up to a power of two, so images of similar size share them
+constexpr GLsizeiptr MIN_STAGING_BUFFER_SIZE = 64 * 1024;
+
+// Total capacity of the staging buffers kept for reuse, larger ones are deleted when released
+constexpr GLsizeiptr MAX_FREE_STAGING_BYTES = 64 * 1024 * 1024;
+
+}
+
+TextureUploadQueue::~TextureUploadQueue()
+{
+	if (valid())
+	{
+		destroy();
+	}
+}
+
+void TextureUploadQueue::generate()
+{
+	if (valid()) throw std::runtime_error("Cannot generate texture upload queue - texture upload queue was already created.");
+
+	valid_ = true;
+}
+
+void TextureUploadQueue::destroy()
+{
+	if (!valid()) throw std::runtime_error("Cannot destroy texture upload queue - texture upload queue was not created.");
+
+	// Queued textures keep their placeholder
+	for (auto& upload : uploads_)
+	{
+		glDeleteBuffers(1, &upload.stagingBuffer.buffer);
+	}
+
+	uploads_.clear();
+
+	for (auto& transfer : transfers_)
+	{
+		glDeleteSync(transfer.fence);
+		glDeleteBuffers(1, &transfer.stagingBuffer.buffer);
+	}
+
+	transfers_.clear();
+
+	for (auto& stagingBuffer : freeStagingBuffers_)
+	{
+		glDeleteBuffers(1, &stagingBuffer.buffer);
+	}
+
+	freeStagingBuffers_.clear();
+	freeStagingBytes_ = 0;
+
+	valid_ = false;
+}
+
+void TextureUploadQueue::enqueue(
+	gl::Texture2d& texture,
+	const GLint internalFormat,
+	const GLenum format,
+	const GLenum type,
+	const GLvoid* data,
+	const std::vector<MipLevel>& levels,
+	const bool generateMipmap,
+	const glm::vec4& placeholder
+)
+{
+	if (!valid()) throw std::runtime_error("Cannot enqueue texture upload - texture upload queue was not created.");
+
+	texture.generate(internalFormat, 1, 1, GL_RGBA, GL_FLOAT, &placeholder[0], false);
+
+	Upload upload;
+	upload.texture = texture.id();
+	upload.internalFormat = internalFormat;
+	upload.format = format;
+	upload.type = type;
+	upload.size = static_cast<GLsizeiptr>(levels.back().offset + levels.back().size);
+	upload.levels = levels;
+	upload.generateMipmap = (generateMipmap && levels.size() == 1);
+
+	const GLsizeiptr size = upload.size;
+
+	upload.stagingBuffer = acquire(size);
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload.stagingBuffer.buffer);
+
+	// Pooled buffers are only reused after their fence signalled, so the driver must not synchronize
+	void* mappedData = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+	if (mappedData == nullptr)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		recycle(upload.stagingBuffer);
+
+		throw std::runtime_error("Could not map texture upload buffer.");
+	}
+
+	std::memcpy(mappedData, data, static_cast<size_t>(size));
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	// Left bound, every other texture upload would read from it
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	uploads_.push_back(std::move(upload));
+}
+
+GLsizeiptr TextureUploadQueue::process(const GLsizeiptr uploadBudget)
+{
+	if (!valid()) throw std::runtime_error("Cannot process texture uploads - texture upload queue was not created.");
+
+	release();
+
+	GLsizeiptr uploaded = 0;
+
+	// The first image may go over the budget, so images larger than the budget still make progress
+	while (!uploads_.empty() && (uploaded == 0 ? uploadBudget > 0 : uploaded + uploads_.front().size <= uploadBudget))
+	{
+		transfer(uploads_.front());
+		uploaded += uploads_.front().size;
+
+		uploads_.pop_front();
+	}
+
+	return uploaded;
+}
+
+uint32 TextureUploadQueue::pendingCount() const
+{
+	return static_cast<uint32>(uploads_.size() + transfers_.size());
+}
+
+bool TextureUploadQueue::valid() const
+{
+	return valid_;
+}
+
+void TextureUploadQueue::transfer(const Upload& upload)
+{
+	// Reads from the bound pixel unpack buffer instead of client memory, so the call returns without waiting for the copy
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload.stagingBuffer.buffer);
+	glBindTexture(GL_TEXTURE_2D, upload.texture);
+
+	if (upload.levels.size() > 1)
+	{
+		// Levels are tightly packed, rows of the small ones are not 4 byte aligned
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+		for (size_t i = 0; i < upload.levels.size(); ++i)
+		{
+			const auto& level = upload.levels[i];
+
+			// The data pointer is an offset into the pixel unpack buffer
+			gl::Texture2d::texImage2D(static_cast<GLint>(i), upload.internalFormat, level.width, level.height, upload.format, upload.type, reinterpret_cast<const GLvoid*>(level.offset));
+		}
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+	else
+	{
+		const auto& level = upload.levels[0];
+
+		gl::Texture2d::texImage2D(0, upload.internalFormat, level.width, level.height, upload.format, upload.type, nullptr);
+
+		if (upload.generateMipmap)
+		{
+			glGenerateMipmap(GL_TEXTURE_2D);
+		}
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	Transfer transfer;
+	transfer.stagingBuffer = upload.stagingBuffer;
+	transfer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	transfers_.push_back(transfer);
+}
+
+void TextureUploadQueue::release()
+{
+	// Fences signal in order, so stop at the first one still pending. Never waits, a buffer not released this frame
+	// is released in a later one
+	while (!transfers_.empty())
+	{
+		auto& transfer = transfers_.front();
+
+		if (glClientWaitSync(transfer.fence, 0, 0) == GL_TIMEOUT_EXPIRED) return;
+
+		glDeleteSync(transfer.fence);
+		recycle(transfer.stagingBuffer);
+
+		transfers_.pop_front();
+	}
+}
+
+TextureUploadQueue::StagingBuffer TextureUploadQueue::acquire(const GLsizeiptr size)
+{
+	auto best = freeStagingBuffers_.end();
+
+	for (auto it = freeStagingBuffers_.begin(); it != freeStagingBuffers_.end(); ++it)
+	{
+		if (it->capacity >= size && (best == freeStagingBuffers_.end() || it->capacity < best->capacity))
+		{
+			best = it;
+		}
+	}
+
+	if (best != freeStagingBuffers_.end())
+	{
+		const StagingBuffer stagingBuffer = *best;
+
+		freeStagingBytes_ -= stagingBuffer.capacity;
+		*best = freeStagingBuffers_.back();
+		freeStagingBuffers_.pop_back();
+
+		return stagingBuffer;
+	}
+
+	StagingBuffer stagingBuffer;
+	stagingBuffer.capacity = MIN_STAGING_BUFFER_SIZE;
+
+	while (stagingBuffer.capacity < size)
+	{
+		stagingBuffer.capacity *= 2;
+	}
+
+	glGenBuffers(1, &stagingBuffer.buffer);
+
+	if (stagingBuffer.buffer == 0)
+	{
+		throw std::runtime_error("Could not create texture upload buffer.");
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stagingBuffer.buffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, stagingBuffer.capacity, nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	return stagingBuffer;
+}
+
+void TextureUploadQueue::recycle(const StagingBuffer& stagingBuffer)
+{
+	if (freeStagingBytes_ + stagingBuffer.capacity > MAX_FREE_STAGING_BYTES)
+	{
+		glDeleteBuffers(1, &stagingBuffer.buffer);
+
+		return;
+	}
+
+	freeStagingBuffers_.push_back(stagingBuffer);
+	freeStagingBytes_ += stagingBuffer.capacity;
+}
+
+}
+}
+}
+}
@@ -0,0 +1,313 @@
+#include <cstring>
+
+#include "gl33/TransformStore.hpp"
+#include "gl33/Simd.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+namespace
+{
+
+/**
+ * Copies count floats, bypassing the cache where SSE2 is available. Callers fence once after a batch of copies.
+ */
+void streamFloats(float32* destination, const float32* source, const uint32 count)
+{
+	for (uint32 i = 0; i < count; ++i)
+	{
+#if defined(ICE_ENGINE_SSE2)
+		int32 value;
+		std::memcpy(&value, &source[i], sizeof(value));
+
+		_mm_stream_si32(reinterpret_cast<int32*>(&destination[i]), value);
+#else
+		destination[i] = source[i];
+#endif
+	}
+}
+
+}
+
+uint32 TransformStore::create(const glm::vec3& position, const glm::quat& orientation, const glm::vec3& scale)
+{
+	uint32 index = 0;
+
+	if (!freeIndices_.empty())
+	{
+		index = freeIndices_.back();
+		freeIndices_.pop_back();
+	}
+	else
+	{
+		index = static_cast<uint32>(positions_.size());
+
+		positions_.emplace_back();
+		orientations_.emplace_back();
+		scales_.emplace_back();
+		modelMatrices_.emplace_back(1.0f);
+		normalMatrices_.emplace_back(1.0f);
+		dirty_.push_back(0);
+	}
+
+	positions_[index] = position;
+	orientations_[index] = orientation;
+	scales_[index] = scale;
+
+	markDirty(index);
+
+	return index;
+}
+
+void TransformStore::destroy(const uint32 index)
+{
+	freeIndices_.push_back(index);
+}
+
+const glm::vec3& TransformStore::position(const uint32 index) const
+{
+	return positions_[index];
+}
+
+const glm::quat& TransformStore::orientation(const uint32 index) const
+{
+	return orientations_[index];
+}
+
+const glm::vec3& TransformStore::scale(const uint32 index) const
+{
+	return scales_[index];
+}
+
+void TransformStore::position(const uint32 index, const glm::vec3& position)
+{
+	positions_[index] = position;
+	markDirty(index);
+}
+
+void TransformStore::orientation(const uint32 index, const glm::quat& orientation)
+{
+	orientations_[index] = orientation;
+	markDirty(index);
+}
+
+void TransformStore::scale(const uint32 index, const glm::vec3& scale)
+{
+	scales_[index] = scale;
+	markDirty(index);
+}
+
+void TransformStore::set(const uint32 index, const glm::vec3& position, const glm::quat& orientation, const glm::vec3& scale)
+{
+	positions_[index] = position;
+	orientations_[index] = orientation;
+	scales_[index] = scale;
+	markDirty(index);
+}
+
+void TransformStore::set(
+	const uint32* indices,
+	const size_t count,
+	const StridedSpan<glm::vec3>& positions,
+	const StridedSpan<glm::quat>& orientations,
+	const StridedSpan<glm::vec3>& scales
+)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const uint32 index = indices[i];
+
+		// Copied component by component in storage order, whatever order glm keeps them in
+		if (!positions.empty()) streamFloats(reinterpret_cast<float32*>(&positions_[index]), reinterpret_cast<const float32*>(&positions[i]), 3);
+		if (!orientations.empty()) streamFloats(reinterpret_cast<float32*>(&orientations_[index]), reinterpret_cast<const float32*>(&orientations[i]), 4);
+		if (!scales.empty()) streamFloats(reinterpret_cast<float32*>(&scales_[index]), reinterpret_cast<const float32*>(&scales[i]), 3);
+
+		markDirty(index);
+	}
+
+#if defined(ICE_ENGINE_SSE2)
+	// Non-temporal stores are weakly ordered, make them visible before the matrices are rebuilt from them
+	_mm_sfence();
+#endif
+}
+
+void TransformStore::update()
+{
+	size_t i = 0;
+
+#if defined(ICE_ENGINE_SSE2)
+	// Four dirty entries per iteration, gathered into one register per component, which is the same math as the scalar
+	// loop below with every lane holding a different entry
+	for (; i + 4 <= dirtyIndices_.size(); i += 4)
+	{
+		const uint32* indices = &dirtyIndices_[i];
+
+		const auto& p0 = positions_[indices[0]];
+		const auto& p1 = positions_[indices[1]];
+		const auto& p2 = positions_[indices[2]];
+		const auto& p3 = positions_[indices[3]];
+		const auto& q0 = orientations_[indices[0]];
+		const auto& q1 = orientations_[indices[1]];
+		const auto& q2 = orientations_[indices[2]];
+		const auto& q3 = orientations_[indices[3]];
+		const auto& s0 = scales_[indices[0]];
+		const auto& s1 = scales_[indices[1]];
+		const auto& s2 = scales_[indices[2]];
+		const auto& s3 = scales_[indices[3]];
+
+		const __m128 x = _mm_set_ps(q3.x, q2.x, q1.x, q0.x);
+		const __m128 y = _mm_set_ps(q3.y, q2.y, q1.y, q0.y);
+		const __m128 z = _mm_set_ps(q3.z, q2.z, q1.z, q0.z);
+		const __m128 w = _mm_set_ps(q3.w, q2.w, q1.w, q0.w);
+		const __m128 sx = _mm_set_ps(s3.x, s2.x, s1.x, s0.x);
+		const __m128 sy = _mm_set_ps(s3.y, s2.y, s1.y, s0.y);
+		const __m128 sz = _mm_set_ps(s3.z, s2.z, s1.z, s0.z);
+
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 two = _mm_set1_ps(2.0f);
+		const __m128 zero = _mm_setzero_ps();
+
+		const __m128 xx = _mm_mul_ps(x, x);
+		const __m128 yy = _mm_mul_ps(y, y);
+		const __m128 zz = _mm_mul_ps(z, z);
+		const __m128 xy = _mm_mul_ps(x, y);
+		const __m128 xz = _mm_mul_ps(x, z);
+		const __m128 yz = _mm_mul_ps(y, z);
+		const __m128 wx = _mm_mul_ps(w, x);
+		const __m128 wy = _mm_mul_ps(w, y);
+		const __m128 wz = _mm_mul_ps(w, z);
+
+		// Rotation matrix columns r0, r1 and r2, one component per register
+		const __m128 r00 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)));
+		const __m128 r01 = _mm_mul_ps(two, _mm_add_ps(xy, wz));
+		const __m128 r02 = _mm_mul_ps(two, _mm_sub_ps(xz, wy));
+		const __m128 r10 = _mm_mul_ps(two, _mm_sub_ps(xy, wz));
+		const __m128 r11 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)));
+		const __m128 r12 = _mm_mul_ps(two, _mm_add_ps(yz, wx));
+		const __m128 r20 = _mm_mul_ps(two, _mm_add_ps(xz, wy));
+		const __m128 r21 = _mm_mul_ps(two, _mm_sub_ps(yz, wx));
+		const __m128 r22 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+
+		// Zero scales divide to infinity, the mask turns them into the zero the scalar loop uses
+		const __m128 inverseSx = _mm_and_ps(_mm_div_ps(one, sx), _mm_cmpneq_ps(sx, zero));
+		const __m128 inverseSy = _mm_and_ps(_mm_div_ps(one, sy), _mm_cmpneq_ps(sy, zero));
+		const __m128 inverseSz = _mm_and_ps(_mm_div_ps(one, sz), _mm_cmpneq_ps(sz, zero));
+
+		// The matrices are not laid out by component, so go through memory to scatter the lanes
+		alignas(16) float32 model[9][4];
+		alignas(16) float32 normal[9][4];
+
+		_mm_store_ps(model[0], _mm_mul_ps(r00, sx));
+		_mm_store_ps(model[1], _mm_mul_ps(r01, sx));
+		_mm_store_ps(model[2], _mm_mul_ps(r02, sx));
+		_mm_store_ps(model[3], _mm_mul_ps(r10, sy));
+		_mm_store_ps(model[4], _mm_mul_ps(r11, sy));
+		_mm_store_ps(model[5], _mm_mul_ps(r12, sy));
+		_mm_store_ps(model[6], _mm_mul_ps(r20, sz));
+		_mm_store_ps(model[7], _mm_mul_ps(r21, sz));
+		_mm_store_ps(model[8], _mm_mul_ps(r22, sz));
+
+		_mm_store_ps(normal[0], _mm_mul_ps(r00, inverseSx));
+		_mm_store_ps(normal[1], _mm_mul_ps(r01, inverseSx));
+		_mm_store_ps(normal[2], _mm_mul_ps(r02, inverseSx));
+		_mm_store_ps(normal[3], _mm_mul_ps(r10, inverseSy));
+		_mm_store_ps(normal[4], _mm_mul_ps(r11, inverseSy));
+		_mm_store_ps(normal[5], _mm_mul_ps(r12, inverseSy));
+		_mm_store_ps(normal[6], _mm_mul_ps(r20, inverseSz));
+		_mm_store_ps(normal[7], _mm_mul_ps(r21, inverseSz));
+		_mm_store_ps(normal[8], _mm_mul_ps(r22, inverseSz));
+
+		const glm::vec3* positions[4] = {&p0, &p1, &p2, &p3};
+
+		for (uint32 lane = 0; lane < 4; ++lane)
+		{
+			const uint32 index = indices[lane];
+
+			auto& modelMatrix = modelMatrices_[index];
+			modelMatrix[0] = glm::vec4(model[0][lane], model[1][lane], model[2][lane], 0.0f);
+			modelMatrix[1] = glm::vec4(model[3][lane], model[4][lane], model[5][lane], 0.0f);
+			modelMatrix[2] = glm::vec4(model[6][lane], model[7][lane], model[8][lane], 0.0f);
+			modelMatrix[3] = glm::vec4(*positions[lane], 1.0f);
+
+			auto& normalMatrix = normalMatrices_[index];
+			normalMatrix[0] = glm::vec3(normal[0][lane], normal[1][lane], normal[2][lane]);
+			normalMatrix[1] = glm::vec3(normal[3][lane], normal[4][lane], normal[5][lane]);
+			normalMatrix[2] = glm::vec3(normal[6][lane], normal[7][lane], normal[8][lane]);
+
+			dirty_[index] = 0;
+		}
+	}
+#endif
+
+	// The remainder, or every entry without SSE2
+	for (; i < dirtyIndices_.size(); ++i)
+	{
+		const uint32 index = dirtyIndices_[i];
+
+		const glm::vec3& p = positions_[index];
+		const glm::quat& q = orientations_[index];
+		const glm::vec3& s = scales_[index];
+
+		// Rotation matrix columns of the (unit) quaternion, the same as glm::mat3_cast
+		const float32 xx = q.x * q.x;
+		const float32 yy = q.y * q.y;
+		const float32 zz = q.z * q.z;
+		const float32 xy = q.x * q.y;
+		const float32 xz = q.x * q.z;
+		const float32 yz = q.y * q.z;
+		const float32 wx = q.w * q.x;
+		const float32 wy = q.w * q.y;
+		const float32 wz = q.w * q.z;
+
+		const glm::vec3 r0 = glm::vec3(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy));
+		const glm::vec3 r1 = glm::vec3(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx));
+		const glm::vec3 r2 = glm::vec3(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy));
+
+		// translate * rotate * scale
+		auto& model = modelMatrices_[index];
+		model[0] = glm::vec4(r0 * s.x, 0.0f);
+		model[1] = glm::vec4(r1 * s.y, 0.0f);
+		model[2] = glm::vec4(r2 * s.z, 0.0f);
+		model[3] = glm::vec4(p, 1.0f);
+
+		// inverse(transpose(R * S)) == R * inverse(S), so no general inverse is needed
+		auto& normal = normalMatrices_[index];
+		normal[0] = r0 * (s.x != 0.0f ? 1.0f / s.x : 0.0f);
+		normal[1] = r1 * (s.y != 0.0f ? 1.0f / s.y : 0.0f);
+		normal[2] = r2 * (s.z != 0.0f ? 1.0f / s.z : 0.0f);
+
+		dirty_[index] = 0;
+	}
+
+	dirtyIndices_.clear();
+}
+
+const glm::mat4& TransformStore::modelMatrix(const uint32 index) const
+{
+	return modelMatrices_[index];
+}
+
+const glm::mat3& TransformStore::normalMatrix(const uint32 index) const
+{
+	return normalMatrices_[index];
+}
+
+void TransformStore::markDirty(const uint32 index)
+{
+	if (dirty_[index] == 0)
+	{
+		dirty_[index] = 1;
+		dirtyIndices_.push_back(index);
+	}
+}
+
+}
+}
+}
+}
@@ -0,0 +1,147 @@
+#include <limits>
+
+#include <glm/gtc/packing.hpp>
+
+#include "gl33/VertexFormat.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+namespace
+{
+
+int16 packSnorm16(const float32 value)
+{
+	return static_cast<int16>(glm::packSnorm1x16(value));
+}
+
+uint8 packUnorm8(const float32 value)
+{
+	return static_cast<uint8>(glm::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+}
+
+size_t vertexSize(const VertexFormat vertexFormat)
+{
+	return (vertexFormat == VertexFormat::COMPACT ? sizeof(CompactVertex) : sizeof(FloatVertex));
+}
+
+std::vector<FloatVertex> floatVertices(
+	const std::vector<glm::vec3>& vertices,
+	const std::vector<glm::vec4>& colors,
+	const std::vector<glm::vec3>& normals,
+	const std::vector<glm::vec2>& textureCoordinates
+)
+{
+	std::vector<FloatVertex> result(vertices.size());
+
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		auto& vertex = result[i];
+
+		vertex.position = vertices[i];
+		vertex.color = (i < colors.size() ? colors[i] : glm::vec4(0.0f));
+		vertex.normal = (i < normals.size() ? normals[i] : glm::vec3(0.0f));
+		vertex.textureCoordinate = (i < textureCoordinates.size() ? textureCoordinates[i] : glm::vec2(0.0f));
+	}
+
+	return result;
+}
+
+glm::vec2 octahedralEncode(const glm::vec3& normal)
+{
+	const float32 sum = glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z);
+
+	if (sum == 0.0f)
+	{
+		return glm::vec2(0.0f);
+	}
+
+	const glm::vec3 n = normal / sum;
+
+	if (n.z >= 0.0f)
+	{
+		return glm::vec2(n.x, n.y);
+	}
+
+	// Fold the lower hemisphere over the diagonals
+	return glm::vec2(
+		(1.0f - glm::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+		(1.0f - glm::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f)
+	);
+}
+
+CompactVertices compactVertices(
+	const std::vector<glm::vec3>& vertices,
+	const std::vector<glm::vec4>& colors,
+	const std::vector<glm::vec3>& normals,
+	const std::vector<glm::vec2>& textureCoordinates
+)
+{
+	CompactVertices result;
+
+	if (vertices.empty())
+	{
+		return result;
+	}
+
+	glm::vec3 minimum = glm::vec3(std::numeric_limits<float32>::max());
+	glm::vec3 maximum = glm::vec3(std::numeric_limits<float32>::lowest());
+
+	for (const auto& v : vertices)
+	{
+		minimum = glm::min(minimum, v);
+		maximum = glm::max(maximum, v);
+	}
+
+	result.positionBias = (minimum + maximum) * 0.5f;
+	result.positionScale = (maximum - minimum) * 0.5f;
+
+	// Flat axes quantize to zero rather than dividing by zero
+	glm::vec3 inverseScale;
+	for (int i = 0; i < 3; ++i)
+	{
+		inverseScale[i] = (result.positionScale[i] > 0.0f ? 1.0f / result.positionScale[i] : 0.0f);
+	}
+
+	result.vertices.resize(vertices.size());
+
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		auto& vertex = result.vertices[i];
+
+		const glm::vec3 position = (vertices[i] - result.positionBias) * inverseScale;
+		vertex.position[0] = packSnorm16(position.x);
+		vertex.position[1] = packSnorm16(position.y);
+		vertex.position[2] = packSnorm16(position.z);
+		vertex.position[3] = 0;
+
+		const glm::vec2 normal = octahedralEncode(i < normals.size() ? normals[i] : glm::vec3(0.0f, 0.0f, 1.0f));
+		vertex.normal[0] = packSnorm16(normal.x);
+		vertex.normal[1] = packSnorm16(normal.y);
+
+		const glm::vec4 color = (i < colors.size() ? colors[i] : glm::vec4(0.0f));
+		vertex.color[0] = packUnorm8(color.r);
+		vertex.color[1] = packUnorm8(color.g);
+		vertex.color[2] = packUnorm8(color.b);
+		vertex.color[3] = packUnorm8(color.a);
+
+		const glm::vec2 textureCoordinate = (i < textureCoordinates.size() ? textureCoordinates[i] : glm::vec2(0.0f));
+		vertex.textureCoordinate[0] = glm::packHalf1x16(textureCoordinate.x);
+		vertex.textureCoordinate[1] = glm::packHalf1x16(textureCoordinate.y);
+	}
+
+	return result;
+}
+
+}
+}
+}
+}
@@ -0,0 +1,153 @@
+#include <algorithm>
+
+#include "gl33/WorkerPool.hpp"
+
+namespace ice_engine
+{
+namespace graphics
+{
+namespace opengl_renderer
+{
+namespace gl33
+{
+
+WorkerPool::WorkerPool(const uint32 threadCount)
+{
+	const uint32 count = (threadCount > 0 ? threadCount : std::max(std::thread::hardware_concurrency(), 1u));
+
+	threads_.reserve(count - 1);
+
+	try
+	{
+		for (uint32 i = 1; i < count; ++i)
+		{
+			threads_.emplace_back(&WorkerPool::work, this);
+		}
+	}
+	catch (...)
+	{
+		// Destroying a joinable thread terminates, so the workers started so far are stopped first
+		stop();
+		throw;
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	stop();
+}
+
+void WorkerPool::run(const uint32 jobCount, const std::function<void(const uint32)>& job)
+{
+	// Nothing to share, and exceptions propagate directly
+	if (threads_.empty() || jobCount <= 1)
+	{
+		for (uint32 i = 0; i < jobCount; ++i)
+		{
+			job(i);
+		}
+
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(mutex_);
+
+	job_ = &job;
+	jobCount_ = jobCount;
+	nextJob_ = 0;
+	unfinishedJobs_ = jobCount;
+	exception_ = nullptr;
+
+	jobsAvailable_.notify_all();
+
+	runJobs(lock);
+
+	jobsFinished_.wait(lock, [this]() { return unfinishedJobs_ == 0; });
+
+	job_ = nullptr;
+	jobCount_ = 0;
+	nextJob_ = 0;
+
+	if (exception_)
+	{
+		std::exception_ptr exception = nullptr;
+		std::swap(exception, exception_);
+
+		std::rethrow_exception(exception);
+	}
+}
+
+uint32 WorkerPool::threadCount() const
+{
+	return static_cast<uint32>(threads_.size() + 1);
+}
+
+void WorkerPool::work()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+
+	while (true)
+	{
+		jobsAvailable_.wait(lock, [this]() { return stop_ || nextJob_ < jobCount_; });
+
+		if (stop_) return;
+
+		runJobs(lock);
+	}
+}
+
+void WorkerPool::runJobs(std::unique_lock<std::mutex>& lock)
+{
+	while (nextJob_ < jobCount_)
+	{
+		const uint32 index = nextJob_++;
+		const auto& job = *job_;
+
+		lock.unlock();
+
+		std::exception_ptr exception = nullptr;
+
+		try
+		{
+			job(index);
+		}
+		catch (...)
+		{
+			exception = std::current_exception();
+		}
+
+		lock.lock();
+
+		if (exception && !exception_)
+		{
+			exception_ = exception;
+		}
+
+		if (--unfinishedJobs_ == 0)
+		{
+			jobsFinished_.notify_one();
+		}
+	}
+}
+
+void WorkerPool::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+
+	jobsAvailable_.notify_all();
+
+	for (auto& thread : threads_)
+	{
+		thread.join();
+	}
+
+	threads_.clear();
+}
+
+}
+}
+}
+}
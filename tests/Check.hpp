@@ -0,0 +1,20 @@
+#ifndef CHECK_TESTS_H_
+#define CHECK_TESTS_H_
+
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ * Fails the test when condition is false. Unlike assert() it is not compiled out of release builds.
+ */
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			std::exit(EXIT_FAILURE); \
+		} \
+	} while (false)
+
+#endif /* CHECK_TESTS_H_ */
@@ -0,0 +1,211 @@
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "gl33/BoneFormat.hpp"
+
+#include "../Check.hpp"
+
+using namespace ice_engine;
+using namespace ice_engine::graphics::opengl_renderer::gl33;
+
+namespace
+{
+
+const float32 EPSILON = 1e-5f;
+
+bool near(const glm::vec4& a, const glm::vec4& b)
+{
+	return std::abs(a.x - b.x) < EPSILON && std::abs(a.y - b.y) < EPSILON && std::abs(a.z - b.z) < EPSILON && std::abs(a.w - b.w) < EPSILON;
+}
+
+bool near(const glm::vec3& a, const glm::vec3& b)
+{
+	return near(glm::vec4(a, 0.0f), glm::vec4(b, 0.0f));
+}
+
+/**
+ * Bones with varied rotations, some of them scaled, so every branch of the quaternion conversion is taken.
+ */
+std::vector<glm::mat4> makeBones(const size_t count)
+{
+	const glm::vec3 axes[] = {
+		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+		glm::normalize(glm::vec3(1.0f, 2.0f, 3.0f)), glm::normalize(glm::vec3(-3.0f, 1.0f, 0.5f))
+	};
+
+	std::vector<glm::mat4> bones;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const float32 angle = 0.3f + 0.9f * static_cast<float32>(i);
+		glm::mat4 bone = glm::mat4_cast(glm::angleAxis(angle, axes[i % 5]));
+
+		if (i % 3 == 1)
+		{
+			const float32 scale = 1.0f + 0.5f * static_cast<float32>(i);
+
+			bone[0] = bone[0] * scale;
+			bone[1] = bone[1] * scale;
+			bone[2] = bone[2] * scale;
+			bone[0].w = bone[1].w = bone[2].w = 0.0f;
+		}
+
+		bone[3] = glm::vec4(static_cast<float32>(i), -2.0f * static_cast<float32>(i), 0.5f, 1.0f);
+		bones.push_back(bone);
+	}
+
+	return bones;
+}
+
+void testFormats()
+{
+	CHECK(texelsPerBone(BoneFormat::MAT4) == 4);
+	CHECK(texelsPerBone(BoneFormat::MAT3X4) == 3);
+	CHECK(texelsPerBone(BoneFormat::DUAL_QUATERNION) == 2);
+
+	CHECK(std::strcmp(boneFormatName(BoneFormat::MAT4), "mat4") == 0);
+	CHECK(std::strcmp(boneFormatName(BoneFormat::MAT3X4), "mat3x4") == 0);
+	CHECK(std::strcmp(boneFormatName(BoneFormat::DUAL_QUATERNION), "dualQuaternion") == 0);
+}
+
+void testAppend()
+{
+	const auto bones = makeBones(3);
+
+	for (const auto boneFormat : {BoneFormat::MAT4, BoneFormat::MAT3X4, BoneFormat::DUAL_QUATERNION})
+	{
+		std::vector<glm::vec4> texels = {glm::vec4(7.0f)};
+
+		packBones(bones.data(), 0, boneFormat, texels);
+		CHECK(texels.size() == 1);
+
+		packBones(bones.data(), bones.size(), boneFormat, texels);
+		CHECK(texels.size() == 1 + bones.size() * texelsPerBone(boneFormat));
+		CHECK(texels[0] == glm::vec4(7.0f));
+	}
+}
+
+void testMat4()
+{
+	const auto bones = makeBones(5);
+	std::vector<glm::vec4> texels;
+
+	packBones(bones.data(), bones.size(), BoneFormat::MAT4, texels);
+
+	for (size_t i = 0; i < bones.size(); ++i)
+	{
+		for (glm::length_t column = 0; column < 4; ++column)
+		{
+			CHECK(texels[i * 4 + column] == bones[i][column]);
+		}
+	}
+}
+
+void testMat3x4()
+{
+	const auto bones = makeBones(5);
+	std::vector<glm::vec4> texels;
+
+	packBones(bones.data(), bones.size(), BoneFormat::MAT3X4, texels);
+
+	for (size_t i = 0; i < bones.size(); ++i)
+	{
+		const auto& bone = bones[i];
+
+		for (glm::length_t row = 0; row < 3; ++row)
+		{
+			CHECK(texels[i * 3 + row] == glm::vec4(bone[0][row], bone[1][row], bone[2][row], bone[3][row]));
+		}
+
+		// Transforming with the rows as in skinning.glsl gives what the matrix gives
+		const glm::vec4 point = glm::vec4(1.0f, -2.0f, 3.0f, 1.0f);
+		const glm::vec3 transformed = glm::vec3(
+			glm::dot(texels[i * 3], point),
+			glm::dot(texels[i * 3 + 1], point),
+			glm::dot(texels[i * 3 + 2], point)
+		);
+
+		CHECK(near(transformed, glm::vec3(bone * point)));
+	}
+}
+
+void testDualQuaternion()
+{
+	const auto bones = makeBones(9);
+	std::vector<glm::vec4> texels;
+
+	packBones(bones.data(), bones.size(), BoneFormat::DUAL_QUATERNION, texels);
+
+	for (size_t i = 0; i < bones.size(); ++i)
+	{
+		const auto& bone = bones[i];
+		const glm::quat real = glm::quat(texels[i * 2].w, texels[i * 2].x, texels[i * 2].y, texels[i * 2].z);
+		const glm::quat dual = glm::quat(texels[i * 2 + 1].w, texels[i * 2 + 1].x, texels[i * 2 + 1].y, texels[i * 2 + 1].z);
+
+		CHECK(std::abs(glm::length(real) - 1.0f) < EPSILON);
+
+		// The dual part is orthogonal to the real part for a unit dual quaternion
+		CHECK(std::abs(glm::dot(real, dual)) < EPSILON);
+
+		// translation = 2 * dual * conjugate(real)
+		const glm::quat translation = (dual * glm::conjugate(real)) * 2.0f;
+
+		CHECK(near(glm::vec3(translation.x, translation.y, translation.z), glm::vec3(bone[3])));
+		CHECK(std::abs(translation.w) < EPSILON);
+
+		// The rotation is the one of the matrix with its scale removed
+		const glm::mat3 rotation = glm::mat3(
+			glm::normalize(glm::vec3(bone[0])),
+			glm::normalize(glm::vec3(bone[1])),
+			glm::normalize(glm::vec3(bone[2]))
+		);
+		const glm::vec3 point = glm::vec3(1.0f, -2.0f, 3.0f);
+
+		CHECK(near(real * point, rotation * point));
+	}
+}
+
+void testBatchesMatchSingleBones()
+{
+	// Packed at once, the first bones take the 4 wide path where SSE2 is available and the rest the scalar loop. Packed
+	// one at a time, all of them take the scalar loop.
+	const auto bones = makeBones(7);
+
+	for (const auto boneFormat : {BoneFormat::MAT3X4, BoneFormat::DUAL_QUATERNION})
+	{
+		std::vector<glm::vec4> batched;
+		std::vector<glm::vec4> single;
+
+		packBones(bones.data(), bones.size(), boneFormat, batched);
+
+		for (const auto& bone : bones)
+		{
+			packBones(&bone, 1, boneFormat, single);
+		}
+
+		CHECK(batched.size() == single.size());
+
+		for (size_t i = 0; i < batched.size(); ++i)
+		{
+			CHECK(near(batched[i], single[i]));
+		}
+	}
+}
+
+}
+
+int main()
+{
+	testFormats();
+	testAppend();
+	testMat4();
+	testMat3x4();
+	testDualQuaternion();
+	testBatchesMatchSingleBones();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,340 @@
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <GL/glew.h>
+#include <SDL.h>
+
+#include "gl33/MeshArena.hpp"
+
+#include "../Check.hpp"
+
+using namespace ice_engine;
+using namespace ice_engine::graphics::opengl_renderer::gl33;
+
+namespace
+{
+
+// Returned by tests that need an OpenGL context when none can be created, see SKIP_RETURN_CODE in CMakeLists.txt
+constexpr int SKIPPED = 77;
+
+void testFirstFit()
+{
+	RangeAllocator allocator(100);
+
+	CHECK(allocator.capacity() == 100);
+	CHECK(allocator.used() == 0);
+	CHECK(allocator.largestFreeBlock() == 100);
+
+	CHECK(allocator.allocate(10) == 0);
+	CHECK(allocator.allocate(20) == 10);
+	CHECK(allocator.allocate(30) == 30);
+	CHECK(allocator.used() == 60);
+
+	allocator.free(10, 20);
+
+	// The hole at 10 is the first block that fits, even though the block at the end fits as well
+	CHECK(allocator.allocate(5) == 10);
+
+	// The rest of the hole is too small, so the block at the end is used
+	CHECK(allocator.allocate(20) == 60);
+	CHECK(allocator.allocate(15) == 15);
+	CHECK(allocator.used() == 80);
+	CHECK(allocator.largestFreeBlock() == 20);
+
+	CHECK(allocator.allocate(21) == RangeAllocator::INVALID_OFFSET);
+	CHECK(allocator.used() == 80);
+	CHECK(allocator.allocate(20) == 80);
+	CHECK(allocator.largestFreeBlock() == 0);
+
+	// Empty allocations take no space
+	CHECK(allocator.allocate(0) == 0);
+	CHECK(allocator.used() == 100);
+}
+
+void testMerge()
+{
+	RangeAllocator allocator(40);
+
+	for (uint32 i = 0; i < 4; ++i)
+	{
+		CHECK(allocator.allocate(10) == i * 10);
+	}
+
+	CHECK(allocator.largestFreeBlock() == 0);
+
+	// Neither neighbour is free
+	allocator.free(10, 10);
+	CHECK(allocator.largestFreeBlock() == 10);
+
+	// Merges with the previous block
+	allocator.free(20, 10);
+	CHECK(allocator.largestFreeBlock() == 20);
+
+	// Merges with the next block
+	allocator.free(0, 10);
+	CHECK(allocator.largestFreeBlock() == 30);
+	CHECK(allocator.allocate(30) == 0);
+	allocator.free(0, 30);
+
+	// Merges with both
+	allocator.free(30, 10);
+	CHECK(allocator.largestFreeBlock() == 40);
+	CHECK(allocator.used() == 0);
+	CHECK(allocator.allocate(40) == 0);
+}
+
+void testGrow()
+{
+	RangeAllocator allocator(10);
+
+	CHECK(allocator.allocate(6) == 0);
+
+	// The new space merges with the free block at the end
+	allocator.grow(20);
+	CHECK(allocator.capacity() == 20);
+	CHECK(allocator.used() == 6);
+	CHECK(allocator.largestFreeBlock() == 14);
+	CHECK(allocator.allocate(14) == 6);
+
+	// Without a free block at the end the new space stands alone
+	allocator.grow(25);
+	CHECK(allocator.largestFreeBlock() == 5);
+	CHECK(allocator.allocate(5) == 20);
+
+	// Shrinking is ignored
+	allocator.grow(5);
+	CHECK(allocator.capacity() == 25);
+}
+
+void testRandom()
+{
+	constexpr uint32 capacity = 1000;
+
+	std::mt19937 random(1);
+	RangeAllocator allocator(capacity);
+
+	struct Block
+	{
+		uint32 offset;
+		uint32 size;
+	};
+
+	std::vector<Block> blocks;
+	std::vector<bool> owned(capacity, false);
+
+	for (uint32 i = 0; i < 10000; ++i)
+	{
+		if (blocks.empty() || random() % 2 == 0)
+		{
+			const uint32 size = 1 + random() % 50;
+			const uint32 offset = allocator.allocate(size);
+
+			if (offset == RangeAllocator::INVALID_OFFSET)
+			{
+				CHECK(allocator.largestFreeBlock() < size);
+				continue;
+			}
+
+			CHECK(offset + size <= capacity);
+
+			for (uint32 j = offset; j < offset + size; ++j)
+			{
+				// Blocks never overlap
+				CHECK(!owned[j]);
+				owned[j] = true;
+			}
+
+			blocks.push_back({offset, size});
+		}
+		else
+		{
+			const size_t index = random() % blocks.size();
+			const Block block = blocks[index];
+
+			allocator.free(block.offset, block.size);
+			std::fill(owned.begin() + block.offset, owned.begin() + block.offset + block.size, false);
+
+			blocks[index] = blocks.back();
+			blocks.pop_back();
+		}
+
+		CHECK(allocator.used() == static_cast<uint32>(std::count(owned.begin(), owned.end(), true)));
+	}
+
+	for (const auto& block : blocks)
+	{
+		allocator.free(block.offset, block.size);
+	}
+
+	// Everything merged back into one block
+	CHECK(allocator.used() == 0);
+	CHECK(allocator.largestFreeBlock() == capacity);
+}
+
+std::vector<FloatVertex> makeVertices(const uint32 count, const float32 value)
+{
+	std::vector<FloatVertex> vertices(count);
+
+	for (uint32 i = 0; i < count; ++i)
+	{
+		vertices[i].position = glm::vec3(value, static_cast<float32>(i), 0.0f);
+	}
+
+	return vertices;
+}
+
+GLuint vertexBuffer(const MeshArena& meshArena)
+{
+	GLint buffer = 0;
+
+	glBindVertexArray(meshArena.id());
+	glGetVertexAttribiv(0, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &buffer);
+	glBindVertexArray(0);
+
+	return static_cast<GLuint>(buffer);
+}
+
+/**
+ * Checks that the vertices and indices of an allocation are the ones that were uploaded, wherever they are now.
+ */
+void checkContents(const MeshArena& meshArena, const uint32 id, const std::vector<FloatVertex>& vertices, const std::vector<uint32>& indices)
+{
+	const auto& allocation = meshArena.allocation(id);
+
+	CHECK(allocation.vertexCount == vertices.size());
+	CHECK(allocation.indexCount == indices.size());
+
+	std::vector<FloatVertex> storedVertices(vertices.size());
+	std::vector<uint32> storedIndices(indices.size());
+
+	glBindBuffer(GL_COPY_READ_BUFFER, vertexBuffer(meshArena));
+	glGetBufferSubData(GL_COPY_READ_BUFFER, allocation.baseVertex * sizeof(FloatVertex), vertices.size() * sizeof(FloatVertex), &storedVertices[0]);
+
+	glBindBuffer(GL_COPY_READ_BUFFER, meshArena.indexBuffer());
+	glGetBufferSubData(GL_COPY_READ_BUFFER, allocation.indexOffset(), indices.size() * sizeof(uint32), &storedIndices[0]);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	CHECK(std::memcmp(&storedVertices[0], &vertices[0], vertices.size() * sizeof(FloatVertex)) == 0);
+	CHECK(storedIndices == indices);
+}
+
+void testMeshArena()
+{
+	MeshArena meshArena;
+	meshArena.generate(VertexFormat::FLOAT, false, 16, 32);
+
+	const std::vector<uint32> indices = {0, 1, 2, 2, 1, 3};
+	std::vector<std::vector<FloatVertex>> vertices;
+	std::vector<uint32> ids;
+
+	for (uint32 i = 0; i < 3; ++i)
+	{
+		vertices.push_back(makeVertices(4, static_cast<float32>(i)));
+		ids.push_back(meshArena.allocate(4, static_cast<uint32>(indices.size()), GL_UNSIGNED_INT));
+
+		meshArena.vertices(ids.back(), &vertices.back()[0]);
+		meshArena.indices(ids.back(), &indices[0]);
+	}
+
+	CHECK(meshArena.allocation(ids[0]).baseVertex == 0);
+	CHECK(meshArena.allocation(ids[1]).baseVertex == 4);
+	CHECK(meshArena.allocation(ids[2]).baseVertex == 8);
+	CHECK(meshArena.fragmentation() == 0.0f);
+
+	// A hole of 4 vertices in front of the 4 free vertices at the end
+	meshArena.free(ids[1]);
+	CHECK(meshArena.fragmentation() == 0.5f);
+
+	meshArena.defragment();
+
+	CHECK(meshArena.fragmentation() == 0.0f);
+	CHECK(meshArena.allocation(ids[0]).baseVertex == 0);
+	CHECK(meshArena.allocation(ids[2]).baseVertex == 4);
+	CHECK(meshArena.allocation(ids[2]).firstIndexUnit == 6);
+	checkContents(meshArena, ids[0], vertices[0], indices);
+	checkContents(meshArena, ids[2], vertices[2], indices);
+
+	// Too large for the arena, which grows and keeps what it holds
+	const auto largeVertices = makeVertices(20, 3.0f);
+	const uint32 largeId = meshArena.allocate(20, static_cast<uint32>(indices.size()), GL_UNSIGNED_INT);
+
+	meshArena.vertices(largeId, &largeVertices[0]);
+	meshArena.indices(largeId, &indices[0]);
+
+	CHECK(meshArena.allocation(largeId).baseVertex == 8);
+	checkContents(meshArena, ids[0], vertices[0], indices);
+	checkContents(meshArena, ids[2], vertices[2], indices);
+	checkContents(meshArena, largeId, largeVertices, indices);
+
+	// Two 16 bit indices per unit, rounded up
+	const uint32 shortId = meshArena.allocate(4, 3, GL_UNSIGNED_SHORT);
+
+	CHECK(meshArena.allocation(shortId).indexUnits == 2);
+	CHECK(meshArena.allocation(shortId).firstIndex() == meshArena.allocation(shortId).firstIndexUnit * 2);
+
+	CHECK(glGetError() == GL_NO_ERROR);
+
+	meshArena.destroy();
+}
+
+/**
+ * Creates a hidden window with an OpenGL 3.3 core context, as the renderer does.
+ *
+ * @return false if there is no display or driver to create one with.
+ */
+bool createContext(SDL_Window*& window, SDL_GLContext& context)
+{
+	if (SDL_Init(SDL_INIT_VIDEO) != 0) return false;
+
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+
+	window = SDL_CreateWindow("", 0, 0, 1, 1, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+
+	if (window == nullptr) return false;
+
+	context = SDL_GL_CreateContext(window);
+
+	if (context == nullptr) return false;
+
+	glewExperimental = GL_TRUE;
+
+	if (glewInit() != GLEW_OK) return false;
+
+	// glewInit() can leave an error behind in core profiles
+	glGetError();
+
+	return true;
+}
+
+}
+
+int main(int, char**)
+{
+	testFirstFit();
+	testMerge();
+	testGrow();
+	testRandom();
+
+	SDL_Window* window = nullptr;
+	SDL_GLContext context = nullptr;
+
+	if (!createContext(window, context))
+	{
+		std::fprintf(stderr, "No OpenGL 3.3 context, skipping the MeshArena tests: %s\n", SDL_GetError());
+		SDL_Quit();
+
+		return SKIPPED;
+	}
+
+	testMeshArena();
+
+	SDL_GL_DeleteContext(context);
+	SDL_DestroyWindow(window);
+	SDL_Quit();
+
+	return EXIT_SUCCESS;
+}
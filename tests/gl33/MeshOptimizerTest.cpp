@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "gl33/MeshOptimizer.hpp"
+
+#include "../Check.hpp"
+
+using namespace ice_engine;
+using namespace ice_engine::graphics::opengl_renderer::gl33;
+
+namespace
+{
+
+typedef std::array<uint32, 3> Triangle;
+
+/**
+ * A grid of size x size quads with every vertex stored once, its triangles in random order so there is something to
+ * optimize.
+ */
+void makeGrid(const uint32 size, std::vector<glm::vec3>& vertices, std::vector<uint32>& indices)
+{
+	vertices.clear();
+	indices.clear();
+
+	for (uint32 z = 0; z <= size; ++z)
+	{
+		for (uint32 x = 0; x <= size; ++x)
+		{
+			vertices.push_back(glm::vec3(static_cast<float32>(x), 0.0f, static_cast<float32>(z)));
+		}
+	}
+
+	std::vector<Triangle> triangles;
+
+	for (uint32 z = 0; z < size; ++z)
+	{
+		for (uint32 x = 0; x < size; ++x)
+		{
+			const uint32 i = z * (size + 1) + x;
+
+			triangles.push_back({{i, i + size + 1, i + 1}});
+			triangles.push_back({{i + 1, i + size + 1, i + size + 2}});
+		}
+	}
+
+	std::shuffle(triangles.begin(), triangles.end(), std::mt19937(1));
+
+	for (const auto& triangle : triangles)
+	{
+		indices.insert(indices.end(), triangle.begin(), triangle.end());
+	}
+}
+
+/**
+ * The triangles of a mesh by their vertex ids, each rotated so its smallest id comes first while keeping the winding,
+ * and sorted, so meshes with the same triangles compare equal whatever their triangle order.
+ */
+std::vector<Triangle> triangles(const std::vector<uint32>& indices, const std::vector<uint32>& vertexIds)
+{
+	std::vector<Triangle> result;
+
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		Triangle triangle = {{vertexIds[indices[i]], vertexIds[indices[i + 1]], vertexIds[indices[i + 2]]}};
+
+		std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+		result.push_back(triangle);
+	}
+
+	std::sort(result.begin(), result.end());
+
+	return result;
+}
+
+/**
+ * Ids that tell vertices apart by position, which stays unique in these meshes after welding.
+ */
+std::vector<uint32> positionIds(const std::vector<glm::vec3>& vertices)
+{
+	std::vector<uint32> ids;
+
+	for (const auto& vertex : vertices)
+	{
+		ids.push_back(static_cast<uint32>(vertex.z) * 1000 + static_cast<uint32>(vertex.x));
+	}
+
+	return ids;
+}
+
+void testOptimizeGrid()
+{
+	std::vector<glm::vec3> vertices;
+	std::vector<uint32> indices;
+	std::vector<glm::vec4> colors;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> textureCoordinates;
+
+	makeGrid(32, vertices, indices);
+
+	const auto originalVertices = vertices;
+	const auto originalTriangles = triangles(indices, positionIds(vertices));
+
+	const auto optimization = optimizeMesh(vertices, indices, colors, normals, textureCoordinates);
+
+	CHECK(optimization.originalVertexCount == originalVertices.size());
+	CHECK(optimization.vertexCount == originalVertices.size());
+	CHECK(vertices.size() == optimization.vertexCount);
+	CHECK(optimization.after.acmr < optimization.before.acmr);
+
+	// Same triangles, same winding
+	CHECK(triangles(indices, positionIds(vertices)) == originalTriangles);
+
+	// Every vertex moved to where the remap says
+	for (size_t i = 0; i < originalVertices.size(); ++i)
+	{
+		CHECK(optimization.vertexRemap[i] != REMOVED_VERTEX);
+		CHECK(vertices[optimization.vertexRemap[i]] == originalVertices[i]);
+	}
+
+	// Vertices are numbered in the order the indices first use them
+	uint32 nextVertex = 0;
+
+	for (const auto index : indices)
+	{
+		CHECK(index <= nextVertex);
+
+		if (index == nextVertex) ++nextVertex;
+	}
+
+	CHECK(nextVertex == vertices.size());
+}
+
+void testWeld()
+{
+	// A quad whose two triangles each have their own copy of the shared edge, plus a vertex nothing uses
+	std::vector<glm::vec3> vertices = {
+		glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f),
+		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 1.0f),
+		glm::vec3(5.0f, 0.0f, 5.0f)
+	};
+	std::vector<uint32> indices = {0, 1, 2, 3, 4, 5};
+	std::vector<glm::vec4> colors;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> textureCoordinates;
+
+	const auto originalVertices = vertices;
+	const auto originalTriangles = triangles(indices, positionIds(vertices));
+
+	const auto optimization = optimizeMesh(vertices, indices, colors, normals, textureCoordinates);
+
+	CHECK(optimization.vertexCount == 4);
+	CHECK(vertices.size() == 4);
+	CHECK(optimization.vertexRemap[1] == optimization.vertexRemap[4]);
+	CHECK(optimization.vertexRemap[2] == optimization.vertexRemap[3]);
+	CHECK(optimization.vertexRemap[6] == REMOVED_VERTEX);
+	CHECK(triangles(indices, positionIds(vertices)) == originalTriangles);
+
+	for (size_t i = 0; i < 6; ++i)
+	{
+		CHECK(vertices[optimization.vertexRemap[i]] == originalVertices[i]);
+	}
+
+	// Vertices that only differ in one attribute stay apart
+	vertices = {glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)};
+	indices = {0, 1, 2, 0, 3, 2};
+	colors = {glm::vec4(1.0f), glm::vec4(1.0f), glm::vec4(1.0f), glm::vec4(0.5f)};
+
+	CHECK(optimizeMesh(vertices, indices, colors, normals, textureCoordinates).vertexCount == 4);
+}
+
+void testSkeletonRemap()
+{
+	std::vector<glm::vec3> vertices;
+	std::vector<uint32> indices;
+	std::vector<glm::vec4> colors;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> textureCoordinates;
+
+	makeGrid(8, vertices, indices);
+
+	// Bone data is supplied after the mesh, as a skeleton assigned later, one entry per original vertex
+	std::vector<glm::ivec4> boneIds;
+	std::vector<glm::vec4> boneWeights;
+
+	for (uint32 i = 0; i < vertices.size(); ++i)
+	{
+		boneIds.push_back(glm::ivec4(i % 7, i % 11, i % 13, 0));
+		boneWeights.push_back(glm::vec4(0.5f, 0.25f, 0.25f, static_cast<float32>(i)));
+	}
+
+	// An unused vertex, which the remap drops
+	vertices.push_back(glm::vec3(100.0f));
+	boneIds.push_back(glm::ivec4(-1));
+	boneWeights.push_back(glm::vec4(-1.0f));
+
+	const auto originalVertices = vertices;
+	const auto originalBoneIds = boneIds;
+	const auto originalBoneWeights = boneWeights;
+
+	// Not welded, bone data may differ between vertices with the same attributes
+	const auto optimization = optimizeMesh(vertices, indices, colors, normals, textureCoordinates, false);
+
+	CHECK(optimization.vertexCount == originalVertices.size() - 1);
+	CHECK(optimization.vertexRemap.back() == REMOVED_VERTEX);
+
+	remapVertices(boneIds, optimization.vertexRemap, optimization.vertexCount);
+	remapVertices(boneWeights, optimization.vertexRemap, optimization.vertexCount);
+
+	CHECK(boneIds.size() == vertices.size());
+	CHECK(boneWeights.size() == vertices.size());
+
+	// Bone data still belongs to the vertex it was given for
+	for (size_t i = 0; i + 1 < originalVertices.size(); ++i)
+	{
+		const uint32 vertex = optimization.vertexRemap[i];
+
+		CHECK(vertices[vertex] == originalVertices[i]);
+		CHECK(boneIds[vertex] == originalBoneIds[i]);
+		CHECK(boneWeights[vertex] == originalBoneWeights[i]);
+	}
+
+	// Empty per vertex data stays empty
+	std::vector<glm::vec4> empty;
+	remapVertices(empty, optimization.vertexRemap, optimization.vertexCount);
+	CHECK(empty.empty());
+}
+
+void testInvalidMesh()
+{
+	std::vector<glm::vec3> vertices = {glm::vec3(0.0f), glm::vec3(1.0f), glm::vec3(2.0f)};
+	std::vector<glm::vec4> colors;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> textureCoordinates;
+
+	const auto checkUntouched = [&](std::vector<uint32> indices) {
+		const auto originalIndices = indices;
+		const auto originalVertices = vertices;
+		const auto optimization = optimizeMesh(vertices, indices, colors, normals, textureCoordinates);
+
+		CHECK(indices == originalIndices);
+		CHECK(vertices.size() == originalVertices.size());
+		CHECK(optimization.vertexCount == vertices.size());
+
+		for (uint32 i = 0; i < vertices.size(); ++i)
+		{
+			CHECK(optimization.vertexRemap[i] == i);
+			CHECK(vertices[i] == originalVertices[i]);
+		}
+	};
+
+	// Not a multiple of 3
+	checkUntouched({0, 1, 2, 0});
+
+	// Out of range
+	checkUntouched({0, 1, 3});
+
+	// Attribute of the wrong size
+	colors = {glm::vec4(1.0f)};
+	checkUntouched({0, 1, 2});
+}
+
+}
+
+int main()
+{
+	testOptimizeGrid();
+	testWeld();
+	testSkeletonRemap();
+	testInvalidMesh();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,200 @@
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "gl33/MipChain.hpp"
+
+#include "../Check.hpp"
+
+using namespace ice_engine;
+using namespace ice_engine::graphics::opengl_renderer::gl33;
+
+namespace
+{
+
+void checkLayout(const uint32 width, const uint32 height, const uint32 channels, const std::vector<std::pair<uint32, uint32>>& expected)
+{
+	std::vector<MipLevel> levels;
+	const size_t size = mipChainLayout(width, height, channels, levels);
+
+	CHECK(levels.size() == expected.size());
+
+	size_t offset = 0;
+
+	for (size_t i = 0; i < levels.size(); ++i)
+	{
+		CHECK(levels[i].width == expected[i].first);
+		CHECK(levels[i].height == expected[i].second);
+		CHECK(levels[i].offset == offset);
+		CHECK(levels[i].size == static_cast<size_t>(expected[i].first) * expected[i].second * channels);
+
+		offset += levels[i].size;
+	}
+
+	CHECK(size == offset);
+}
+
+void testLayout()
+{
+	checkLayout(1, 1, 4, {{1, 1}});
+	checkLayout(2, 2, 4, {{2, 2}, {1, 1}});
+	checkLayout(1, 8, 1, {{1, 8}, {1, 4}, {1, 2}, {1, 1}});
+	checkLayout(8, 1, 3, {{8, 1}, {4, 1}, {2, 1}, {1, 1}});
+	checkLayout(5, 3, 4, {{5, 3}, {2, 1}, {1, 1}});
+	checkLayout(7, 7, 1, {{7, 7}, {3, 3}, {1, 1}});
+	checkLayout(16, 4, 4, {{16, 4}, {8, 2}, {4, 1}, {2, 1}, {1, 1}});
+
+	// The levels are reused, not appended to
+	std::vector<MipLevel> levels(3);
+	mipChainLayout(1, 1, 4, levels);
+	CHECK(levels.size() == 1);
+}
+
+void testConstant(WorkerPool& workerPool)
+{
+	const uint32 sizes[][2] = {{1, 1}, {1, 9}, {9, 1}, {7, 5}, {8, 8}, {16, 3}, {33, 17}};
+
+	for (const auto& size : sizes)
+	{
+		for (const uint32 channels : {1u, 3u, 4u})
+		{
+			for (const bool gammaCorrect : {false, true})
+			{
+				const std::vector<byte> image(static_cast<size_t>(size[0]) * size[1] * channels, 77);
+				std::vector<byte> chain;
+				std::vector<MipLevel> levels;
+
+				generateMipChain(image.data(), size[0], size[1], channels, gammaCorrect, chain, levels, workerPool);
+
+				CHECK(chain.size() == levels.back().offset + levels.back().size);
+
+				for (const auto value : chain)
+				{
+					CHECK(value == 77);
+				}
+			}
+		}
+	}
+}
+
+void testOddSizes(WorkerPool& workerPool)
+{
+	std::vector<byte> chain;
+	std::vector<MipLevel> levels;
+
+	// 3 taps of a third each, the last column counts as much as the others
+	const byte row[] = {0, 90, 180};
+	generateMipChain(row, 3, 1, 1, false, chain, levels, workerPool);
+
+	CHECK(levels.size() == 2);
+	CHECK(chain[levels[1].offset] == 90);
+
+	// The same along the other axis
+	generateMipChain(row, 1, 3, 1, false, chain, levels, workerPool);
+
+	CHECK(chain[levels[1].offset] == 90);
+
+	// 5 to 2, weighted (2, 2, 1) / 5 and (1, 2, 2) / 5, so a bright last texel lands in the last destination texel only
+	// and the average of the level stays 50
+	const byte five[] = {0, 0, 0, 0, 250};
+	generateMipChain(five, 5, 1, 1, false, chain, levels, workerPool);
+
+	CHECK(levels[1].width == 2);
+	CHECK(chain[levels[1].offset] == 0);
+	CHECK(chain[levels[1].offset + 1] == 100);
+	CHECK(chain[levels[2].offset] == 50);
+
+	// 3 x 3 down to 1 x 1 weighs all 9 texels equally
+	const byte square[] = {0, 0, 0, 0, 0, 0, 0, 0, 225};
+	generateMipChain(square, 3, 3, 1, false, chain, levels, workerPool);
+
+	CHECK(chain[levels[1].offset] == 25);
+}
+
+void testGamma(WorkerPool& workerPool)
+{
+	// Black and white checkerboard, fully opaque and fully transparent
+	const byte image[] = {
+		0, 0, 0, 0,  255, 255, 255, 255,
+		255, 255, 255, 255,  0, 0, 0, 0
+	};
+	std::vector<byte> chain;
+	std::vector<MipLevel> levels;
+
+	generateMipChain(image, 2, 2, 4, false, chain, levels, workerPool);
+
+	for (uint32 c = 0; c < 4; ++c)
+	{
+		CHECK(chain[levels[1].offset + c] == 128);
+	}
+
+	// Half the light is 255 * 0.5^(1 / 2.2) = 186 once encoded, alpha is averaged linearly either way
+	generateMipChain(image, 2, 2, 4, true, chain, levels, workerPool);
+
+	for (uint32 c = 0; c < 3; ++c)
+	{
+		CHECK(chain[levels[1].offset + c] == 186);
+	}
+
+	CHECK(chain[levels[1].offset + 3] == 128);
+
+	// Without alpha, every channel is color
+	const byte rgb[] = {0, 0, 0, 255, 255, 255};
+	generateMipChain(rgb, 2, 1, 3, true, chain, levels, workerPool);
+
+	for (uint32 c = 0; c < 3; ++c)
+	{
+		CHECK(chain[levels[1].offset + c] == 186);
+	}
+}
+
+void testLargeImage(WorkerPool& workerPool)
+{
+	// Big enough for the rows to be split over threads, with the 4 channel 2 x 2 fast path where SSE2 is available
+	const uint32 width = 1024;
+	const uint32 height = 512;
+	std::vector<byte> image(static_cast<size_t>(width) * height * 4);
+
+	std::mt19937 random(1);
+	for (auto& value : image)
+	{
+		value = static_cast<byte>(random() & 0xFF);
+	}
+
+	std::vector<byte> chain;
+	std::vector<MipLevel> levels;
+
+	generateMipChain(image.data(), width, height, 4, false, chain, levels, workerPool);
+
+	CHECK(levels.size() == 11);
+
+	for (uint32 y = 0; y < height / 2; ++y)
+	{
+		for (uint32 x = 0; x < width / 2; ++x)
+		{
+			for (uint32 c = 0; c < 4; ++c)
+			{
+				const size_t source = (static_cast<size_t>(y) * 2 * width + x * 2) * 4 + c;
+				const uint32 sum = image[source] + image[source + 4] + image[source + width * 4] + image[source + width * 4 + 4];
+
+				CHECK(chain[levels[1].offset + (static_cast<size_t>(y) * (width / 2) + x) * 4 + c] == (sum + 2) / 4);
+			}
+		}
+	}
+}
+
+}
+
+int main()
+{
+	WorkerPool workerPool(4);
+
+	testLayout();
+	testConstant(workerPool);
+	testOddSizes(workerPool);
+	testGamma(workerPool);
+	testLargeImage(workerPool);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "gl33/RenderQueue.hpp"
+
+#include "../Check.hpp"
+
+using namespace ice_engine;
+using namespace ice_engine::graphics::opengl_renderer::gl33;
+
+namespace
+{
+
+/**
+ * Sorts the same items with std::stable_sort, which the radix sort must match exactly, ties included.
+ */
+std::vector<RenderQueueItem> referenceSort(std::vector<RenderQueueItem> items)
+{
+	std::stable_sort(items.begin(), items.end(), [](const RenderQueueItem& a, const RenderQueueItem& b) {
+		return a.key < b.key;
+	});
+
+	return items;
+}
+
+void checkSorted(RenderQueue& renderQueue)
+{
+	const auto expected = referenceSort(renderQueue.items());
+
+	renderQueue.sort();
+
+	const auto& items = renderQueue.items();
+
+	CHECK(items.size() == expected.size());
+
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		CHECK(items[i].key == expected[i].key);
+		CHECK(items[i].index == expected[i].index);
+	}
+}
+
+void testKeyFieldOrder()
+{
+	// Each field outranks every field after it
+	const uint64 shadow = RenderQueue::key(RenderPass::SHADOW, 255, true, 65535, 65535, 1.0f);
+	const uint64 geometry = RenderQueue::key(RenderPass::GEOMETRY, 0, false, 0, 0, 0.0f);
+
+	CHECK(shadow < geometry);
+	CHECK(RenderQueue::key(RenderPass::GEOMETRY, 1, false, 0, 0, 0.0f) > RenderQueue::key(RenderPass::GEOMETRY, 0, true, 65535, 65535, 1.0f));
+	CHECK(RenderQueue::key(RenderPass::GEOMETRY, 0, true, 0, 0, 0.0f) > RenderQueue::key(RenderPass::GEOMETRY, 0, false, 65535, 65535, 1.0f));
+	CHECK(RenderQueue::key(RenderPass::GEOMETRY, 0, false, 1, 0, 0.0f) > RenderQueue::key(RenderPass::GEOMETRY, 0, false, 0, 65535, 1.0f));
+	CHECK(RenderQueue::key(RenderPass::GEOMETRY, 0, false, 0, 1, 0.0f) > RenderQueue::key(RenderPass::GEOMETRY, 0, false, 0, 0, 1.0f));
+	CHECK(RenderQueue::key(RenderPass::GEOMETRY, 0, false, 0, 0, 0.5f) > RenderQueue::key(RenderPass::GEOMETRY, 0, false, 0, 0, 0.25f));
+
+	CHECK(RenderQueue::pass(shadow) == RenderPass::SHADOW);
+	CHECK(RenderQueue::pass(geometry) == RenderPass::GEOMETRY);
+
+	// Depth is clamped to [0, 1]
+	CHECK(RenderQueue::key(RenderPass::GEOMETRY, 0, false, 0, 0, -1.0f) == RenderQueue::key(RenderPass::GEOMETRY, 0, false, 0, 0, 0.0f));
+	CHECK(RenderQueue::key(RenderPass::GEOMETRY, 0, false, 0, 0, 2.0f) == RenderQueue::key(RenderPass::GEOMETRY, 0, false, 0, 0, 1.0f));
+}
+
+void testEmptyAndSingle()
+{
+	RenderQueue renderQueue;
+
+	renderQueue.sort();
+	CHECK(renderQueue.items().empty());
+
+	renderQueue.push(42, 7);
+	renderQueue.sort();
+	CHECK(renderQueue.items().size() == 1);
+	CHECK(renderQueue.items()[0].key == 42);
+	CHECK(renderQueue.items()[0].index == 7);
+}
+
+void testRandomKeys()
+{
+	std::mt19937_64 random(1);
+	RenderQueue renderQueue;
+
+	for (uint32 i = 0; i < 10000; ++i)
+	{
+		renderQueue.push(random(), i);
+	}
+
+	checkSorted(renderQueue);
+}
+
+void testStableWithDuplicates()
+{
+	std::mt19937 random(2);
+	RenderQueue renderQueue;
+
+	// Few distinct keys, so most items tie and their order must be kept
+	for (uint32 i = 0; i < 5000; ++i)
+	{
+		const uint32 material = random() % 4;
+		const uint32 mesh = random() % 4;
+
+		renderQueue.push(RenderQueue::key(RenderPass::GEOMETRY, 1, false, material, mesh, 0.0f), i);
+	}
+
+	checkSorted(renderQueue);
+}
+
+void testSkippedBytes()
+{
+	std::mt19937 random(3);
+	RenderQueue renderQueue;
+
+	// Only the depth bytes differ, every other byte position is skipped
+	for (uint32 i = 0; i < 1000; ++i)
+	{
+		const float32 depth = static_cast<float32>(random() % 1000) / 1000.0f;
+
+		renderQueue.push(RenderQueue::key(RenderPass::SHADOW, 3, true, 12, 34, depth), i);
+	}
+
+	checkSorted(renderQueue);
+
+	// Identical keys are all skipped and must come out untouched
+	renderQueue.clear();
+
+	for (uint32 i = 0; i < 100; ++i)
+	{
+		renderQueue.push(0x0123456789ABCDEFull, i);
+	}
+
+	checkSorted(renderQueue);
+}
+
+void testReuse()
+{
+	std::mt19937_64 random(4);
+	RenderQueue renderQueue;
+
+	// Scratch storage from a larger sort must not leak into a smaller one
+	for (uint32 i = 0; i < 1000; ++i)
+	{
+		renderQueue.push(random(), i);
+	}
+
+	renderQueue.sort();
+	renderQueue.clear();
+
+	for (uint32 i = 0; i < 10; ++i)
+	{
+		renderQueue.push(random(), i);
+	}
+
+	checkSorted(renderQueue);
+}
+
+}
+
+int main()
+{
+	testKeyFieldOrder();
+	testEmptyAndSingle();
+	testRandomKeys();
+	testStableWithDuplicates();
+	testSkippedBytes();
+	testReuse();
+
+	return EXIT_SUCCESS;
+}